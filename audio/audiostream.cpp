@@ -306,7 +306,7 @@ private:
 	 * A mutex to avoid access problems (causing e.g. corruption of
 	 * the linked list) in thread aware environments.
 	 */
-	Common::Mutex _mutex;
+	mutable Common::Mutex _mutex;
 
 	/**
 	 * The queue of audio streams.
@@ -333,7 +333,7 @@ public:
 	virtual void finish() { _finished = true; }
 
 	uint32 numQueuedStreams() const {
-		//Common::StackLock lock(_mutex);
+		Common::StackLock lock(_mutex);
 		return _queue.size();
 	}
 };
@@ -29,6 +29,7 @@
 #include "backends/platform/sdl/sdl.h"
 #include "common/config-manager.h"
 #include "common/mutex.h"
+#include "common/rect.h"
 #include "common/textconsole.h"
 #include "common/translation.h"
 #include "common/util.h"
@@ -342,6 +343,29 @@ void SurfaceSdlGraphicsManager::updateScreen() {
 	}
 }
 
+void SurfaceSdlGraphicsManager::updateScreenRects(const Common::Rect *rects, int count) {
+#ifdef USE_OPENGL
+	if (_opengl) {
+		updateScreen();
+		return;
+	}
+#endif
+	if (_overlayVisible) {
+		updateScreen();
+		return;
+	}
+
+	SDL_Rect *sdlRects = new SDL_Rect[count];
+	for (int i = 0; i < count; i++) {
+		sdlRects[i].x = rects[i].left;
+		sdlRects[i].y = rects[i].top;
+		sdlRects[i].w = rects[i].width();
+		sdlRects[i].h = rects[i].height();
+	}
+	SDL_UpdateRects(_screen, count, sdlRects);
+	delete[] sdlRects;
+}
+
 int16 SurfaceSdlGraphicsManager::getHeight() {
 	return _screen->h;
 }
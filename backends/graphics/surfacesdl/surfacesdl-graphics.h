@@ -61,6 +61,7 @@ public:
 
 public:
 	virtual void updateScreen();
+	virtual void updateScreenRects(const Common::Rect *rects, int count);
 
 	virtual void showOverlay();
 	virtual void hideOverlay();
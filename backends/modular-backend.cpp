@@ -26,6 +26,7 @@
 
 #include "backends/graphics/graphics.h"
 #include "backends/mutex/mutex.h"
+#include "backends/thread/thread.h"
 
 #include "audio/mixer.h"
 #include "graphics/pixelformat.h"
@@ -33,6 +34,7 @@
 ModularBackend::ModularBackend()
 	:
 	_mutexManager(0),
+	_threadManager(0),
 	_graphicsManager(0),
 	_mixer(0) {
 
@@ -43,6 +45,8 @@ ModularBackend::~ModularBackend() {
 	_graphicsManager = 0;
 	delete _mixer;
 	_mixer = 0;
+	delete _threadManager;
+	_threadManager = 0;
 	delete _mutexManager;
 	_mutexManager = 0;
 }
@@ -88,6 +92,10 @@ void ModularBackend::updateScreen() {
 	_graphicsManager->updateScreen();
 }
 
+void ModularBackend::updateScreenRects(const Common::Rect *rects, int count) {
+	_graphicsManager->updateScreenRects(rects, count);
+}
+
 void ModularBackend::showOverlay() {
 	_graphicsManager->showOverlay();
 }
@@ -152,6 +160,40 @@ void ModularBackend::deleteMutex(MutexRef mutex) {
 	_mutexManager->deleteMutex(mutex);
 }
 
+// Threads are optional, without a manager the OSystem defaults apply
+
+OSystem::ThreadRef ModularBackend::createThread(ThreadProc proc, void *param) {
+	if (!_threadManager)
+		return 0;
+	return _threadManager->createThread(proc, param);
+}
+
+void ModularBackend::waitThread(ThreadRef thread) {
+	if (_threadManager)
+		_threadManager->waitThread(thread);
+}
+
+OSystem::SemaphoreRef ModularBackend::createSemaphore(uint initialValue) {
+	if (!_threadManager)
+		return 0;
+	return _threadManager->createSemaphore(initialValue);
+}
+
+void ModularBackend::waitSemaphore(SemaphoreRef sem) {
+	if (_threadManager)
+		_threadManager->waitSemaphore(sem);
+}
+
+void ModularBackend::postSemaphore(SemaphoreRef sem) {
+	if (_threadManager)
+		_threadManager->postSemaphore(sem);
+}
+
+void ModularBackend::deleteSemaphore(SemaphoreRef sem) {
+	if (_threadManager)
+		_threadManager->deleteSemaphore(sem);
+}
+
 Audio::Mixer *ModularBackend::getMixer() {
 	assert(_mixer);
 	return (Audio::Mixer *)_mixer;
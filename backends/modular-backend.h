@@ -27,6 +27,7 @@
 
 class GraphicsManager;
 class MutexManager;
+class ThreadManager;
 
 /**
  * Base class for modular backends.
@@ -69,6 +70,7 @@ public:
 	virtual int16 getHeight();
 	virtual int16 getWidth();
 	virtual void updateScreen();
+	virtual void updateScreenRects(const Common::Rect *rects, int count);
 
 	virtual void showOverlay();
 	virtual void hideOverlay();
@@ -102,6 +104,18 @@ public:
 
 	//@}
 
+	/** @name Thread handling */
+	//@{
+
+	virtual ThreadRef createThread(ThreadProc proc, void *param);
+	virtual void waitThread(ThreadRef thread);
+	virtual SemaphoreRef createSemaphore(uint initialValue);
+	virtual void waitSemaphore(SemaphoreRef sem);
+	virtual void postSemaphore(SemaphoreRef sem);
+	virtual void deleteSemaphore(SemaphoreRef sem);
+
+	//@}
+
 	/** @name Sound */
 	//@{
 
@@ -122,6 +136,7 @@ protected:
 	//@{
 
 	MutexManager *_mutexManager;
+	ThreadManager *_threadManager;
 	GraphicsManager *_graphicsManager;
 	Audio::Mixer *_mixer;
 
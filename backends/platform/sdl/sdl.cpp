@@ -45,6 +45,7 @@
 
 #include "backends/events/sdl/sdl-events.h"
 #include "backends/mutex/sdl/sdl-mutex.h"
+#include "backends/thread/sdl/sdl-thread.h"
 #include "backends/timer/sdl/sdl-timer.h"
 #include "backends/graphics/surfacesdl/surfacesdl-graphics.h"
 
@@ -89,6 +90,8 @@ OSystem_SDL::~OSystem_SDL() {
 	_mixerManager = 0;
 	delete _timerManager;
 	_timerManager = 0;
+	delete _threadManager;
+	_threadManager = 0;
 	delete _mutexManager;
 	_mutexManager = 0;
 
@@ -117,6 +120,9 @@ void OSystem_SDL::init() {
 	if (_mutexManager == 0)
 		_mutexManager = new SdlMutexManager();
 
+	if (_threadManager == 0)
+		_threadManager = new SdlThreadManager();
+
 	if (_timerManager == 0)
 		_timerManager = new SdlTimerManager();
 
@@ -248,6 +254,12 @@ void OSystem_SDL::setWindowCaption(const char *caption) {
 	SDL_WM_SetCaption(cap.c_str(), cap.c_str());
 }
 
+bool OSystem_SDL::hasFeature(Feature f) {
+	if (f == kFeatureCpuSSE2)
+		return SDL_HasSSE2() == SDL_TRUE;
+	return ModularBackend::hasFeature(f);
+}
+
 void OSystem_SDL::quit() {
 	delete this;
 	exit(0);
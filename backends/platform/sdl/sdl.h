@@ -62,6 +62,7 @@ public:
 	virtual void engineInit();
 	virtual void engineDone();
 #endif
+	virtual bool hasFeature(Feature f);
 	virtual Common::HardwareKeySet *getHardwareKeySet();
 	virtual void quit();
 	virtual void fatalError();
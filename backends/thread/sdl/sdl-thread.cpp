@@ -0,0 +1,55 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/scummsys.h"
+
+#if defined(SDL_BACKEND)
+
+#include "backends/thread/sdl/sdl-thread.h"
+#include "backends/platform/sdl/sdl-sys.h"
+
+
+OSystem::ThreadRef SdlThreadManager::createThread(OSystem::ThreadProc proc, void *param) {
+	return (OSystem::ThreadRef) SDL_CreateThread(proc, param);
+}
+
+void SdlThreadManager::waitThread(OSystem::ThreadRef thread) {
+	SDL_WaitThread((SDL_Thread *) thread, NULL);
+}
+
+OSystem::SemaphoreRef SdlThreadManager::createSemaphore(uint initialValue) {
+	return (OSystem::SemaphoreRef) SDL_CreateSemaphore(initialValue);
+}
+
+void SdlThreadManager::waitSemaphore(OSystem::SemaphoreRef sem) {
+	SDL_SemWait((SDL_sem *) sem);
+}
+
+void SdlThreadManager::postSemaphore(OSystem::SemaphoreRef sem) {
+	SDL_SemPost((SDL_sem *) sem);
+}
+
+void SdlThreadManager::deleteSemaphore(OSystem::SemaphoreRef sem) {
+	SDL_DestroySemaphore((SDL_sem *) sem);
+}
+
+#endif
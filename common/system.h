@@ -256,7 +256,16 @@ public:
 		 *
 		 * This feature has no associated state.
 		 */
-		kFeatureDisplayLogFile
+		kFeatureDisplayLogFile,
+
+		/**
+		 * The presence of this feature indicates that the CPU the program
+		 * runs on supports the SSE2 instruction set. Code built with SSE2
+		 * kernels checks it before using them.
+		 *
+		 * This feature has no associated state.
+		 */
+		kFeatureCpuSSE2
 	};
 
 	/**
@@ -332,6 +341,16 @@ public:
 	 */
 	virtual void updateScreen() = 0;
 
+	/**
+	 * Flush only the given parts of the screen framebuffer to the display,
+	 * the rest of it is unchanged since the previous update. Backends which
+	 * cannot do partial updates flush the whole screen.
+	 *
+	 * @param rects		the changed rectangles
+	 * @param count		the number of rectangles
+	 */
+	virtual void updateScreenRects(const Common::Rect *rects, int count) { updateScreen(); }
+
 	//@}
 
 
@@ -558,6 +577,57 @@ public:
 
 
 
+	/**
+	 * @name Thread handling
+	 * Optional worker threads, e.g. to read or decode data ahead of the
+	 * main thread. Backends without threads keep the default
+	 * implementations, and createThread() returns 0: users must then do
+	 * the work on the main thread instead.
+	 */
+	//@{
+
+	typedef struct OpaqueThread *ThreadRef;
+	typedef struct OpaqueSemaphore *SemaphoreRef;
+	typedef int (*ThreadProc)(void *param);
+
+	/**
+	 * Start a new thread running proc(param).
+	 * @return the new thread, or 0 if threads are not supported.
+	 */
+	virtual ThreadRef createThread(ThreadProc proc, void *param) { return 0; }
+
+	/**
+	 * Wait for the given thread to return from its proc, and free it.
+	 * @param thread	the thread to wait for.
+	 */
+	virtual void waitThread(ThreadRef thread) {}
+
+	/**
+	 * Create a new counting semaphore.
+	 * @return the newly created semaphore, or 0 if threads are not supported.
+	 */
+	virtual SemaphoreRef createSemaphore(uint initialValue) { return 0; }
+
+	/**
+	 * Block until the value of the semaphore is positive, then
+	 * decrement it.
+	 */
+	virtual void waitSemaphore(SemaphoreRef sem) {}
+
+	/**
+	 * Increment the value of the semaphore, waking up a waiting thread.
+	 */
+	virtual void postSemaphore(SemaphoreRef sem) {}
+
+	/**
+	 * Delete the given semaphore. No thread may be waiting on it.
+	 */
+	virtual void deleteSemaphore(SemaphoreRef sem) {}
+
+	//@}
+
+
+
 	/** @name Sound */
 	//@{
 
@@ -0,0 +1,71 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/thread.h"
+
+namespace Common {
+
+Semaphore::Semaphore(uint initialValue) {
+	assert(g_system);
+	_sem = g_system->createSemaphore(initialValue);
+}
+
+Semaphore::~Semaphore() {
+	if (_sem)
+		g_system->deleteSemaphore(_sem);
+}
+
+void Semaphore::wait() {
+	if (_sem)
+		g_system->waitSemaphore(_sem);
+}
+
+void Semaphore::post() {
+	if (_sem)
+		g_system->postSemaphore(_sem);
+}
+
+
+#pragma mark -
+
+
+Thread::Thread() : _thread(0) {
+}
+
+Thread::~Thread() {
+	wait();
+}
+
+bool Thread::start(OSystem::ThreadProc proc, void *param) {
+	assert(g_system && !_thread);
+	_thread = g_system->createThread(proc, param);
+	return _thread != 0;
+}
+
+void Thread::wait() {
+	if (_thread) {
+		g_system->waitThread(_thread);
+		_thread = 0;
+	}
+}
+
+} // End of namespace Common
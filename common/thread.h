@@ -0,0 +1,71 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_THREAD_H
+#define COMMON_THREAD_H
+
+#include "common/scummsys.h"
+#include "common/system.h"
+
+namespace Common {
+
+/**
+ * Wrapper class around the OSystem semaphore functions. Without thread
+ * support in the backend, wait() and post() do nothing.
+ */
+class Semaphore {
+	OSystem::SemaphoreRef _sem;
+
+public:
+	explicit Semaphore(uint initialValue = 0);
+	~Semaphore();
+
+	bool isValid() const { return _sem != 0; }
+	void wait();
+	void post();
+};
+
+/**
+ * Wrapper class around the OSystem thread functions. The thread is
+ * waited for when the object goes away.
+ */
+class Thread {
+	OSystem::ThreadRef _thread;
+
+public:
+	Thread();
+	~Thread();
+
+	/**
+	 * Run proc(param) on a new thread.
+	 * @return false if the backend has no threads, the caller must then
+	 * do the work itself.
+	 */
+	bool start(OSystem::ThreadProc proc, void *param);
+	void wait();
+	bool isRunning() const { return _thread != 0; }
+};
+
+
+} // End of namespace Common
+
+#endif
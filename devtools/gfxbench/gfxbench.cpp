@@ -0,0 +1,99 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+// Replays a capture written with gfx_capture against the software
+// renderer, without a game, a window or SDL:
+//
+//   gfxbench <capture> [loops]
+//
+// Only the renderer runs, so the backend below provides just enough for
+// it: a clock, the log, the file system and single threaded mutexes.
+
+#define FORBIDDEN_SYMBOL_EXCEPTION_exit
+#define FORBIDDEN_SYMBOL_EXCEPTION_FILE
+#define FORBIDDEN_SYMBOL_EXCEPTION_fputs
+#define FORBIDDEN_SYMBOL_EXCEPTION_stdout
+#define FORBIDDEN_SYMBOL_EXCEPTION_stderr
+#define FORBIDDEN_SYMBOL_EXCEPTION_time_h
+#define FORBIDDEN_SYMBOL_EXCEPTION_unistd_h
+
+#include "backends/modular-backend.h"
+#include "backends/mutex/mutex.h"
+#include "backends/fs/posix/posix-fs-factory.h"
+
+#include "engines/grim/gfx_capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+class NullMutexManager : public MutexManager {
+public:
+	virtual OSystem::MutexRef createMutex() { return (OSystem::MutexRef)this; }
+	virtual void lockMutex(OSystem::MutexRef mutex) {}
+	virtual void unlockMutex(OSystem::MutexRef mutex) {}
+	virtual void deleteMutex(OSystem::MutexRef mutex) {}
+};
+
+class OSystem_GfxBench : public ModularBackend {
+public:
+	OSystem_GfxBench() {
+		_fsFactory = new POSIXFilesystemFactory();
+		_mutexManager = new NullMutexManager();
+		gettimeofday(&_start, NULL);
+	}
+
+	virtual bool hasFeature(Feature f) { return false; }
+	virtual bool pollEvent(Common::Event &event) { return false; }
+	virtual uint32 getMillis() {
+		struct timeval now;
+		gettimeofday(&now, NULL);
+		return (now.tv_sec - _start.tv_sec) * 1000 + (now.tv_usec - _start.tv_usec) / 1000;
+	}
+	virtual void delayMillis(uint msecs) {}
+	virtual void getTimeAndDate(TimeDate &t) const {}
+	virtual Common::TimerManager *getTimerManager() { return NULL; }
+	virtual Common::EventManager *getEventManager() { return NULL; }
+	virtual Common::SaveFileManager *getSavefileManager() { return NULL; }
+	virtual Common::EventSource *getDefaultEventSource() { return NULL; }
+
+	virtual void logMessage(LogMessageType::Type type, const char *message) {
+		fputs(message, type == LogMessageType::kDebug ? stdout : stderr);
+	}
+
+private:
+	struct timeval _start;
+};
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		fputs("Usage: gfxbench <capture> [loops]\n", stderr);
+		return 1;
+	}
+
+	OSystem_GfxBench *system = new OSystem_GfxBench();
+	g_system = system;
+	Grim::runGfxBenchmark(argv[1], argc > 2 ? atoi(argv[2]) : 10);
+	g_system = NULL;
+	delete system;
+	return 0;
+}
@@ -0,0 +1,36 @@
+MODULE := devtools/gfxbench
+
+MODULE_DIRS += \
+	devtools/gfxbench/
+
+# gfxbench replays a gfx_capture file with the software renderer, without
+# SDL or a game. It links against the engine and support libraries, which
+# the tool rule in rules.mk doesn't do, so it has its own rule. The
+# libraries are listed twice because they refer to each other.
+GFXBENCH := devtools/gfxbench/gfxbench$(EXEEXT)
+GFXBENCH_LIBS := \
+	base/libbase.a \
+	engines/grim/libgrim.a \
+	engines/libengines.a \
+	gui/libgui.a \
+	video/libvideo.a \
+	graphics/libgraphics.a \
+	audio/libaudio.a \
+	math/libmath.a \
+	backends/libbackends.a \
+	common/libcommon.a
+
+$(GFXBENCH): devtools/gfxbench/gfxbench.o $(GFXBENCH_LIBS)
+	$(QUIET_LINK)$(LD) $(LDFLAGS) $< $(GFXBENCH_LIBS) $(GFXBENCH_LIBS) $(LIBS) -o $@
+
+# Add to "devtools" target
+devtools: $(GFXBENCH)
+
+# Pseudo target for comfort, allows for "make devtools/gfxbench"
+devtools/gfxbench: $(GFXBENCH)
+
+clean-devtools: clean-devtools/gfxbench
+clean-devtools/gfxbench:
+	-$(RM) devtools/gfxbench/gfxbench.o $(GFXBENCH)
+
+.PHONY: devtools/gfxbench clean-devtools/gfxbench
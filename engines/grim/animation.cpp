@@ -20,6 +20,10 @@
  *
  */
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #include "engines/grim/animation.h"
 #include "engines/grim/resource.h"
 #include "engines/grim/model.h"
@@ -195,7 +199,8 @@ void Animation::restoreState(SaveGame *state) {
  * @class AnimManager
  */
 
-AnimManager::AnimManager() {
+AnimManager::AnimManager() :
+	_poseHier(NULL), _poseNumNodes(0), _poseValid(false) {
 
 }
 
@@ -206,6 +211,7 @@ void AnimManager::addAnimation(Animation *anim, int priority1, int priority2) {
 	// with both priorities.
 	Common::List<AnimationEntry>::iterator i;
 	AnimationEntry entry;
+	_poseValid = false;
 	entry._anim = anim;
 	entry._priority = priority1;
 	entry._tagged = false;
@@ -232,6 +238,7 @@ void AnimManager::addAnimation(Animation *anim, int priority1, int priority2) {
 
 void AnimManager::removeAnimation(Animation *anim) {
 	Common::List<AnimationEntry>::iterator i;
+	_poseValid = false;
 	for (i = _activeAnims.begin(); i != _activeAnims.end(); ++i) {
 		if (i->_anim == anim) {
 			i = _activeAnims.erase(i);
@@ -240,55 +247,140 @@ void AnimManager::removeAnimation(Animation *anim) {
 	}
 }
 
-void AnimManager::animate(ModelNode *hier, int numNodes) {
-	// Apply animation to each hierarchy node separately.
+bool AnimManager::animate(ModelNode *hier, int numNodes) {
+	if (numNodes <= 0)
+		return false;
+
+	// Idle actors keep playing the same paused or finished animations, so
+	// check whether the result of the last call can be used again.
+	bool changed = !_poseValid || hier != _poseHier || numNodes != _poseNumNodes ||
+				   _poseInputs.size() != _activeAnims.size();
+	uint n = 0;
+	for (Common::List<AnimationEntry>::iterator j = _activeAnims.begin(); !changed && j != _activeAnims.end(); ++j, ++n) {
+		const PoseInput &input = _poseInputs[n];
+		changed = input._anim != j->_anim || input._time != j->_anim->_time || input._fade != j->_anim->_fade;
+	}
+
+	if (!changed) {
+		storePose(hier, numNodes);
+		return false;
+	}
+
+	_poseInputs.resize(_activeAnims.size());
+	n = 0;
+	for (Common::List<AnimationEntry>::iterator j = _activeAnims.begin(); j != _activeAnims.end(); ++j, ++n) {
+		_poseInputs[n]._anim = j->_anim;
+		_poseInputs[n]._time = j->_anim->_time;
+		_poseInputs[n]._fade = j->_anim->_fade;
+	}
+	_poseHier = hier;
+	_poseNumNodes = numNodes;
+	_poseValid = true;
+
+	// Sample every animation once for all the nodes. Each animation is in
+	// the list twice, for the untagged and for the tagged nodes.
+	for (Common::List<AnimationEntry>::iterator j = _activeAnims.begin(); j != _activeAnims.end(); ++j) {
+		if (j->_tagged)
+			continue;
+		Animation *anim = j->_anim;
+		anim->_pose.resize(numNodes * KeyframeAnim::kPoseSize);
+		anim->_keyframe->animate(hier, numNodes, anim->_time / 1000.0f, anim->_cursors, &anim->_pose[0]);
+	}
+
+	_layerPose.resize(numNodes * KeyframeAnim::kPoseSize);
+	_blendedPose.resize(numNodes * KeyframeAnim::kPoseSize);
+	_totalWeight.resize(numNodes);
+	_remainingWeight.resize(numNodes);
 	for (int i = 0; i < numNodes; i++) {
-		Math::Vector3d tempPos;
-		Math::Angle tempYaw = 0.0f, tempPitch = 0.0f, tempRoll = 0.0f;
-		float totalWeight = 0.0f;
-		float remainingWeight = 1.0f;
-		int currPriority = -1;
-
-		// The animations are layered so that animations with a higher priority
-		// are played regardless of the blend weights of lower priority animations.
-		// The highest priority layer gets as much weight as it wants, while the
-		// next layer gets the remaining amount and so on.
-		for (Common::List<AnimationEntry>::iterator j = _activeAnims.begin(); j != _activeAnims.end(); ++j) {
-			if (currPriority != j->_priority) {
-				currPriority = j->_priority;
-				remainingWeight *= 1 - totalWeight;
-				if (remainingWeight <= 0.0f)
-					break;
-
-				float weightFactor = 1.0f;
-				if (totalWeight > 1.0f) {
-					weightFactor = 1.0f / totalWeight;
-				}
-				tempPos += hier[i]._animPos * weightFactor;
-				tempYaw += hier[i]._animYaw * weightFactor;
-				tempPitch += hier[i]._animPitch * weightFactor;
-				tempRoll += hier[i]._animRoll * weightFactor;
-				hier[i]._animPos.set(0,0,0);
-				hier[i]._animYaw = 0.0f;
-				hier[i]._animPitch = 0.0f;
-				hier[i]._animRoll = 0.0f;
-				totalWeight = 0.0f;
-			}
+		float *layer = &_layerPose[i * KeyframeAnim::kPoseSize];
+		float *blended = &_blendedPose[i * KeyframeAnim::kPoseSize];
+		for (int k = 0; k < KeyframeAnim::kPoseSize; k++) {
+			layer[k] = 0.f;
+			blended[k] = 0.f;
+		}
+		_totalWeight[i] = 0.f;
+		_remainingWeight[i] = 1.f;
+	}
 
-			float time = j->_anim->_time / 1000.0f;
-			float weight = j->_anim->_fade * remainingWeight;
-			if (j->_anim->_keyframe->animate(hier, i, time, weight, j->_tagged))
-				totalWeight += j->_anim->_fade;
+	// The animations are layered so that animations with a higher priority
+	// are played regardless of the blend weights of lower priority animations.
+	// The highest priority layer gets as much weight as it wants, while the
+	// next layer gets the remaining amount and so on.
+	int currPriority = -1;
+	for (Common::List<AnimationEntry>::iterator j = _activeAnims.begin(); j != _activeAnims.end(); ++j) {
+		if (currPriority != j->_priority) {
+			currPriority = j->_priority;
+			beginLayer(numNodes);
 		}
+		addPose(*j, numNodes);
+	}
+	beginLayer(numNodes);
+
+	storePose(hier, numNodes);
+	return true;
+}
+
+void AnimManager::storePose(ModelNode *hier, int numNodes) const {
+	for (int i = 0; i < numNodes; i++) {
+		const float *blended = &_blendedPose[i * KeyframeAnim::kPoseSize];
+		hier[i]._animPos.set(blended[KeyframeAnim::kPosePos + 0], blended[KeyframeAnim::kPosePos + 1],
+							 blended[KeyframeAnim::kPosePos + 2]);
+		hier[i]._animPitch = blended[KeyframeAnim::kPosePitch];
+		hier[i]._animYaw = blended[KeyframeAnim::kPoseYaw];
+		hier[i]._animRoll = blended[KeyframeAnim::kPoseRoll];
+	}
+}
+
+void AnimManager::beginLayer(int numNodes) {
+	float *layer = &_layerPose[0];
+	float *blended = &_blendedPose[0];
+	for (int i = 0; i < numNodes; i++) {
+		float totalWeight = _totalWeight[i];
+		// Once a node has no weight left the lower layers add nothing to it
+		_remainingWeight[i] *= 1 - totalWeight;
 
 		float weightFactor = 1.0f;
 		if (totalWeight > 1.0f) {
 			weightFactor = 1.0f / totalWeight;
 		}
-		hier[i]._animPos = hier[i]._animPos * weightFactor + tempPos;
-		hier[i]._animYaw = hier[i]._animYaw * weightFactor + tempYaw;
-		hier[i]._animPitch = hier[i]._animPitch * weightFactor + tempPitch;
-		hier[i]._animRoll = hier[i]._animRoll * weightFactor + tempRoll;
+#if defined(__SSE__)
+		__m128 factor = _mm_set1_ps(weightFactor);
+		_mm_storeu_ps(blended, _mm_add_ps(_mm_loadu_ps(blended), _mm_mul_ps(_mm_loadu_ps(layer), factor)));
+		_mm_storeu_ps(blended + 4, _mm_add_ps(_mm_loadu_ps(blended + 4), _mm_mul_ps(_mm_loadu_ps(layer + 4), factor)));
+		_mm_storeu_ps(layer, _mm_setzero_ps());
+		_mm_storeu_ps(layer + 4, _mm_setzero_ps());
+#else
+		for (int k = 0; k < KeyframeAnim::kPoseSize; k++) {
+			blended[k] += layer[k] * weightFactor;
+			layer[k] = 0.f;
+		}
+#endif
+		_totalWeight[i] = 0.f;
+		layer += KeyframeAnim::kPoseSize;
+		blended += KeyframeAnim::kPoseSize;
+	}
+}
+
+void AnimManager::addPose(const AnimationEntry &entry, int numNodes) {
+	const float *pose = &entry._anim->_pose[0];
+	float *layer = &_layerPose[0];
+	float fade = entry._anim->_fade;
+	int flag = entry._tagged ? KeyframeAnim::kPoseTagged : KeyframeAnim::kPoseUntagged;
+	for (int i = 0; i < numNodes; i++) {
+		if (pose[flag] != 0.f && _remainingWeight[i] > 0.0f) {
+			float weight = fade * _remainingWeight[i];
+#if defined(__SSE__)
+			__m128 w = _mm_set1_ps(weight);
+			_mm_storeu_ps(layer, _mm_add_ps(_mm_loadu_ps(layer), _mm_mul_ps(_mm_loadu_ps(pose), w)));
+			_mm_storeu_ps(layer + 4, _mm_add_ps(_mm_loadu_ps(layer + 4), _mm_mul_ps(_mm_loadu_ps(pose + 4), w)));
+#else
+			for (int k = 0; k < KeyframeAnim::kPoseSize; k++)
+				layer[k] += pose[k] * weight;
+#endif
+			_totalWeight[i] += fade;
+		}
+		pose += KeyframeAnim::kPoseSize;
+		layer += KeyframeAnim::kPoseSize;
 	}
 }
 
@@ -72,6 +72,9 @@ private:
 	RepeatMode _repeatMode;
 	FadeMode _fadeMode;
 	int _fadeLength;
+	// Playback cursors and sampled pose used by AnimManager::animate()
+	Common::Array<int> _cursors;
+	Common::Array<float> _pose;
 
 	friend class AnimManager;
 };
@@ -82,7 +85,15 @@ public:
 	void addAnimation(Animation *anim, int pr1, int pr2);
 	void removeAnimation(Animation *anim);
 
-	void animate(ModelNode *hier, int numNodes);
+	/**
+	 * Sets the _animPos, _animPitch, _animYaw and _animRoll fields of the
+	 * nodes to the blend of the active animations. When the nodes, the
+	 * animations and their times and fades are the same as in the previous
+	 * call the previous result is written back without sampling again.
+	 *
+	 * @return true if the pose was evaluated again, false if it was reused
+	 */
+	bool animate(ModelNode *hier, int numNodes);
 
 private:
 	struct AnimationEntry {
@@ -91,7 +102,30 @@ private:
 		bool _tagged;
 	};
 
+	void beginLayer(int numNodes);
+	void addPose(const AnimationEntry &entry, int numNodes);
+	void storePose(ModelNode *hier, int numNodes) const;
+
 	Common::List<AnimationEntry> _activeAnims;
+
+	// The inputs of the last animate() call, to detect unchanged poses
+	struct PoseInput {
+		Animation *_anim;
+		int _time;
+		float _fade;
+	};
+	Common::Array<PoseInput> _poseInputs;
+	ModelNode *_poseHier;
+	int _poseNumNodes;
+	bool _poseValid;
+
+	// Per node blending state of animate(): the pose accumulated for the
+	// current priority layer and for the layers above it, both of
+	// KeyframeAnim::kPoseSize floats per node, and the weights.
+	Common::Array<float> _layerPose;
+	Common::Array<float> _blendedPose;
+	Common::Array<float> _totalWeight;
+	Common::Array<float> _remainingWeight;
 };
 
 }
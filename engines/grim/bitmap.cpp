@@ -25,6 +25,20 @@
 #include "common/endian.h"
 #include "common/zlib.h"
 #include "common/memstream.h"
+#include "common/config-manager.h"
+#include "common/file.h"
+#include "common/fs.h"
+#include "common/system.h"
+
+#if defined(USE_SIMD) && defined(__SSE2__)
+#define GRIM_SIMD_CONVERTERS
+#define GRIM_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(USE_SIMD) && defined(__ARM_NEON)
+#define GRIM_SIMD_CONVERTERS
+#define GRIM_SIMD_NEON
+#include <arm_neon.h>
+#endif
 
 #include "engines/grim/debug.h"
 #include "engines/grim/grim.h"
@@ -39,6 +53,28 @@ static void decompress_codec3(const char *compressed, char *result);
 
 Common::HashMap<Common::String, BitmapData *> *BitmapData::_bitmaps = NULL;
 
+#define BITMAPCACHE_TAG		MKTAG('B','M','C','H')
+#define BITMAPCACHE_VERSION	1
+
+// With the "bitmap_cache_path" key naming a directory, bitmaps are stored
+// there uncompressed, in a file per LAB entry, once converted by the
+// renderer. The file is only used while the entry and the renderer format
+// are the same.
+static bool getBitmapCacheNode(const Common::String &fname, Common::FSNode &node, Common::String &labName, int &offset, int &len) {
+	if (!ConfMan.hasKey("bitmap_cache_path"))
+		return false;
+	if (!g_driver->getNativeBitmapFormat() || !g_resourceloader)
+		return false;
+	if (!g_resourceloader->getLabEntry(fname, labName, offset, len))
+		return false;
+
+	Common::FSNode dir(ConfMan.get("bitmap_cache_path"));
+	if (!dir.isDirectory())
+		return false;
+	node = dir.getChild(Common::String::format("%s-%s-%s.bmc", ConfMan.getActiveDomainName().c_str(), labName.c_str(), fname.c_str()));
+	return true;
+}
+
 // Helper function for makeBitmapFromTile
 char *getLine(int lineNum, char *data, unsigned int width, int bpp) {
 	return data + (lineNum *(width * bpp));
@@ -113,6 +149,11 @@ BitmapData *BitmapData::getBitmapData(const Common::String &fname, const char *d
 BitmapData::BitmapData(const Common::String &fname, const char *data, int len) {
 	_fname = fname;
 	_refCount = 1;
+	if (loadCached()) {
+		g_driver->createBitmap(this);
+		return;
+	}
+
 	if (len > 4 && memcmp(data, "\x1f\x8b\x08\0", 4) == 0) {
 		loadTile(data, len);
 		return;
@@ -160,9 +201,42 @@ BitmapData::BitmapData(const Common::String &fname, const char *data, int len) {
 #endif
 	}
 
+	g_driver->prepareBitmap(this);
+	saveCached();
 	g_driver->createBitmap(this);
 }
 
+char *BitmapData::uncompressCodec3(const char *data, int len, int &newLen) {
+	if (len < 0x88 || memcmp(data, "BM  F\0\0\0", 8) != 0 || READ_LE_UINT32(data + 8) != 3)
+		return NULL;
+
+	int numImages = READ_LE_UINT32(data + 16);
+	int size = READ_LE_UINT32(data + 36) / 8 * READ_LE_UINT32(data + 128) * READ_LE_UINT32(data + 132);
+	if (numImages <= 0 || size <= 0)
+		return NULL;
+
+	// Every image is followed by 8 bytes, as in codec 0 files
+	newLen = 0x88 + numImages * (size + 8);
+	char *result = new char[newLen];
+	memcpy(result, data, 0x88);
+	WRITE_LE_UINT32(result + 8, 0);
+
+	int pos = 0x88;
+	char *image = result + 0x88;
+	for (int i = 0; i < numImages; i++) {
+		if (pos + 4 > len) {
+			delete[] result;
+			return NULL;
+		}
+		int compressed_len = READ_LE_UINT32(data + pos);
+		decompress_codec3(data + pos + 4, image);
+		memset(image + size, 0, 8);
+		image += size + 8;
+		pos += compressed_len + 12;
+	}
+	return result;
+}
+
 BitmapData::BitmapData(const char *data, int w, int h, int bpp, const char *fname) {
 	_fname = fname;
 	_refCount = 1;
@@ -183,6 +257,7 @@ BitmapData::BitmapData(const char *data, int w, int h, int bpp, const char *fnam
 	_data[0] = new char[_bpp / 8 * _width * _height];
 	memcpy(_data[0], data, _bpp / 8 * _width * _height);
 
+	g_driver->prepareBitmap(this);
 	g_driver->createBitmap(this);
 }
 
@@ -265,11 +340,109 @@ bool BitmapData::loadTile(const char *data, int len) {
 		_colorFormat = BM_RGBA;
 	}
 
+	g_driver->prepareBitmap(this);
 	g_driver->createBitmap(this);
 	return true;
 #endif // ENABLE_MONKEY4
 }
 
+bool BitmapData::loadCached() {
+	Common::FSNode node;
+	Common::String labName;
+	int offset, len;
+	if (!getBitmapCacheNode(_fname, node, labName, offset, len) || !node.exists())
+		return false;
+
+	Common::SeekableReadStream *in = node.createReadStream();
+	if (!in)
+		return false;
+
+	if (in->readUint32BE() != BITMAPCACHE_TAG || in->readUint32LE() != BITMAPCACHE_VERSION ||
+		in->readUint32LE() != (uint32)g_grim->getGameType() || in->readUint32LE() != g_driver->getNativeBitmapFormat() ||
+		in->readSint32LE() != offset || in->readSint32LE() != len || in->readUint32LE() != labName.size()) {
+		delete in;
+		return false;
+	}
+	Common::String name;
+	for (uint i = 0; i < labName.size(); i++)
+		name += (char)in->readByte();
+
+	_numImages = in->readSint32LE();
+	_x = in->readSint32LE();
+	_y = in->readSint32LE();
+	_format = in->readSint32LE();
+	_bpp = in->readSint32LE();
+	_width = in->readSint32LE();
+	_height = in->readSint32LE();
+	_colorFormat = in->readSint32LE();
+	_hasTransparency = in->readByte() != 0;
+	_numTex = 0;
+	_texIds = NULL;
+	if (in->eos() || !name.equalsIgnoreCase(labName) || _numImages <= 0 || _width <= 0 || _height <= 0 ||
+		_colorFormat != BM_RGB565 || _bpp != 16) {
+		delete in;
+		return false;
+	}
+
+	int size = _bpp / 8 * _width * _height;
+	_data = new char *[_numImages];
+	for (int i = 0; i < _numImages; i++) {
+		_data[i] = new char[size];
+		in->read(_data[i], size);
+	}
+	bool ok = !in->eos() && !in->err();
+	delete in;
+	if (!ok) {
+		for (int i = 0; i < _numImages; i++)
+			delete[] _data[i];
+		delete[] _data;
+		_data = NULL;
+		warning("Bad bitmap cache entry %s", node.getPath().c_str());
+	}
+	return ok;
+}
+
+void BitmapData::saveCached() const {
+	Common::FSNode node;
+	Common::String labName;
+	int offset, len;
+	// Only the first image of a bitmap gets its color format converted,
+	// so only bitmaps that were RGB565 all along are stored
+	if (_colorFormat != BM_RGB565 || _bpp != 16)
+		return;
+	if (!getBitmapCacheNode(_fname, node, labName, offset, len))
+		return;
+
+	Common::DumpFile out;
+	if (!out.open(node))
+		return;
+
+	out.writeUint32BE(BITMAPCACHE_TAG);
+	out.writeUint32LE(BITMAPCACHE_VERSION);
+	out.writeUint32LE(g_grim->getGameType());
+	out.writeUint32LE(g_driver->getNativeBitmapFormat());
+	out.writeSint32LE(offset);
+	out.writeSint32LE(len);
+	out.writeUint32LE(labName.size());
+	out.write(labName.c_str(), labName.size());
+
+	out.writeSint32LE(_numImages);
+	out.writeSint32LE(_x);
+	out.writeSint32LE(_y);
+	out.writeSint32LE(_format);
+	out.writeSint32LE(_bpp);
+	out.writeSint32LE(_width);
+	out.writeSint32LE(_height);
+	out.writeSint32LE(_colorFormat);
+	out.writeByte(_hasTransparency);
+	for (int i = 0; i < _numImages; i++)
+		out.write(_data[i], _bpp / 8 * _width * _height);
+
+	out.finalize();
+	if (out.err())
+		warning("Could not write the bitmap cache entry %s", node.getPath().c_str());
+}
+
 char *BitmapData::getImageData(int num) const {
 	return _data[num];
 }
@@ -343,101 +516,243 @@ Bitmap::~Bitmap() {
 	freeData();
 }
 
+// Pixel format converters. 16 bit pixels are in native byte order, RGBA
+// is one byte per channel. The SSE2 and NEON versions handle 8 pixels at
+// a time and leave the rest to the scalar loop.
+
+// Whether the SIMD converters can run on this CPU.
+static bool hasSimdConverters() {
+#if !defined(GRIM_SIMD_CONVERTERS)
+	return false;
+#elif defined(GRIM_SIMD_NEON) || defined(__x86_64__) || defined(_M_X64)
+	return true;
+#else
+	return g_system->hasFeature(OSystem::kFeatureCpuSSE2);
+#endif
+}
+
+static inline void expand5(uint v, byte *to) {
+	*to = v << 3 | v >> 2;
+}
+
+static void convert1555ToRGBA(const uint16 *from, byte *to, int n, bool simd) {
+	int i = 0;
+#if defined(GRIM_SIMD_SSE2)
+	if (simd) {
+		const __m128i mask5 = _mm_set1_epi16(0x1f);
+		for (; i + 8 <= n; i += 8, to += 32) {
+			__m128i p = _mm_loadu_si128((const __m128i *)(from + i));
+			__m128i r = _mm_and_si128(p, mask5);
+			__m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask5);
+			__m128i b = _mm_and_si128(_mm_srli_epi16(p, 10), mask5);
+			r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+			g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+			b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+			__m128i a = _mm_srai_epi16(p, 15);
+			__m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+			__m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+			_mm_storeu_si128((__m128i *)to, _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128((__m128i *)(to + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+	}
+#elif defined(GRIM_SIMD_NEON)
+	if (simd) {
+		const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+		for (; i + 8 <= n; i += 8, to += 32) {
+			uint16x8_t p = vld1q_u16(from + i);
+			uint16x8_t r = vandq_u16(p, mask5);
+			uint16x8_t g = vandq_u16(vshrq_n_u16(p, 5), mask5);
+			uint16x8_t b = vandq_u16(vshrq_n_u16(p, 10), mask5);
+			uint8x8x4_t rgba;
+			rgba.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2)));
+			rgba.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(g, 3), vshrq_n_u16(g, 2)));
+			rgba.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2)));
+			rgba.val[3] = vmovn_u16(vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(p), 15)));
+			vst4_u8(to, rgba);
+		}
+	}
+#endif
+	for (; i < n; i++, to += 4) {
+		uint pixel = from[i];
+		// Alpha, then 555 (BGR).
+		expand5((pixel >> 10) & 0x1f, to + 2);
+		expand5((pixel >> 5) & 0x1f, to + 1);
+		expand5(pixel & 0x1f, to);
+		to[3] = (pixel & 0x8000) ? 255 : 0;
+	}
+}
+
+// Gives the same colors as going through RGBA, the alpha bit is dropped
+static void convert1555To565(const uint16 *from, uint16 *to, int n, bool simd) {
+	int i = 0;
+#if defined(GRIM_SIMD_SSE2)
+	if (simd) {
+		const __m128i mask5 = _mm_set1_epi16(0x1f);
+		for (; i + 8 <= n; i += 8) {
+			__m128i p = _mm_loadu_si128((const __m128i *)(from + i));
+			__m128i r = _mm_slli_epi16(p, 11);
+			__m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask5);
+			__m128i b = _mm_and_si128(_mm_srli_epi16(p, 10), mask5);
+			g = _mm_slli_epi16(_mm_or_si128(_mm_slli_epi16(g, 1), _mm_srli_epi16(g, 4)), 5);
+			_mm_storeu_si128((__m128i *)(to + i), _mm_or_si128(_mm_or_si128(r, g), b));
+		}
+	}
+#elif defined(GRIM_SIMD_NEON)
+	if (simd) {
+		const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+		for (; i + 8 <= n; i += 8) {
+			uint16x8_t p = vld1q_u16(from + i);
+			uint16x8_t r = vshlq_n_u16(p, 11);
+			uint16x8_t g = vandq_u16(vshrq_n_u16(p, 5), mask5);
+			uint16x8_t b = vandq_u16(vshrq_n_u16(p, 10), mask5);
+			g = vshlq_n_u16(vorrq_u16(vshlq_n_u16(g, 1), vshrq_n_u16(g, 4)), 5);
+			vst1q_u16(to + i, vorrq_u16(vorrq_u16(r, g), b));
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		uint pixel = from[i];
+		uint red = pixel & 0x1f;
+		uint green = (pixel >> 5) & 0x1f;
+		uint blue = (pixel >> 10) & 0x1f;
+		to[i] = (red << 11) | ((green << 1 | green >> 4) << 5) | blue;
+	}
+}
+
+static void convertRGBATo565(const byte *from, uint16 *to, int n, bool simd) {
+	int i = 0;
+#if defined(GRIM_SIMD_SSE2)
+	if (simd) {
+		for (; i + 8 <= n; i += 8, from += 32) {
+			__m128i lo = _mm_loadu_si128((const __m128i *)from);
+			__m128i hi = _mm_loadu_si128((const __m128i *)(from + 16));
+			lo = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(lo, _mm_set1_epi32(0xf8)), 8),
+										   _mm_and_si128(_mm_srli_epi32(lo, 5), _mm_set1_epi32(0x7e0))),
+							  _mm_and_si128(_mm_srli_epi32(lo, 19), _mm_set1_epi32(0x1f)));
+			hi = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(hi, _mm_set1_epi32(0xf8)), 8),
+										   _mm_and_si128(_mm_srli_epi32(hi, 5), _mm_set1_epi32(0x7e0))),
+							  _mm_and_si128(_mm_srli_epi32(hi, 19), _mm_set1_epi32(0x1f)));
+			// sign extend, so that the saturating pack keeps all 16 bits
+			lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+			hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+			_mm_storeu_si128((__m128i *)(to + i), _mm_packs_epi32(lo, hi));
+		}
+	}
+#elif defined(GRIM_SIMD_NEON)
+	if (simd) {
+		for (; i + 8 <= n; i += 8, from += 32) {
+			uint8x8x4_t p = vld4_u8(from);
+			uint16x8_t r = vshlq_n_u16(vmovl_u8(vshr_n_u8(p.val[0], 3)), 11);
+			uint16x8_t g = vshlq_n_u16(vmovl_u8(vshr_n_u8(p.val[1], 2)), 5);
+			uint16x8_t b = vmovl_u8(vshr_n_u8(p.val[2], 3));
+			vst1q_u16(to + i, vorrq_u16(vorrq_u16(r, g), b));
+		}
+	}
+#endif
+	for (; i < n; i++, from += 4)
+		to[i] = ((from[0] >> 3) << 11) | ((from[1] >> 2) << 5) | (from[2] >> 3);
+}
+
+// Returns true if a pixel has the transparent color
+static bool convert565ToRGBA(const uint16 *from, byte *to, int n, bool simd) {
+	bool transparent = false;
+	int i = 0;
+#if defined(GRIM_SIMD_SSE2)
+	if (simd) {
+		const __m128i key = _mm_set1_epi16((short)0xf81f);
+		__m128i keyed = _mm_setzero_si128();
+		for (; i + 8 <= n; i += 8, to += 32) {
+			__m128i p = _mm_loadu_si128((const __m128i *)(from + i));
+			__m128i r = _mm_srli_epi16(p, 11);
+			__m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), _mm_set1_epi16(0x3f));
+			__m128i b = _mm_and_si128(p, _mm_set1_epi16(0x1f));
+			r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+			g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+			b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+			__m128i k = _mm_cmpeq_epi16(p, key);
+			keyed = _mm_or_si128(keyed, k);
+			__m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+			__m128i ba = _mm_or_si128(b, _mm_slli_epi16(_mm_andnot_si128(k, _mm_set1_epi16(0xff)), 8));
+			_mm_storeu_si128((__m128i *)to, _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128((__m128i *)(to + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+		transparent = _mm_movemask_epi8(keyed) != 0;
+	}
+#elif defined(GRIM_SIMD_NEON)
+	if (simd) {
+		const uint16x8_t key = vdupq_n_u16(0xf81f);
+		uint16x8_t keyed = vdupq_n_u16(0);
+		for (; i + 8 <= n; i += 8, to += 32) {
+			uint16x8_t p = vld1q_u16(from + i);
+			uint16x8_t r = vshrq_n_u16(p, 11);
+			uint16x8_t g = vandq_u16(vshrq_n_u16(p, 5), vdupq_n_u16(0x3f));
+			uint16x8_t b = vandq_u16(p, vdupq_n_u16(0x1f));
+			uint16x8_t k = vceqq_u16(p, key);
+			keyed = vorrq_u16(keyed, k);
+			uint8x8x4_t rgba;
+			rgba.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2)));
+			rgba.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4)));
+			rgba.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2)));
+			rgba.val[3] = vmovn_u16(vmvnq_u16(k));
+			vst4_u8(to, rgba);
+		}
+		uint16x4_t any = vorr_u16(vget_low_u16(keyed), vget_high_u16(keyed));
+		transparent = vget_lane_u64(vreinterpret_u64_u16(any), 0) != 0;
+	}
+#endif
+	for (; i < n; i++, to += 4) {
+		uint16 pixel = from[i];
+		int r = pixel >> 11;
+		to[0] = (r << 3) | (r >> 2);
+		int g = (pixel >> 5) & 0x3f;
+		to[1] = (g << 2) | (g >> 4);
+		int b = pixel & 0x1f;
+		to[2] = (b << 3) | (b >> 2);
+		if (pixel == 0xf81f) { // transparent
+			to[3] = 0;
+			transparent = true;
+		} else {
+			to[3] = 255;
+		}
+	}
+	return transparent;
+}
+
 void BitmapData::convertToColorFormat(int num, int format) {
-	// Supports 1555->RGBA, RGBA->565
-	unsigned char red = 0, green = 0, blue = 0, alpha = 0;
-	int size = _width * _height * (_bpp / 8);
+	// Supports 1555->RGBA, 1555->565, RGBA->565, 565->RGBA
+	int n = _width * _height;
+	bool simd = hasSimdConverters();
 	if (_colorFormat == BM_RGB1555) {
-		uint16 *bitmapData = reinterpret_cast<uint16 *>(_data[num]);
+		const uint16 *bitmapData = reinterpret_cast<const uint16 *>(_data[num]);
 
 		if (format == BM_RGBA && _bpp == 16) {
 			// Convert data to 32-bit RGBA format
-			char *newData = new char[_width * _height * 4];
-			char *to = newData;
-
-			for (int i = 0; i< _height * _width; i++, bitmapData++, to += 4) {
-				uint pixel = *bitmapData;
-				// Alpha, then 555 (BGR).
-				blue = (pixel >> 10) & 0x1f;
-				to[2] = blue << 3 | blue >> 2;
-				green = (pixel >> 5) & 0x1f;
-				to[1] = green << 3 | green >> 2;
-				red = (pixel & 0x1f);
-				to[0] = red << 3 | red >> 2;
-
-				if (pixel >> 15 & 1)
-					alpha = 255;
-				else
-					alpha = 0;
-				to[3] = alpha;
-			}
-			delete _data[num];
+			char *newData = new char[n * 4];
+			convert1555ToRGBA(bitmapData, (byte *)newData, n, simd);
+			delete[] _data[num];
 			_data[num] = newData;
 			_colorFormat = BM_RGBA;
 			_bpp = 32;
-		} else if (format == BM_RGB565){ // 1555 -> 565 (Incomplete)
-			convertToColorFormat(num, BM_RGBA);
-			convertToColorFormat(num, BM_RGB565);
-			warning("Conversion 1555->565 done with 1555->RGBA->565");
-			return;
-			warning("Conversion 1555->565 is not properly implemented");
-			// This doesn't work properly, so falling back to double-conversion via RGBA for now.
-			uint16 *to = reinterpret_cast<uint16 *>(_data[num]);
-			for (int i = 1; i < _height * _width; i++, bitmapData++, to++) {
-				uint pixel = *bitmapData;
-				// Alpha, then 555.
-				if (to[0] & 128) { // Chroma key
-					to[0] = 0xf8;
-					to[1] = 0x1f;
-				} else {
-					blue = (pixel >> 10) & 0x1f;
-					//red = red << 3 | red >> 2;
-					green = (pixel >> 5) & 0x1f;
-					green = green << 1 | green >> 1;
-					red = (pixel) & 0x1f;
-					to[0] = (red << 3) | green >> 3;
-					to[1] = (green << 5) | blue;
-				}
-			}
+		} else if (format == BM_RGB565) {
+			convert1555To565(bitmapData, reinterpret_cast<uint16 *>(_data[num]), n, simd);
 			_colorFormat = BM_RGB565;
 		}
 	} else if (_colorFormat == BM_RGBA) {
 		if (format == BM_RGB565) { // RGBA->565
-			char* tempStore = _data[num];
-			char* newStore = new char[size / 2];
-			uint16 *to = reinterpret_cast<uint16 *>(newStore);
-			for(int j = 0; j < size;j += 4, to++){
-				red = (tempStore[j] >> 3) & 0x1f;
-				green = (tempStore[j + 1] >> 2) & 0x3f;
-				blue = (tempStore[j + 2] >> 3) &0x1f;
-				*to = (red << 11) | (green << 5) | blue;
-			}
-			delete[] tempStore;
+			char *newStore = new char[n * 2];
+			convertRGBATo565((const byte *)_data[num], reinterpret_cast<uint16 *>(newStore), n, simd);
+			delete[] _data[num];
 			_data[num] = newStore;
 			_colorFormat = BM_RGB565;
+			_bpp = 16;
 		}
 
 	} else if (_colorFormat == BM_RGB565) {
 		if (format == BM_RGBA && _bpp == 16) {
-			byte *tempData = new byte[4 * _width * _height];
 			// Convert data to 32-bit RGBA format
-			byte *tempDataPtr = tempData;
-			uint16 *bitmapData = reinterpret_cast<uint16 *>(_data[num]);
-			for (int i = 0; i < _width * _height; i++, tempDataPtr += 4, bitmapData++) {
-				uint16 pixel = *bitmapData;
-				int r = pixel >> 11;
-				tempDataPtr[0] = (r << 3) | (r >> 2);
-				int g = (pixel >> 5) & 0x3f;
-				tempDataPtr[1] = (g << 2) | (g >> 4);
-				int b = pixel & 0x1f;
-				tempDataPtr[2] = (b << 3) | (b >> 2);
-				if (pixel == 0xf81f) { // transparent
-					tempDataPtr[3] = 0;
-					_hasTransparency = true;
-				} else {
-					tempDataPtr[3] = 255;
-				}
-			}
+			byte *tempData = new byte[4 * n];
+			if (convert565ToRGBA(reinterpret_cast<const uint16 *>(_data[num]), tempData, n, simd))
+				_hasTransparency = true;
 			delete[] _data[num];
 			_data[num] = (char *)tempData;
 			_colorFormat = BM_RGBA;
@@ -458,42 +773,213 @@ void BitmapData::convertToColorFormat(int num, int format) {
 	} \
 } while (0)
 
+// Copies a match, which may overlap what it produces
+static inline void copy_match(char *result, int copy_offset, int copy_len) {
+	const char *from = result + copy_offset;
+	if (-copy_offset >= copy_len) {
+		memcpy(result, from, copy_len);
+	} else if (copy_offset == -1) {
+		memset(result, *from, copy_len);
+	} else {
+		while (copy_len > 0) {
+			*result++ = *from++;
+			copy_len--;
+		}
+	}
+}
+
 static void decompress_codec3(const char *compressed, char *result) {
+	// The control bits come in 16 bit words mixed with the data bytes, a
+	// word being read as soon as the previous one is used up. While more
+	// bits are buffered than a token takes, tokens are decoded from the
+	// buffer directly, and runs of literals are copied at once.
 	int bitstr_value = READ_LE_UINT16(compressed);
 	int bitstr_len = 16;
 	compressed += 2;
 	bool bit;
 
 	for (;;) {
-		GET_BIT;
-		if (bit == 1)
-			*result++ = *compressed++;
-		else {
+		int copy_len, copy_offset;
+		if (bitstr_len > 4) {
+			if (bitstr_value & 1) {
+				int run = 1;
+				while (run < bitstr_len - 1 && ((bitstr_value >> run) & 1))
+					run++;
+				memcpy(result, compressed, run);
+				result += run;
+				compressed += run;
+				bitstr_value >>= run;
+				bitstr_len -= run;
+				continue;
+			}
+			if (!(bitstr_value & 2)) {
+				copy_len = 2 * ((bitstr_value >> 2) & 1) + ((bitstr_value >> 3) & 1) + 3;
+				bitstr_value >>= 4;
+				bitstr_len -= 4;
+				copy_offset = *(const uint8 *)(compressed++) - 0x100;
+				copy_match(result, copy_offset, copy_len);
+				result += copy_len;
+				continue;
+			}
+			bitstr_value >>= 2;
+			bitstr_len -= 2;
+		} else {
+			GET_BIT;
+			if (bit == 1) {
+				*result++ = *compressed++;
+				continue;
+			}
 			GET_BIT;
-			int copy_len, copy_offset;
 			if (bit == 0) {
 				GET_BIT;
 				copy_len = 2 * bit;
 				GET_BIT;
 				copy_len += bit + 3;
-				copy_offset = *(uint8 *)(compressed++) - 0x100;
-			} else {
-				copy_offset = (*(uint8 *)(compressed) | (*(uint8 *)(compressed + 1) & 0xf0) << 4) - 0x1000;
-				copy_len = (*(uint8 *)(compressed + 1) & 0xf) + 3;
-				compressed += 2;
-				if (copy_len == 3) {
-					copy_len = *(uint8 *)(compressed++) + 1;
-					if (copy_len == 1)
-						return;
+				copy_offset = *(const uint8 *)(compressed++) - 0x100;
+				copy_match(result, copy_offset, copy_len);
+				result += copy_len;
+				continue;
+			}
+		}
+
+		copy_offset = (*(const uint8 *)(compressed) | (*(const uint8 *)(compressed + 1) & 0xf0) << 4) - 0x1000;
+		copy_len = (*(const uint8 *)(compressed + 1) & 0xf) + 3;
+		compressed += 2;
+		if (copy_len == 3) {
+			copy_len = *(const uint8 *)(compressed++) + 1;
+			if (copy_len == 1)
+				return;
+		}
+		copy_match(result, copy_offset, copy_len);
+		result += copy_len;
+	}
+}
+
+void runBitmapBenchmark(int loops) {
+	Common::StringArray files;
+	g_resourceloader->listFiles(files, "*.bm");
+	g_resourceloader->listFiles(files, "*.zbm");
+
+	// Collect the codec 3 images and decode them once, the decoded images
+	// are the input of the converters
+	Common::Array<Block *> blocks;
+	Common::Array<const char *> compressed;
+	Common::Array<char *> images;
+	Common::Array<int> pixels;
+	int maxPixels = 0;
+	uint32 totalPixels = 0;
+	for (uint f = 0; f < files.size(); f++) {
+		Block *b = g_resourceloader->getFileBlock(files[f]);
+		if (!b)
+			continue;
+		const char *data = b->getData();
+		if (b->getLen() < 0x88 || memcmp(data, "BM  F\0\0\0", 8) != 0 || READ_LE_UINT32(data + 8) != 3 ||
+			READ_LE_UINT32(data + 36) != 16) {
+			delete b;
+			continue;
+		}
+		blocks.push_back(b);
+		int numImages = READ_LE_UINT32(data + 16);
+		int n = READ_LE_UINT32(data + 128) * READ_LE_UINT32(data + 132);
+		int pos = 0x88;
+		for (int i = 0; i < numImages; i++) {
+			char *image = new char[n * 2];
+			decompress_codec3(data + pos + 4, image);
+			compressed.push_back(data + pos + 4);
+			images.push_back(image);
+			pixels.push_back(n);
+			totalPixels += n;
+			pos += READ_LE_UINT32(data + pos) + 12;
+		}
+		maxPixels = MAX(maxPixels, n);
+	}
+	if (images.empty()) {
+		warning("runBitmapBenchmark: no codec 3 bitmap found");
+		return;
+	}
+	debug("runBitmapBenchmark: %d bitmaps, %d images, %.1f Mpixels, %d loops",
+		  blocks.size(), images.size(), totalPixels / 1000000.0, loops);
+
+	char *decoded = new char[maxPixels * 2];
+	uint32 start = g_system->getMillis();
+	for (int l = 0; l < loops; l++) {
+		for (uint i = 0; i < images.size(); i++)
+			decompress_codec3(compressed[i], decoded);
+	}
+	uint32 time = MAX<uint32>(g_system->getMillis() - start, 1);
+	debug("%-18s %8.2f MB/s", "codec 3", totalPixels * 2.0 * loops / 1000.0 / time);
+
+	static const char *converters[] = { "1555 -> RGBA", "1555 -> 565", "565 -> RGBA", "RGBA -> 565" };
+#if defined(GRIM_SIMD_NEON)
+	static const char *simdName = "neon";
+#else
+	static const char *simdName = "sse2";
+#endif
+	byte *rgba = new byte[maxPixels * 4];
+	byte *rgbaRef = new byte[maxPixels * 4];
+	uint16 *rgb = new uint16[maxPixels];
+	uint16 *rgbRef = new uint16[maxPixels];
+	for (int simd = 0; simd < 2; simd++) {
+		if (simd && !hasSimdConverters())
+			break;
+		for (int c = 0; c < ARRAYSIZE(converters); c++) {
+			start = g_system->getMillis();
+			for (int l = 0; l < loops; l++) {
+				for (uint i = 0; i < images.size(); i++) {
+					const uint16 *from = reinterpret_cast<const uint16 *>(images[i]);
+					switch (c) {
+					case 0:
+						convert1555ToRGBA(from, rgba, pixels[i], simd);
+						break;
+					case 1:
+						convert1555To565(from, rgb, pixels[i], simd);
+						break;
+					case 2:
+						convert565ToRGBA(from, rgba, pixels[i], simd);
+						break;
+					default:
+						// The images stand in for RGBA data of half the size
+						convertRGBATo565((const byte *)images[i], rgb, pixels[i] / 2, simd);
+						break;
+					}
 				}
 			}
-			while (copy_len > 0) {
-				*result = result[copy_offset];
-				result++;
-				copy_len--;
+			time = MAX<uint32>(g_system->getMillis() - start, 1);
+			debug("%-18s %-6s %8.2f Mpixels/s", converters[c], simd ? simdName : "scalar",
+				  (c == 3 ? totalPixels / 2 : totalPixels) * (double)loops / 1000.0 / time);
+		}
+
+		if (simd) {
+			// Both versions have to agree on every image
+			for (uint i = 0; i < images.size(); i++) {
+				const uint16 *from = reinterpret_cast<const uint16 *>(images[i]);
+				int n = pixels[i];
+				convert1555ToRGBA(from, rgba, n, true);
+				convert1555ToRGBA(from, rgbaRef, n, false);
+				bool same = memcmp(rgba, rgbaRef, n * 4) == 0;
+				convert1555To565(from, rgb, n, true);
+				convert1555To565(from, rgbRef, n, false);
+				same = same && memcmp(rgb, rgbRef, n * 2) == 0;
+				same = same && convert565ToRGBA(from, rgba, n, true) == convert565ToRGBA(from, rgbaRef, n, false);
+				same = same && memcmp(rgba, rgbaRef, n * 4) == 0;
+				convertRGBATo565((const byte *)images[i], rgb, n / 2, true);
+				convertRGBATo565((const byte *)images[i], rgbRef, n / 2, false);
+				same = same && memcmp(rgb, rgbRef, n / 2 * 2) == 0;
+				if (!same)
+					warning("runBitmapBenchmark: the %s converters differ on image %d", simdName, i);
 			}
 		}
 	}
+
+	delete[] rgba;
+	delete[] rgbaRef;
+	delete[] rgb;
+	delete[] rgbRef;
+	delete[] decoded;
+	for (uint i = 0; i < images.size(); i++)
+		delete[] images[i];
+	for (uint i = 0; i < blocks.size(); i++)
+		delete blocks[i];
 }
 
 } // end of namespace Grim
@@ -50,6 +50,14 @@ public:
 	bool loadTile(const char *data, int len);
 
 	static BitmapData *getBitmapData(const Common::String &fname, const char *data, int len);
+	/**
+	 * Decompress the images of a codec 3 BM file, returning the same file
+	 * with codec 0 in a new[]'ed buffer. Does not touch the driver, so it
+	 * can run on a thread other than the main one.
+	 *
+	 * @return NULL if the data is not a codec 3 bitmap.
+	 */
+	static char *uncompressCodec3(const char *data, int len, int &newLen);
 	static Common::HashMap<Common::String, BitmapData *> *_bitmaps;
 
 	char *getImageData(int num) const;
@@ -77,6 +85,9 @@ public:
 	int _refCount;
 
 private:
+	bool loadCached();
+	void saveCached() const;
+
 	char **_data;
 };
 
@@ -118,6 +129,7 @@ public:
 	char *getData(int num) const { return _data->getImageData(num); }
 	char *getData() const { return getData(_currImage); }
 	void *getTexIds() const { return _data->_texIds; }
+	const BitmapData *getBitmapData() const { return _data; }
 	int getNumTex() const { return _data->_numTex; }
 
 	void saveState(SaveGame *state) const;
@@ -133,6 +145,15 @@ private:
 	int _x, _y;
 };
 
+/**
+ * Decodes every BM bitmap of the game data and converts the images
+ * between the color formats with the scalar and the SSE2 converters,
+ * then reports the throughput of each step.
+ *
+ * @param loops		how many times each bitmap is processed
+ */
+void runBitmapBenchmark(int loops);
+
 } // end of namespace Grim
 
 #endif
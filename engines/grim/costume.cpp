@@ -143,7 +143,7 @@ public:
 	ModelComponent(Costume::Component *parent, int parentID, const char *filename, Costume::Component *prevComponent, tag32 tag);
 	void init();
 	void setKey(int val);
-	void animate();
+	bool animate();
 	void reset();
 	void resetColormap();
 	void setMatrix(Math::Matrix4 matrix) { _matrix = matrix; };
@@ -411,16 +411,10 @@ AnimManager *ModelComponent::getAnimManager() const {
 	return _animation;
 }
 
-void ModelComponent::animate() {
-	// First reset the current animation.
-	for (int i = 0; i < getNumNodes(); i++) {
-		_hier[i]._animPos.set(0,0,0);
-		_hier[i]._animPitch = 0;
-		_hier[i]._animYaw = 0;
-		_hier[i]._animRoll = 0;
-	}
-
-	_animation->animate(_hier, getNumNodes());
+bool ModelComponent::animate() {
+	// The animation manager sets the pose of all the nodes, reusing the
+	// previous one when none of the animations moved.
+	return _animation->animate(_hier, getNumNodes());
 }
 
 void ModelComponent::resetColormap() {
@@ -875,6 +869,7 @@ Costume::Costume(const Common::String &fname, const char *data, int len, Costume
 	_joint3Node = NULL;
 	_headYaw = 0;
 	_headPitch = 0;
+	_poseDirty = true;
 	_prevCostume = prevCost;
 	if (g_grim->getGameType() == GType_MONKEY4) {
 		Common::MemoryReadStream ms((const byte *)data, len);
@@ -885,6 +880,35 @@ Costume::Costume(const Common::String &fname, const char *data, int len, Costume
 	}
 }
 
+// Queue the files of the components to be read by the resource loader
+// while the costume is being loaded, last one first like the setups of
+// a set (see Set::prefetchSetups).
+void Costume::prefetchComponents(TextSplitter &ts) {
+	static const char *exts[] = { ".3do", ".cmp", ".key", ".mat", ".bm" };
+	Common::StringArray names;
+
+	int componentsStart = ts.getLineNumber();
+	for (int i = 0; i < _numComponents && !ts.isEof(); i++) {
+		int id, tagID, hash, parentID, namePos;
+		const char *line = ts.getCurrentLine();
+		if (sscanf(line, " %d %d %d %d %n", &id, &tagID, &hash, &parentID, &namePos) >= 4) {
+			// Sprites append their geometry to the material name
+			const char *comma = strchr(line + namePos, ',');
+			Common::String name(line + namePos, comma ? comma : line + strlen(line));
+			for (int j = 0; j < ARRAYSIZE(exts); j++) {
+				if (name.hasSuffix(exts[j]) && g_resourceloader->getFileExists(name)) {
+					names.insert_at(0, name);
+					break;
+				}
+			}
+		}
+		ts.nextLine();
+	}
+	ts.setLineNumber(componentsStart);
+
+	g_resourceloader->prefetch(names);
+}
+
 void Costume::loadGRIM(TextSplitter &ts, Costume *prevCost) {
 	ts.expectString("costume v0.1");
 	ts.expectString("section tags");
@@ -906,6 +930,7 @@ void Costume::loadGRIM(TextSplitter &ts, Costume *prevCost) {
 	ts.expectString("section components");
 	ts.scanString(" numcomponents %d", 1, &_numComponents);
 	_components = new Component *[_numComponents];
+	prefetchComponents(ts);
 	for (int i = 0; i < _numComponents; i++) {
 		int id, tagID, hash, parentID, namePos;
 		const char *line = ts.getCurrentLine();
@@ -1541,9 +1566,11 @@ int Costume::update(float time) {
 }
 
 void Costume::animate() {
+	_poseDirty = false;
 	for (int i = 0; i < _numComponents; i++) {
 		if (_components[i]) {
-			_components[i]->animate();
+			if (_components[i]->animate())
+				_poseDirty = true;
 		}
 	}
 }
@@ -1553,6 +1580,9 @@ void Costume::moveHead(bool lookingMode, const Math::Vector3d &lookAt, float rat
 		float step = g_grim->getPerSecond(rate);
 		float yawStep = step;
 		float pitchStep = step / 3.f;
+		// The head offsets only change the pose when the head moves
+		float oldPitch = _headPitch.getDegrees();
+		float oldYaw = _headYaw.getDegrees();
 		if (!lookingMode) {
 			//animate yaw
 			if (_headYaw > yawStep) {
@@ -1582,6 +1612,8 @@ void Costume::moveHead(bool lookingMode, const Math::Vector3d &lookAt, float rat
 				_joint1Node->_animRoll = _head.maxRoll;
 			if (_joint1Node->_animRoll < -_head.maxRoll)
 				_joint1Node->_animRoll = -_head.maxRoll;
+			if (_headPitch.getDegrees() != oldPitch || _headYaw.getDegrees() != oldYaw)
+				_poseDirty = true;
 			return;
 		}
 
@@ -1594,6 +1626,7 @@ void Costume::moveHead(bool lookingMode, const Math::Vector3d &lookAt, float rat
 
 		Math::Vector3d v =  lookAt - _joint3Node->_matrix.getPosition();
 		if (v.isZero()) {
+			_poseDirty = true;
 			return;
 		}
 
@@ -1682,6 +1715,8 @@ void Costume::moveHead(bool lookingMode, const Math::Vector3d &lookAt, float rat
 
 		_headPitch = pitch;
 		_headYaw = _joint1Node->_animYaw;
+		if (_headPitch.getDegrees() != oldPitch || _headYaw.getDegrees() != oldYaw)
+			_poseDirty = true;
 	}
 }
 
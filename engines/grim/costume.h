@@ -47,6 +47,7 @@ public:
 
 	void loadGRIM(TextSplitter &ts, Costume *prevCost);
 	void loadEMI(Common::MemoryReadStream &ms, Costume *prevCost);
+	void prefetchComponents(TextSplitter &ts);
 
 	virtual ~Costume();
 
@@ -73,6 +74,12 @@ public:
 
 	int update(float frameTime);
 	void animate();
+	/**
+	 * Returns true if the last animate() or moveHead() changed the pose of
+	 * the nodes relative to the costume. When it is false the nodes and the
+	 * matrices evaluated from them are the same as in the previous frame.
+	 */
+	bool isPoseDirty() const { return _poseDirty; }
 	void setupTextures();
 	void draw();
 	void draw(int *x1, int *y1, int *x2, int *y2);
@@ -99,7 +106,8 @@ public:
 		virtual void setKey(int) { }
 		virtual void setMapName(char *) { }
 		virtual int update(float time) { return 0; }
-		virtual void animate() { }
+		// Returns true if the pose of the nodes changed
+		virtual bool animate() { return false; }
 		virtual void setupTexture() { }
 		virtual void draw(int *x1, int *y1, int *x2, int *y2) { }
 		virtual void reset() { }
@@ -196,6 +204,7 @@ private:
 
 	Math::Angle _headPitch;
 	Math::Angle _headYaw;
+	bool _poseDirty;
 };
 
 } // end of namespace Grim
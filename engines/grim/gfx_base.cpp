@@ -32,6 +32,17 @@ GfxBase::GfxBase() :
 
 }
 
+void GfxBase::prepareBitmap(BitmapData *bitmap) {
+}
+
+uint32 GfxBase::getNativeBitmapFormat() const {
+	return 0;
+}
+
+bool GfxBase::setMaterialColormap(Texture *material, const CMap *cmap) {
+	return false;
+}
+
 void GfxBase::saveState(SaveGame *state) {
 	state->beginSection('DRVR');
 
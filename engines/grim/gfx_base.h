@@ -87,6 +87,13 @@ public:
 	 */
 	virtual void flipBuffer() = 0;
 
+	/**
+	 * Tells the renderer that something else drew over the screen, the
+	 * GUI for example, so that it can't assume anything about what is on
+	 * it when drawing the next frame.
+	 */
+	virtual void invalidateScreen() { }
+
 	virtual void getBoundingBoxPos(const Mesh *mesh, int *x1, int *y1, int *x2, int *y2) = 0;
 	virtual void startActorDraw(Math::Vector3d pos, float scale, const Math::Angle &yaw,
 								const Math::Angle &pitch, const Math::Angle &roll) = 0;
@@ -105,6 +112,7 @@ public:
 	virtual void translateViewpointFinish() = 0;
 
 	virtual void drawHierachyNode(const ModelNode *node, int *x1, int *y1, int *x2, int *y2) = 0;
+	virtual void drawMesh(const Mesh *mesh) = 0;
 	virtual void drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts) = 0;
 	virtual void drawSprite(const Sprite *sprite) = 0;
 
@@ -116,6 +124,17 @@ public:
 	virtual void selectMaterial(const Texture *material) = 0;
 	virtual void destroyMaterial(Texture *material) = 0;
 
+	/**
+	 * Gives a material made by createMaterial the colors of another
+	 * colormap, without going through its texels again.
+	 *
+	 * @param material	the material to recolor
+	 * @param cmap		the new colormap
+	 * @return false if the renderer can't do it, the material must
+	 *				then be created again
+	 */
+	virtual bool setMaterialColormap(Texture *material, const CMap *cmap);
+
 	/**
 	 * Prepares a bitmap for drawing
 	 * performs any format conversions needed for the renderer,
@@ -131,6 +150,25 @@ public:
 	 */
 	virtual void createBitmap(BitmapData *bitmap) = 0;
 
+	/**
+	 * Converts the images of a freshly decoded bitmap to the format the
+	 * renderer draws them in. Called before createBitmap, except for
+	 * bitmaps read back from the bitmap cache, which were converted when
+	 * they were stored. The result may only depend on the image data.
+	 *
+	 * @param bitmap	the bitmap to be converted
+	 * @see getNativeBitmapFormat
+	 */
+	virtual void prepareBitmap(BitmapData *bitmap);
+
+	/**
+	 * Names the format prepareBitmap converts to, so that converted
+	 * bitmaps can be cached across runs.
+	 *
+	 * @return a tag for the format, 0 if converted bitmaps may not be cached
+	 */
+	virtual uint32 getNativeBitmapFormat() const;
+
 	/**
 	 * Draws a bitmap
 	 * before this is safe to use, createBitmap MUST have been called
@@ -214,8 +252,8 @@ public:
 	virtual void saveState(SaveGame *state);
 	virtual void restoreState(SaveGame *state);
 
-	void renderBitmaps(bool render);
-	void renderZBitmaps(bool render);
+	virtual void renderBitmaps(bool render);
+	virtual void renderZBitmaps(bool render);
 
 protected:
 	int _screenWidth, _screenHeight, _screenBPP;
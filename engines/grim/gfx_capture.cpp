@@ -0,0 +1,1545 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#include "common/endian.h"
+#include "common/fs.h"
+#include "common/memstream.h"
+#include "common/system.h"
+#include "common/textconsole.h"
+
+#include "graphics/surface.h"
+#include "graphics/tinygl/gl.h"
+
+#include "engines/grim/gfx_capture.h"
+#include "engines/grim/gfx_tinygl.h"
+#include "engines/grim/actor.h"
+#include "engines/grim/bitmap.h"
+#include "engines/grim/colormap.h"
+#include "engines/grim/material.h"
+#include "engines/grim/model.h"
+#include "engines/grim/primitives.h"
+#include "engines/grim/sector.h"
+#include "engines/grim/set.h"
+#include "engines/grim/textobject.h"
+#include "engines/grim/textsplit.h"
+
+namespace Grim {
+
+// The capture file starts with the tag, the version and the screen size,
+// followed by records of one op byte and its little endian arguments.
+// Resources are defined once, before the first record using them.
+enum {
+	kCaptureSetupCamera = 1,
+	kCapturePositionCamera,
+	kCaptureClearScreen,
+	kCaptureFlipBuffer,
+	kCaptureStartActorDraw,
+	kCaptureFinishActorDraw,
+	kCaptureSetShadow,
+	kCaptureDrawShadowPlanes,
+	kCaptureSetShadowMode,
+	kCaptureClearShadowMode,
+	kCaptureSetShadowColor,
+	kCaptureSet3DMode,
+	kCaptureTranslateViewpointStart,
+	kCaptureTranslateViewpointFinish,
+	kCaptureDrawMesh,
+	kCaptureDrawModelFace,
+	kCaptureEnableLights,
+	kCaptureDisableLights,
+	kCaptureSetupLight,
+	kCaptureSelectMaterial,
+	kCaptureDrawBitmap,
+	kCaptureStoreDisplay,
+	kCaptureCopyStoredToDisplay,
+	kCaptureDimScreen,
+	kCaptureDimRegion,
+	kCaptureIrisAroundRegion,
+	kCaptureDefineTexture,
+	kCaptureDefineBitmap,
+	kCaptureDefineMesh,
+	kCaptureDefineShadow,
+	kCaptureDrawSprite,
+	kCaptureDefineText,
+	kCaptureDrawText,
+	kCaptureDrawRectangle,
+	kCaptureDrawLine,
+	kCaptureDrawPolygon,
+	kCaptureDrawEmergString,
+	kCapturePrepareMovieFrame,
+	kCaptureDrawMovieFrame,
+	kCaptureReleaseMovieFrame
+};
+
+static const uint32 kCaptureVersion = 2;
+static const uint32 kCaptureNone = 0xFFFFFFFF;
+
+GfxCapture::GfxCapture(GfxTinyGL *gfx, const Common::String &filename, int skipFrames, int numFrames) :
+		_gfx(gfx), _filename(filename), _out(NULL), _skipFrames(skipFrames),
+		_numFrames(numFrames), _frame(0), _nextId(0), _inMesh(false) {
+	g_driver = this;
+	if (_numFrames < 1)
+		_numFrames = 1;
+	if (_skipFrames <= 0) {
+		_skipFrames = 0;
+		startCapture();
+	}
+}
+
+GfxCapture::~GfxCapture() {
+	finishCapture();
+
+	for (TextureMap::iterator i = _textures.begin(); i != _textures.end(); ++i) {
+		delete[] i->_value->_data;
+		delete i->_value;
+	}
+	for (BitmapMap::iterator i = _bitmaps.begin(); i != _bitmaps.end(); ++i) {
+		delete[] i->_value->_data;
+		delete i->_value;
+	}
+	delete _gfx;
+}
+
+void GfxCapture::startCapture() {
+	Common::FSNode node(_filename);
+	_out = node.createWriteStream();
+	if (!_out) {
+		warning("GfxCapture: Could not open %s for writing", _filename.c_str());
+		return;
+	}
+
+	_out->writeUint32BE(MKTAG('G','F','X','C'));
+	_out->writeUint32LE(kCaptureVersion);
+	_out->writeUint32LE(640);
+	_out->writeUint32LE(480);
+
+	_textureIds.clear();
+	_bitmapIds.clear();
+	_meshIds.clear();
+	_shadowIds.clear();
+	_textIds.clear();
+
+	// The shadow color is usually set long before the captured frames
+	byte r, g, b;
+	_gfx->getShadowColor(&r, &g, &b);
+	writeOp(kCaptureSetShadowColor);
+	_out->writeByte(r);
+	_out->writeByte(g);
+	_out->writeByte(b);
+}
+
+void GfxCapture::finishCapture() {
+	if (!_out)
+		return;
+
+	_out->finalize();
+	if (_out->err())
+		warning("GfxCapture: Could not write %s", _filename.c_str());
+	else
+		debug("GfxCapture: Wrote %d frames to %s", _frame, _filename.c_str());
+	delete _out;
+	_out = NULL;
+}
+
+void GfxCapture::writeOp(int op) {
+	_out->writeByte(op);
+}
+
+void GfxCapture::writeFloat(float value) {
+	union {
+		float f;
+		uint32 u;
+	} v;
+	v.f = value;
+	_out->writeUint32LE(v.u);
+}
+
+void GfxCapture::writeVector(const Math::Vector3d &vec) {
+	writeFloat(vec.x());
+	writeFloat(vec.y());
+	writeFloat(vec.z());
+}
+
+void GfxCapture::writeModelView() {
+	TGLfloat matrix[16];
+	tglGetFloatv(TGL_MODELVIEW_MATRIX, matrix);
+	for (int i = 0; i < 16; i++)
+		writeFloat(matrix[i]);
+}
+
+uint32 GfxCapture::writeTexture(const Texture *texture) {
+	if (!texture->_width || !texture->_height)
+		return kCaptureNone;
+	if (_textureIds.contains(texture))
+		return _textureIds[texture];
+	if (!_textures.contains(texture))
+		return kCaptureNone;
+
+	const TextureCopy *copy = _textures[texture];
+	uint32 id = _nextId++;
+	writeOp(kCaptureDefineTexture);
+	_out->writeUint32LE(id);
+	_out->writeUint32LE(copy->_width);
+	_out->writeUint32LE(copy->_height);
+	_out->writeByte(copy->_hasAlpha);
+	_out->write(copy->_colors, sizeof(copy->_colors));
+	_out->write(copy->_data, copy->_width * copy->_height);
+	_textureIds[texture] = id;
+	return id;
+}
+
+uint32 GfxCapture::writeBitmap(const BitmapData *bitmap) {
+	if (_bitmapIds.contains(bitmap))
+		return _bitmapIds[bitmap];
+	if (!_bitmaps.contains(bitmap))
+		return kCaptureNone;
+
+	const BitmapCopy *copy = _bitmaps[bitmap];
+	uint32 id = _nextId++;
+	writeOp(kCaptureDefineBitmap);
+	_out->writeUint32LE(id);
+	_out->writeUint32LE(copy->_format);
+	_out->writeUint32LE(copy->_bpp);
+	_out->writeUint32LE(copy->_width);
+	_out->writeUint32LE(copy->_height);
+	_out->writeUint32LE(copy->_numImages);
+	_out->write(copy->_data, copy->_numImages * copy->_width * copy->_height * copy->_bpp / 8);
+	_bitmapIds[bitmap] = id;
+	return id;
+}
+
+uint32 GfxCapture::writeMesh(const Mesh *mesh) {
+	// Meshes are not announced to the driver when they go away. A capture
+	// only spans a few frames, so their addresses are not expected to be
+	// reused meanwhile.
+	if (_meshIds.contains(mesh))
+		return _meshIds[mesh];
+
+	uint32 id = _nextId++;
+	writeOp(kCaptureDefineMesh);
+	_out->writeUint32LE(id);
+	_out->writeUint32LE(mesh->_numArrayVerts);
+	for (int i = 0; i < mesh->_numArrayVerts * 3; i++)
+		writeFloat(mesh->_arrayVertices[i]);
+	for (int i = 0; i < mesh->_numArrayVerts * 3; i++)
+		writeFloat(mesh->_arrayNormals[i]);
+	for (int i = 0; i < mesh->_numArrayVerts * 2; i++)
+		writeFloat(mesh->_arrayTextureVerts[i]);
+	_out->writeUint32LE(mesh->_numFaces);
+	for (int i = 0; i < mesh->_numFaces; i++) {
+		const MeshFace *face = &mesh->_faces[i];
+		_out->writeUint32LE(face->_numVertices);
+		for (int j = 0; j < face->_numVertices; j++)
+			_out->writeUint32LE(face->_arrayIndices[j]);
+	}
+	_meshIds[mesh] = id;
+	return id;
+}
+
+uint32 GfxCapture::writeShadow(const Shadow *shadow) {
+	if (_shadowIds.contains(shadow))
+		return _shadowIds[shadow];
+
+	uint32 id = _nextId++;
+	writeOp(kCaptureDefineShadow);
+	_out->writeUint32LE(id);
+	_out->writeUint32LE(shadow->planeList.size());
+	for (SectorListType::const_iterator i = shadow->planeList.begin(); i != shadow->planeList.end(); ++i) {
+		Sector *sector = i->sector;
+		_out->writeUint32LE(sector->getNumVertices());
+		for (int j = 0; j < sector->getNumVertices(); j++)
+			writeVector(sector->getVertices()[j]);
+	}
+	_shadowIds[shadow] = id;
+	return id;
+}
+
+uint32 GfxCapture::writeText(TextObject *text) {
+	if (_textIds.contains(text))
+		return _textIds[text];
+	const GfxTinyGL::TextObjectData *lines = (const GfxTinyGL::TextObjectData *)text->getUserData();
+	if (!lines)
+		return kCaptureNone;
+
+	uint32 id = _nextId++;
+	writeOp(kCaptureDefineText);
+	_out->writeUint32LE(id);
+	_out->writeUint32LE(text->getNumLines());
+	for (int i = 0; i < text->getNumLines(); i++) {
+		_out->writeSint32LE(lines[i].x);
+		_out->writeSint32LE(lines[i].y);
+		_out->writeUint32LE(lines[i].width);
+		_out->writeUint32LE(lines[i].height);
+		const byte *data = lines[i].data;
+		for (int j = 0; j < lines[i].width * lines[i].height; j++)
+			_out->writeUint16LE(READ_UINT16(data + j * 2));
+	}
+	_textIds[text] = id;
+	return id;
+}
+
+void GfxCapture::writePrimitive(int op, PrimitiveObject *primitive) {
+	const Color *color = primitive->getColor();
+	writeOp(op);
+	_out->writeSint32LE(primitive->getP1().x);
+	_out->writeSint32LE(primitive->getP1().y);
+	_out->writeSint32LE(primitive->getP2().x);
+	_out->writeSint32LE(primitive->getP2().y);
+	_out->writeSint32LE(primitive->getP3().x);
+	_out->writeSint32LE(primitive->getP3().y);
+	_out->writeSint32LE(primitive->getP4().x);
+	_out->writeSint32LE(primitive->getP4().y);
+	_out->writeByte(color->getRed());
+	_out->writeByte(color->getGreen());
+	_out->writeByte(color->getBlue());
+	_out->writeByte(primitive->isFilled());
+}
+
+byte *GfxCapture::setupScreen(int screenW, int screenH, bool fullscreen) {
+	return _gfx->setupScreen(screenW, screenH, fullscreen);
+}
+
+bool GfxCapture::isHardwareAccelerated() {
+	return _gfx->isHardwareAccelerated();
+}
+
+void GfxCapture::setupCamera(float fov, float nclip, float fclip, float roll) {
+	if (_out) {
+		writeOp(kCaptureSetupCamera);
+		writeFloat(fov);
+		writeFloat(nclip);
+		writeFloat(fclip);
+		writeFloat(roll);
+	}
+	_gfx->setupCamera(fov, nclip, fclip, roll);
+}
+
+void GfxCapture::positionCamera(Math::Vector3d pos, Math::Vector3d interest) {
+	if (_out) {
+		writeOp(kCapturePositionCamera);
+		writeVector(pos);
+		writeVector(interest);
+	}
+	_gfx->positionCamera(pos, interest);
+}
+
+void GfxCapture::clearScreen() {
+	if (_out)
+		writeOp(kCaptureClearScreen);
+	_gfx->clearScreen();
+}
+
+void GfxCapture::flipBuffer() {
+	_gfx->flipBuffer();
+	if (_out) {
+		writeOp(kCaptureFlipBuffer);
+		if (++_frame >= _numFrames)
+			finishCapture();
+	} else if (_skipFrames > 0 && --_skipFrames == 0) {
+		startCapture();
+	}
+}
+
+void GfxCapture::invalidateScreen() {
+	_gfx->invalidateScreen();
+}
+
+void GfxCapture::getBoundingBoxPos(const Mesh *mesh, int *x1, int *y1, int *x2, int *y2) {
+	_gfx->getBoundingBoxPos(mesh, x1, y1, x2, y2);
+}
+
+void GfxCapture::startActorDraw(Math::Vector3d pos, float scale, const Math::Angle &yaw,
+								const Math::Angle &pitch, const Math::Angle &roll) {
+	if (_out) {
+		writeOp(kCaptureStartActorDraw);
+		writeVector(pos);
+		writeFloat(scale);
+		writeFloat(yaw.getDegrees());
+		writeFloat(pitch.getDegrees());
+		writeFloat(roll.getDegrees());
+	}
+	_gfx->startActorDraw(pos, scale, yaw, pitch, roll);
+}
+
+void GfxCapture::finishActorDraw() {
+	if (_out)
+		writeOp(kCaptureFinishActorDraw);
+	_gfx->finishActorDraw();
+}
+
+void GfxCapture::setShadow(Shadow *shadow) {
+	if (_out) {
+		uint32 id = shadow ? writeShadow(shadow) : kCaptureNone;
+		writeOp(kCaptureSetShadow);
+		_out->writeUint32LE(id);
+		if (shadow) {
+			writeVector(shadow->pos);
+			_out->writeByte(shadow->dontNegate);
+		}
+	}
+	_gfx->setShadow(shadow);
+}
+
+void GfxCapture::drawShadowPlanes() {
+	if (_out)
+		writeOp(kCaptureDrawShadowPlanes);
+	_gfx->drawShadowPlanes();
+}
+
+void GfxCapture::setShadowMode() {
+	if (_out)
+		writeOp(kCaptureSetShadowMode);
+	_gfx->setShadowMode();
+}
+
+void GfxCapture::clearShadowMode() {
+	if (_out)
+		writeOp(kCaptureClearShadowMode);
+	_gfx->clearShadowMode();
+}
+
+void GfxCapture::setShadowColor(byte r, byte g, byte b) {
+	if (_out) {
+		writeOp(kCaptureSetShadowColor);
+		_out->writeByte(r);
+		_out->writeByte(g);
+		_out->writeByte(b);
+	}
+	_gfx->setShadowColor(r, g, b);
+}
+
+void GfxCapture::getShadowColor(byte *r, byte *g, byte *b) {
+	_gfx->getShadowColor(r, g, b);
+}
+
+void GfxCapture::set3DMode() {
+	if (_out)
+		writeOp(kCaptureSet3DMode);
+	_gfx->set3DMode();
+}
+
+void GfxCapture::translateViewpointStart(Math::Vector3d pos, const Math::Angle &pitch,
+										 const Math::Angle &yaw, const Math::Angle &roll) {
+	if (_out) {
+		writeOp(kCaptureTranslateViewpointStart);
+		writeVector(pos);
+		writeFloat(pitch.getDegrees());
+		writeFloat(yaw.getDegrees());
+		writeFloat(roll.getDegrees());
+	}
+	_gfx->translateViewpointStart(pos, pitch, yaw, roll);
+}
+
+void GfxCapture::translateViewpointFinish() {
+	if (_out)
+		writeOp(kCaptureTranslateViewpointFinish);
+	_gfx->translateViewpointFinish();
+}
+
+void GfxCapture::drawHierachyNode(const ModelNode *node, int *x1, int *y1, int *x2, int *y2) {
+	// The meshes below the node are recorded with their final model view
+	// matrix, so the walk itself needs no record.
+	_gfx->drawHierachyNode(node, x1, y1, x2, y2);
+}
+
+void GfxCapture::drawMesh(const Mesh *mesh) {
+	if (_out) {
+		uint32 id = writeMesh(mesh);
+		Common::Array<uint32> textures;
+		textures.resize(mesh->_numFaces);
+		for (int i = 0; i < mesh->_numFaces; i++) {
+			const Material *material = mesh->_faces[i]._material;
+			textures[i] = writeTexture(material->getData()->_textures + material->getActiveTexture());
+		}
+
+		writeOp(kCaptureDrawMesh);
+		_out->writeUint32LE(id);
+		writeModelView();
+		for (int i = 0; i < mesh->_numFaces; i++)
+			_out->writeUint32LE(textures[i]);
+	}
+
+	// The materials selected while drawing are part of the mesh record
+	_inMesh = true;
+	_gfx->drawMesh(mesh);
+	_inMesh = false;
+}
+
+void GfxCapture::drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts) {
+	if (_out) {
+		writeOp(kCaptureDrawModelFace);
+		writeModelView();
+		writeVector(face->_normal);
+		_out->writeUint32LE(face->_numVertices);
+		_out->writeByte(face->_texVertices != NULL);
+		for (int i = 0; i < face->_numVertices; i++) {
+			const float *v = vertices + 3 * face->_vertices[i];
+			const float *n = vertNormals + 3 * face->_vertices[i];
+			writeFloat(v[0]);
+			writeFloat(v[1]);
+			writeFloat(v[2]);
+			writeFloat(n[0]);
+			writeFloat(n[1]);
+			writeFloat(n[2]);
+			if (face->_texVertices) {
+				const float *t = textureVerts + 2 * face->_texVertices[i];
+				writeFloat(t[0]);
+				writeFloat(t[1]);
+			}
+		}
+	}
+	_gfx->drawModelFace(face, vertices, vertNormals, textureVerts);
+}
+
+void GfxCapture::drawSprite(const Sprite *sprite) {
+	// Sprite::draw selects the material first, which is recorded as usual
+	if (_out) {
+		writeOp(kCaptureDrawSprite);
+		writeModelView();
+		writeVector(sprite->_pos);
+		writeFloat(sprite->_width);
+		writeFloat(sprite->_height);
+	}
+	_gfx->drawSprite(sprite);
+}
+
+void GfxCapture::enableLights() {
+	if (_out)
+		writeOp(kCaptureEnableLights);
+	_gfx->enableLights();
+}
+
+void GfxCapture::disableLights() {
+	if (_out)
+		writeOp(kCaptureDisableLights);
+	_gfx->disableLights();
+}
+
+void GfxCapture::setupLight(Light *light, int lightId) {
+	if (_out) {
+		writeOp(kCaptureSetupLight);
+		_out->writeUint32LE(lightId);
+		_out->writeUint32LE(light->_type.size());
+		_out->write(light->_type.c_str(), light->_type.size());
+		writeVector(light->_pos);
+		writeVector(light->_dir);
+		_out->writeByte(light->_color.getRed());
+		_out->writeByte(light->_color.getGreen());
+		_out->writeByte(light->_color.getBlue());
+		writeFloat(light->_intensity);
+		writeFloat(light->_umbraangle);
+		writeFloat(light->_penumbraangle);
+	}
+	_gfx->setupLight(light, lightId);
+}
+
+void GfxCapture::createMaterial(Texture *material, const char *data, const CMap *cmap) {
+	TextureCopy *copy = new TextureCopy;
+	copy->_width = material->_width;
+	copy->_height = material->_height;
+	copy->_hasAlpha = material->_hasAlpha;
+	memcpy(copy->_colors, cmap->_colors, sizeof(copy->_colors));
+	copy->_data = new byte[material->_width * material->_height];
+	memcpy(copy->_data, data, material->_width * material->_height);
+	if (_textures.contains(material)) {
+		delete[] _textures[material]->_data;
+		delete _textures[material];
+	}
+	_textures[material] = copy;
+
+	_gfx->createMaterial(material, data, cmap);
+}
+
+void GfxCapture::selectMaterial(const Texture *material) {
+	if (_out && !_inMesh) {
+		uint32 id = writeTexture(material);
+		writeOp(kCaptureSelectMaterial);
+		_out->writeUint32LE(id);
+	}
+	_gfx->selectMaterial(material);
+}
+
+void GfxCapture::destroyMaterial(Texture *material) {
+	if (_textures.contains(material)) {
+		delete[] _textures[material]->_data;
+		delete _textures[material];
+		_textures.erase(material);
+	}
+	_textureIds.erase(material);
+
+	_gfx->destroyMaterial(material);
+}
+
+bool GfxCapture::setMaterialColormap(Texture *material, const CMap *cmap) {
+	if (!_gfx->setMaterialColormap(material, cmap))
+		return false;
+
+	// Written again with the new colors the next time it is selected
+	if (_textures.contains(material))
+		memcpy(_textures[material]->_colors, cmap->_colors, sizeof(_textures[material]->_colors));
+	_textureIds.erase(material);
+	return true;
+}
+
+void GfxCapture::createBitmap(BitmapData *bitmap) {
+	_gfx->createBitmap(bitmap);
+}
+
+// getNativeBitmapFormat is not forwarded, so that no bitmap comes from
+// the bitmap cache already converted and every one passes through here.
+void GfxCapture::prepareBitmap(BitmapData *bitmap) {
+	// Keep the data as loaded, the driver may convert it in place. Only
+	// the RGB565 bitmaps of Grim can be rebuilt by the replay.
+	if (bitmap->_colorFormat == BM_RGB565) {
+		int imageSize = bitmap->_width * bitmap->_height * bitmap->_bpp / 8;
+		BitmapCopy *copy = new BitmapCopy;
+		copy->_format = bitmap->_format;
+		copy->_bpp = bitmap->_bpp;
+		copy->_width = bitmap->_width;
+		copy->_height = bitmap->_height;
+		copy->_numImages = bitmap->_numImages;
+		copy->_data = new byte[bitmap->_numImages * imageSize];
+		for (int i = 0; i < bitmap->_numImages; i++) {
+			byte *dst = copy->_data + i * imageSize;
+			memcpy(dst, bitmap->getImageData(i), imageSize);
+#ifdef SCUMM_BIG_ENDIAN
+			// Color bitmaps were swapped when loaded, store them as in the file
+			if (bitmap->_format == 1)
+				for (int j = 0; j < imageSize; j += 2)
+					WRITE_LE_UINT16(dst + j, READ_UINT16(dst + j));
+#endif
+		}
+		if (_bitmaps.contains(bitmap)) {
+			delete[] _bitmaps[bitmap]->_data;
+			delete _bitmaps[bitmap];
+		}
+		_bitmaps[bitmap] = copy;
+	}
+
+	_gfx->prepareBitmap(bitmap);
+}
+
+void GfxCapture::drawBitmap(const Bitmap *bitmap) {
+	if (_out) {
+		uint32 id = writeBitmap(bitmap->getBitmapData());
+		if (id != kCaptureNone) {
+			writeOp(kCaptureDrawBitmap);
+			_out->writeUint32LE(id);
+			_out->writeUint32LE(bitmap->getActiveImage());
+			_out->writeSint32LE(bitmap->getX());
+			_out->writeSint32LE(bitmap->getY());
+		}
+	}
+	_gfx->drawBitmap(bitmap);
+}
+
+void GfxCapture::destroyBitmap(BitmapData *bitmap) {
+	if (_bitmaps.contains(bitmap)) {
+		delete[] _bitmaps[bitmap]->_data;
+		delete _bitmaps[bitmap];
+		_bitmaps.erase(bitmap);
+	}
+	_bitmapIds.erase(bitmap);
+
+	_gfx->destroyBitmap(bitmap);
+}
+
+void GfxCapture::createFont(Font *font) {
+	_gfx->createFont(font);
+}
+
+void GfxCapture::destroyFont(Font *font) {
+	_gfx->destroyFont(font);
+}
+
+void GfxCapture::createTextObject(TextObject *text) {
+	_gfx->createTextObject(text);
+}
+
+void GfxCapture::drawTextObject(TextObject *text) {
+	if (_out) {
+		uint32 id = writeText(text);
+		if (id != kCaptureNone) {
+			writeOp(kCaptureDrawText);
+			_out->writeUint32LE(id);
+		}
+	}
+	_gfx->drawTextObject(text);
+}
+
+void GfxCapture::destroyTextObject(TextObject *text) {
+	_textIds.erase(text);
+	_gfx->destroyTextObject(text);
+}
+
+Bitmap *GfxCapture::getScreenshot(int w, int h) {
+	return _gfx->getScreenshot(w, h);
+}
+
+void GfxCapture::storeDisplay() {
+	if (_out)
+		writeOp(kCaptureStoreDisplay);
+	_gfx->storeDisplay();
+}
+
+void GfxCapture::copyStoredToDisplay() {
+	if (_out)
+		writeOp(kCaptureCopyStoredToDisplay);
+	_gfx->copyStoredToDisplay();
+}
+
+void GfxCapture::dimScreen() {
+	if (_out)
+		writeOp(kCaptureDimScreen);
+	_gfx->dimScreen();
+}
+
+void GfxCapture::dimRegion(int x, int y, int w, int h, float level) {
+	if (_out) {
+		writeOp(kCaptureDimRegion);
+		_out->writeSint32LE(x);
+		_out->writeSint32LE(y);
+		_out->writeSint32LE(w);
+		_out->writeSint32LE(h);
+		writeFloat(level);
+	}
+	_gfx->dimRegion(x, y, w, h, level);
+}
+
+void GfxCapture::irisAroundRegion(int x1, int y1, int x2, int y2) {
+	if (_out) {
+		writeOp(kCaptureIrisAroundRegion);
+		_out->writeSint32LE(x1);
+		_out->writeSint32LE(y1);
+		_out->writeSint32LE(x2);
+		_out->writeSint32LE(y2);
+	}
+	_gfx->irisAroundRegion(x1, y1, x2, y2);
+}
+
+void GfxCapture::drawEmergString(int x, int y, const char *text, const Color &fgColor) {
+	if (_out) {
+		writeOp(kCaptureDrawEmergString);
+		_out->writeSint32LE(x);
+		_out->writeSint32LE(y);
+		_out->writeUint32LE(strlen(text));
+		_out->write(text, strlen(text));
+		_out->writeByte(fgColor.getRed());
+		_out->writeByte(fgColor.getGreen());
+		_out->writeByte(fgColor.getBlue());
+	}
+	_gfx->drawEmergString(x, y, text, fgColor);
+}
+
+void GfxCapture::loadEmergFont() {
+	_gfx->loadEmergFont();
+}
+
+void GfxCapture::drawRectangle(PrimitiveObject *primitive) {
+	if (_out)
+		writePrimitive(kCaptureDrawRectangle, primitive);
+	_gfx->drawRectangle(primitive);
+}
+
+void GfxCapture::drawLine(PrimitiveObject *primitive) {
+	if (_out)
+		writePrimitive(kCaptureDrawLine, primitive);
+	_gfx->drawLine(primitive);
+}
+
+void GfxCapture::drawPolygon(PrimitiveObject *primitive) {
+	if (_out)
+		writePrimitive(kCaptureDrawPolygon, primitive);
+	_gfx->drawPolygon(primitive);
+}
+
+void GfxCapture::prepareMovieFrame(Graphics::Surface *frame) {
+	// The movie surfaces are RGB565, like the screen
+	if (_out) {
+		writeOp(kCapturePrepareMovieFrame);
+		_out->writeUint32LE(frame->w);
+		_out->writeUint32LE(frame->h);
+		for (int y = 0; y < frame->h; y++) {
+			const byte *row = (const byte *)frame->getBasePtr(0, y);
+			for (int x = 0; x < frame->w; x++)
+				_out->writeUint16LE(READ_UINT16(row + x * 2));
+		}
+	}
+	_gfx->prepareMovieFrame(frame);
+}
+
+void GfxCapture::drawMovieFrame(int offsetX, int offsetY) {
+	if (_out) {
+		writeOp(kCaptureDrawMovieFrame);
+		_out->writeSint32LE(offsetX);
+		_out->writeSint32LE(offsetY);
+	}
+	_gfx->drawMovieFrame(offsetX, offsetY);
+}
+
+void GfxCapture::releaseMovieFrame() {
+	if (_out)
+		writeOp(kCaptureReleaseMovieFrame);
+	_gfx->releaseMovieFrame();
+}
+
+const char *GfxCapture::getVideoDeviceName() {
+	return _gfx->getVideoDeviceName();
+}
+
+void GfxCapture::saveState(SaveGame *state) {
+	_gfx->saveState(state);
+}
+
+void GfxCapture::restoreState(SaveGame *state) {
+	_gfx->restoreState(state);
+}
+
+void GfxCapture::renderBitmaps(bool render) {
+	_gfx->renderBitmaps(render);
+}
+
+void GfxCapture::renderZBitmaps(bool render) {
+	_gfx->renderZBitmaps(render);
+}
+
+/**
+ * Rebuilds the resources of a capture and draws its frames with GfxTinyGL.
+ */
+class GfxReplay {
+public:
+	GfxReplay(GfxTinyGL *gfx, Common::SeekableReadStream *stream);
+	~GfxReplay();
+
+	/**
+	 * Draws all frames of the capture.
+	 * The resources are created during the first call.
+	 *
+	 * @return the number of frames drawn
+	 */
+	int play();
+
+private:
+	float readFloat();
+	Math::Vector3d readVector();
+	Material *getMaterial(uint32 id);
+
+	void defineTexture();
+	void defineBitmap();
+	void defineMesh();
+	void defineShadow();
+	void setShadow();
+	void setupLight();
+	void drawMesh();
+	void drawModelFace();
+	void drawSprite();
+	void defineText();
+	void drawPrimitive(int op);
+	void drawEmergString();
+	void prepareMovieFrame();
+
+	GfxTinyGL *_gfx;
+	Common::SeekableReadStream *_stream;
+	int32 _start;
+
+	Common::HashMap<uint32, Material *> _materials;
+	Common::HashMap<uint32, Bitmap *> _bitmaps;
+	Common::HashMap<uint32, Mesh *> _meshes;
+	Common::HashMap<uint32, Shadow *> _shadows;
+	Common::HashMap<uint32, Common::Array<GfxTinyGL::TextObjectData> *> _texts;
+	Material *_noMaterial;
+	Graphics::Surface _movieFrame;
+
+	Common::Array<float> _faceVerts;
+	Common::Array<int> _faceIndices;
+};
+
+GfxReplay::GfxReplay(GfxTinyGL *gfx, Common::SeekableReadStream *stream) :
+		_gfx(gfx), _stream(stream), _noMaterial(NULL) {
+	_start = _stream->pos();
+}
+
+GfxReplay::~GfxReplay() {
+	for (Common::HashMap<uint32, Material *>::iterator i = _materials.begin(); i != _materials.end(); ++i)
+		delete i->_value;
+	delete _noMaterial;
+	for (Common::HashMap<uint32, Bitmap *>::iterator i = _bitmaps.begin(); i != _bitmaps.end(); ++i)
+		delete i->_value;
+	for (Common::HashMap<uint32, Mesh *>::iterator i = _meshes.begin(); i != _meshes.end(); ++i)
+		delete i->_value;
+	for (Common::HashMap<uint32, Shadow *>::iterator i = _shadows.begin(); i != _shadows.end(); ++i) {
+		Shadow *shadow = i->_value;
+		for (SectorListType::iterator j = shadow->planeList.begin(); j != shadow->planeList.end(); ++j)
+			delete j->sector;
+		delete[] shadow->shadowMask;
+		delete shadow;
+	}
+	for (Common::HashMap<uint32, Common::Array<GfxTinyGL::TextObjectData> *>::iterator i = _texts.begin(); i != _texts.end(); ++i) {
+		for (uint j = 0; j < i->_value->size(); j++)
+			delete[] (*i->_value)[j].data;
+		delete i->_value;
+	}
+	_movieFrame.free();
+}
+
+float GfxReplay::readFloat() {
+	union {
+		float f;
+		uint32 u;
+	} v;
+	v.u = _stream->readUint32LE();
+	return v.f;
+}
+
+Math::Vector3d GfxReplay::readVector() {
+	float x = readFloat();
+	float y = readFloat();
+	float z = readFloat();
+	return Math::Vector3d(x, y, z);
+}
+
+Material *GfxReplay::getMaterial(uint32 id) {
+	if (_materials.contains(id))
+		return _materials[id];
+
+	// Faces without a texture get a material without a texture, whose
+	// selection is a no-op, just like in the game
+	if (!_noMaterial) {
+		char data[124];
+		memset(data, 0, sizeof(data));
+		memcpy(data, "MAT ", 4);
+		WRITE_LE_UINT32(data + 12, 1);
+		char cmapData[64 + 256 * 3];
+		memset(cmapData, 0, sizeof(cmapData));
+		memcpy(cmapData, "CMP ", 4);
+		CMap *cmap = new CMap("capture.cmp", cmapData, sizeof(cmapData));
+		_noMaterial = new Material("capture.mat", data, sizeof(data), cmap);
+	}
+	return _noMaterial;
+}
+
+void GfxReplay::defineTexture() {
+	uint32 id = _stream->readUint32LE();
+	int width = _stream->readUint32LE();
+	int height = _stream->readUint32LE();
+	bool hasAlpha = _stream->readByte();
+	if (_materials.contains(id)) {
+		_stream->skip(256 * 3 + width * height);
+		return;
+	}
+
+	// Rebuild the colormap and a material file with a single image
+	char cmapData[64 + 256 * 3];
+	memset(cmapData, 0, 64);
+	memcpy(cmapData, "CMP ", 4);
+	_stream->read(cmapData + 64, 256 * 3);
+	CMap *cmap = new CMap(Common::String::format("capture%u.cmp", id), cmapData, sizeof(cmapData));
+
+	int len = 124 + width * height;
+	char *data = new char[len];
+	memset(data, 0, 124);
+	memcpy(data, "MAT ", 4);
+	WRITE_LE_UINT32(data + 12, 1);
+	WRITE_LE_UINT32(data + 100, width);
+	WRITE_LE_UINT32(data + 104, height);
+	WRITE_LE_UINT32(data + 108, hasAlpha);
+	_stream->read(data + 124, width * height);
+	_materials[id] = new Material(Common::String::format("capture%u.mat", id), data, len, cmap);
+	delete[] data;
+}
+
+void GfxReplay::defineBitmap() {
+	uint32 id = _stream->readUint32LE();
+	int format = _stream->readUint32LE();
+	int bpp = _stream->readUint32LE();
+	int width = _stream->readUint32LE();
+	int height = _stream->readUint32LE();
+	int numImages = _stream->readUint32LE();
+	int imageSize = width * height * bpp / 8;
+	if (_bitmaps.contains(id)) {
+		_stream->skip(numImages * imageSize);
+		return;
+	}
+
+	// Rebuild an uncompressed bitmap file
+	int len = 0x88 + numImages * (imageSize + 8);
+	char *data = new char[len];
+	memset(data, 0, len);
+	memcpy(data, "BM  F\0\0\0", 8);
+	WRITE_LE_UINT32(data + 16, numImages);
+	WRITE_LE_UINT32(data + 32, format);
+	WRITE_LE_UINT32(data + 36, bpp);
+	WRITE_LE_UINT32(data + 128, width);
+	WRITE_LE_UINT32(data + 132, height);
+	for (int i = 0; i < numImages; i++)
+		_stream->read(data + 0x88 + i * (imageSize + 8), imageSize);
+	_bitmaps[id] = new Bitmap(Common::String::format("capture%u.bm", id), data, len);
+	delete[] data;
+}
+
+void GfxReplay::defineMesh() {
+	uint32 id = _stream->readUint32LE();
+	int numVerts = _stream->readUint32LE();
+	if (_meshes.contains(id)) {
+		_stream->skip(numVerts * 8 * 4);
+		int numFaces = _stream->readUint32LE();
+		for (int i = 0; i < numFaces; i++)
+			_stream->skip(_stream->readUint32LE() * 4);
+		return;
+	}
+
+	Mesh *mesh = new Mesh();
+	mesh->_numVertices = 0;
+	mesh->_numTextureVerts = 0;
+	mesh->_materialid = NULL;
+	mesh->_vertices = NULL;
+	mesh->_verticesI = NULL;
+	mesh->_vertNormals = NULL;
+	mesh->_textureVerts = NULL;
+
+	mesh->_numArrayVerts = numVerts;
+	mesh->_arrayVertices = new float[numVerts * 3];
+	mesh->_arrayNormals = new float[numVerts * 3];
+	mesh->_arrayTextureVerts = new float[numVerts * 2];
+	for (int i = 0; i < numVerts * 3; i++)
+		mesh->_arrayVertices[i] = readFloat();
+	for (int i = 0; i < numVerts * 3; i++)
+		mesh->_arrayNormals[i] = readFloat();
+	for (int i = 0; i < numVerts * 2; i++)
+		mesh->_arrayTextureVerts[i] = readFloat();
+
+	mesh->_numFaces = _stream->readUint32LE();
+	mesh->_faces = new MeshFace[mesh->_numFaces];
+	for (int i = 0; i < mesh->_numFaces; i++) {
+		MeshFace *face = &mesh->_faces[i];
+		face->_material = NULL;
+		face->_vertices = NULL;
+		face->_texVertices = NULL;
+		face->_numVertices = _stream->readUint32LE();
+		face->_arrayIndices = new int[face->_numVertices];
+		for (int j = 0; j < face->_numVertices; j++)
+			face->_arrayIndices[j] = _stream->readUint32LE();
+	}
+	_meshes[id] = mesh;
+}
+
+void GfxReplay::defineShadow() {
+	uint32 id = _stream->readUint32LE();
+	int numPlanes = _stream->readUint32LE();
+	if (_shadows.contains(id)) {
+		for (int i = 0; i < numPlanes; i++)
+			_stream->skip(_stream->readUint32LE() * 12);
+		return;
+	}
+
+	Shadow *shadow = new Shadow();
+	shadow->shadowMask = NULL;
+	shadow->shadowMaskSize = 0;
+	shadow->active = true;
+	shadow->dontNegate = false;
+	for (int i = 0; i < numPlanes; i++) {
+		// The sectors compute their normal when loaded from text
+		int numVertices = _stream->readUint32LE();
+		Common::String text = Common::String::format("sector shadow\nid %d\ntype walk\ndefault visibility visible\n"
+													 "height 0\nnumvertices %d\n", i, numVertices);
+		for (int j = 0; j < numVertices; j++) {
+			Math::Vector3d v = readVector();
+			text += Common::String::format("%s%.9g %.9g %.9g\n", j == 0 ? "vertices: " : "", v.x(), v.y(), v.z());
+		}
+		TextSplitter ts(text.c_str(), text.size());
+		Plane plane;
+		plane.sector = new Sector();
+		plane.sector->load(ts);
+		shadow->planeList.push_back(plane);
+	}
+	_shadows[id] = shadow;
+}
+
+void GfxReplay::setShadow() {
+	uint32 id = _stream->readUint32LE();
+	if (id == kCaptureNone || !_shadows.contains(id)) {
+		_gfx->setShadow(NULL);
+		return;
+	}
+
+	Shadow *shadow = _shadows[id];
+	shadow->pos = readVector();
+	shadow->dontNegate = _stream->readByte();
+	_gfx->setShadow(shadow);
+}
+
+void GfxReplay::setupLight() {
+	Light light;
+	int lightId = _stream->readUint32LE();
+	int len = _stream->readUint32LE();
+	char type[32];
+	_stream->read(type, MIN(len, 31));
+	type[MIN(len, 31)] = 0;
+	if (len > 31)
+		_stream->skip(len - 31);
+	light._type = type;
+	light._pos = readVector();
+	light._dir = readVector();
+	byte r = _stream->readByte();
+	byte g = _stream->readByte();
+	byte b = _stream->readByte();
+	light._color = Color(r, g, b);
+	light._intensity = readFloat();
+	light._umbraangle = readFloat();
+	light._penumbraangle = readFloat();
+	light._enabled = true;
+	_gfx->setupLight(&light, lightId);
+}
+
+void GfxReplay::drawMesh() {
+	uint32 id = _stream->readUint32LE();
+	TGLfloat matrix[16];
+	for (int i = 0; i < 16; i++)
+		matrix[i] = readFloat();
+
+	Mesh *mesh = _meshes[id];
+	for (int i = 0; i < mesh->_numFaces; i++)
+		mesh->_faces[i]._material = getMaterial(_stream->readUint32LE());
+
+	tglMatrixMode(TGL_MODELVIEW);
+	tglPushMatrix();
+	tglLoadMatrixf(matrix);
+	_gfx->drawMesh(mesh);
+	tglPopMatrix();
+}
+
+void GfxReplay::drawModelFace() {
+	TGLfloat matrix[16];
+	for (int i = 0; i < 16; i++)
+		matrix[i] = readFloat();
+
+	MeshFace face;
+	face._normal = readVector();
+	face._numVertices = _stream->readUint32LE();
+	bool hasTex = _stream->readByte();
+
+	// The vertices are stored in the order of the face
+	_faceVerts.resize(face._numVertices * 8);
+	_faceIndices.resize(face._numVertices);
+	float *vertices = &_faceVerts[0];
+	float *normals = vertices + face._numVertices * 3;
+	float *textureVerts = normals + face._numVertices * 3;
+	for (int i = 0; i < face._numVertices; i++) {
+		for (int j = 0; j < 3; j++)
+			vertices[i * 3 + j] = readFloat();
+		for (int j = 0; j < 3; j++)
+			normals[i * 3 + j] = readFloat();
+		if (hasTex) {
+			textureVerts[i * 2] = readFloat();
+			textureVerts[i * 2 + 1] = readFloat();
+		}
+		_faceIndices[i] = i;
+	}
+	face._vertices = &_faceIndices[0];
+	face._texVertices = hasTex ? &_faceIndices[0] : NULL;
+
+	tglMatrixMode(TGL_MODELVIEW);
+	tglPushMatrix();
+	tglLoadMatrixf(matrix);
+	_gfx->drawModelFace(&face, vertices, normals, textureVerts);
+	tglPopMatrix();
+
+	// Not owned by the face
+	face._vertices = NULL;
+	face._texVertices = NULL;
+}
+
+void GfxReplay::drawSprite() {
+	TGLfloat matrix[16];
+	for (int i = 0; i < 16; i++)
+		matrix[i] = readFloat();
+
+	// The material was selected by a record of its own
+	Sprite sprite;
+	sprite._pos = readVector();
+	sprite._width = readFloat();
+	sprite._height = readFloat();
+	sprite._visible = true;
+	sprite._material = NULL;
+	sprite._next = NULL;
+
+	tglMatrixMode(TGL_MODELVIEW);
+	tglPushMatrix();
+	tglLoadMatrixf(matrix);
+	_gfx->drawSprite(&sprite);
+	tglPopMatrix();
+}
+
+void GfxReplay::defineText() {
+	uint32 id = _stream->readUint32LE();
+	int numLines = _stream->readUint32LE();
+	if (_texts.contains(id)) {
+		for (int i = 0; i < numLines; i++) {
+			_stream->skip(8);
+			int width = _stream->readUint32LE();
+			int height = _stream->readUint32LE();
+			_stream->skip(width * height * 2);
+		}
+		return;
+	}
+
+	Common::Array<GfxTinyGL::TextObjectData> *lines = new Common::Array<GfxTinyGL::TextObjectData>;
+	lines->resize(numLines);
+	for (int i = 0; i < numLines; i++) {
+		GfxTinyGL::TextObjectData &line = (*lines)[i];
+		line.x = _stream->readSint32LE();
+		line.y = _stream->readSint32LE();
+		line.width = _stream->readUint32LE();
+		line.height = _stream->readUint32LE();
+		line.data = new byte[line.width * line.height * 2];
+		for (int j = 0; j < line.width * line.height; j++)
+			WRITE_UINT16(line.data + j * 2, _stream->readUint16LE());
+	}
+	_texts[id] = lines;
+}
+
+void GfxReplay::drawPrimitive(int op) {
+	Common::Point p[4];
+	for (int i = 0; i < 4; i++) {
+		p[i].x = _stream->readSint32LE();
+		p[i].y = _stream->readSint32LE();
+	}
+	byte r = _stream->readByte();
+	byte g = _stream->readByte();
+	byte b = _stream->readByte();
+	bool filled = _stream->readByte();
+
+	PoolColor color(r, g, b);
+	PrimitiveObject primitive;
+	if (op == kCaptureDrawRectangle) {
+		primitive.createRectangle(p[0], p[1], &color, filled);
+		_gfx->drawRectangle(&primitive);
+	} else if (op == kCaptureDrawLine) {
+		primitive.createLine(p[0], p[1], &color);
+		_gfx->drawLine(&primitive);
+	} else {
+		primitive.createPolygon(p[0], p[1], p[2], p[3], &color);
+		_gfx->drawPolygon(&primitive);
+	}
+}
+
+void GfxReplay::drawEmergString() {
+	int x = _stream->readSint32LE();
+	int y = _stream->readSint32LE();
+	int len = _stream->readUint32LE();
+	Common::String text;
+	for (int i = 0; i < len; i++)
+		text += (char)_stream->readByte();
+	byte r = _stream->readByte();
+	byte g = _stream->readByte();
+	byte b = _stream->readByte();
+	_gfx->drawEmergString(x, y, text.c_str(), Color(r, g, b));
+}
+
+void GfxReplay::prepareMovieFrame() {
+	int width = _stream->readUint32LE();
+	int height = _stream->readUint32LE();
+	if (_movieFrame.w != width || _movieFrame.h != height) {
+		_movieFrame.free();
+		_movieFrame.create(width, height, Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
+	}
+	for (int y = 0; y < height; y++) {
+		byte *row = (byte *)_movieFrame.getBasePtr(0, y);
+		for (int x = 0; x < width; x++)
+			WRITE_UINT16(row + x * 2, _stream->readUint16LE());
+	}
+	_gfx->prepareMovieFrame(&_movieFrame);
+}
+
+int GfxReplay::play() {
+	int frames = 0;
+
+	_stream->seek(_start);
+	while (!_stream->eos()) {
+		int op = _stream->readByte();
+		if (_stream->eos())
+			break;
+
+		switch (op) {
+		case kCaptureSetupCamera: {
+			float fov = readFloat();
+			float nclip = readFloat();
+			float fclip = readFloat();
+			float roll = readFloat();
+			_gfx->setupCamera(fov, nclip, fclip, roll);
+			break;
+		}
+		case kCapturePositionCamera: {
+			Math::Vector3d pos = readVector();
+			Math::Vector3d interest = readVector();
+			_gfx->positionCamera(pos, interest);
+			break;
+		}
+		case kCaptureClearScreen:
+			_gfx->clearScreen();
+			break;
+		case kCaptureFlipBuffer:
+			_gfx->flipBuffer();
+			frames++;
+			break;
+		case kCaptureStartActorDraw: {
+			Math::Vector3d pos = readVector();
+			float scale = readFloat();
+			Math::Angle yaw = readFloat();
+			Math::Angle pitch = readFloat();
+			Math::Angle roll = readFloat();
+			_gfx->startActorDraw(pos, scale, yaw, pitch, roll);
+			break;
+		}
+		case kCaptureFinishActorDraw:
+			_gfx->finishActorDraw();
+			break;
+		case kCaptureSetShadow:
+			setShadow();
+			break;
+		case kCaptureDrawShadowPlanes:
+			_gfx->drawShadowPlanes();
+			break;
+		case kCaptureSetShadowMode:
+			_gfx->setShadowMode();
+			break;
+		case kCaptureClearShadowMode:
+			_gfx->clearShadowMode();
+			break;
+		case kCaptureSetShadowColor: {
+			byte r = _stream->readByte();
+			byte g = _stream->readByte();
+			byte b = _stream->readByte();
+			_gfx->setShadowColor(r, g, b);
+			break;
+		}
+		case kCaptureSet3DMode:
+			_gfx->set3DMode();
+			break;
+		case kCaptureTranslateViewpointStart: {
+			Math::Vector3d pos = readVector();
+			Math::Angle pitch = readFloat();
+			Math::Angle yaw = readFloat();
+			Math::Angle roll = readFloat();
+			_gfx->translateViewpointStart(pos, pitch, yaw, roll);
+			break;
+		}
+		case kCaptureTranslateViewpointFinish:
+			_gfx->translateViewpointFinish();
+			break;
+		case kCaptureDrawMesh:
+			drawMesh();
+			break;
+		case kCaptureDrawModelFace:
+			drawModelFace();
+			break;
+		case kCaptureEnableLights:
+			_gfx->enableLights();
+			break;
+		case kCaptureDisableLights:
+			_gfx->disableLights();
+			break;
+		case kCaptureSetupLight:
+			setupLight();
+			break;
+		case kCaptureSelectMaterial:
+			getMaterial(_stream->readUint32LE())->select();
+			break;
+		case kCaptureDrawBitmap: {
+			Bitmap *bitmap = _bitmaps[_stream->readUint32LE()];
+			bitmap->setActiveImage(_stream->readUint32LE());
+			bitmap->setX(_stream->readSint32LE());
+			bitmap->setY(_stream->readSint32LE());
+			_gfx->drawBitmap(bitmap);
+			break;
+		}
+		case kCaptureStoreDisplay:
+			_gfx->storeDisplay();
+			break;
+		case kCaptureCopyStoredToDisplay:
+			_gfx->copyStoredToDisplay();
+			break;
+		case kCaptureDimScreen:
+			_gfx->dimScreen();
+			break;
+		case kCaptureDimRegion: {
+			int x = _stream->readSint32LE();
+			int y = _stream->readSint32LE();
+			int w = _stream->readSint32LE();
+			int h = _stream->readSint32LE();
+			float level = readFloat();
+			_gfx->dimRegion(x, y, w, h, level);
+			break;
+		}
+		case kCaptureIrisAroundRegion: {
+			int x1 = _stream->readSint32LE();
+			int y1 = _stream->readSint32LE();
+			int x2 = _stream->readSint32LE();
+			int y2 = _stream->readSint32LE();
+			_gfx->irisAroundRegion(x1, y1, x2, y2);
+			break;
+		}
+		case kCaptureDefineTexture:
+			defineTexture();
+			break;
+		case kCaptureDefineBitmap:
+			defineBitmap();
+			break;
+		case kCaptureDefineMesh:
+			defineMesh();
+			break;
+		case kCaptureDefineShadow:
+			defineShadow();
+			break;
+		case kCaptureDrawSprite:
+			drawSprite();
+			break;
+		case kCaptureDefineText:
+			defineText();
+			break;
+		case kCaptureDrawText: {
+			Common::Array<GfxTinyGL::TextObjectData> *lines = _texts[_stream->readUint32LE()];
+			if (!lines->empty())
+				_gfx->drawTextLines(&(*lines)[0], lines->size());
+			break;
+		}
+		case kCaptureDrawRectangle:
+		case kCaptureDrawLine:
+		case kCaptureDrawPolygon:
+			drawPrimitive(op);
+			break;
+		case kCaptureDrawEmergString:
+			drawEmergString();
+			break;
+		case kCapturePrepareMovieFrame:
+			prepareMovieFrame();
+			break;
+		case kCaptureDrawMovieFrame: {
+			int x = _stream->readSint32LE();
+			int y = _stream->readSint32LE();
+			_gfx->drawMovieFrame(x, y);
+			break;
+		}
+		case kCaptureReleaseMovieFrame:
+			_gfx->releaseMovieFrame();
+			break;
+		default:
+			error("GfxReplay: Unknown op %d at %d", op, _stream->pos() - 1);
+		}
+	}
+
+	return frames;
+}
+
+void runGfxBenchmark(const Common::String &filename, int loops) {
+	Common::FSNode node(filename);
+	Common::SeekableReadStream *file = node.createReadStream();
+	if (!file) {
+		warning("runGfxBenchmark: Could not open %s", filename.c_str());
+		return;
+	}
+
+	// Replay from memory, so that only the renderer is measured
+	uint32 size = file->size();
+	byte *data = new byte[size];
+	file->read(data, size);
+	delete file;
+	Common::MemoryReadStream stream(data, size);
+
+	if (stream.readUint32BE() != MKTAG('G','F','X','C') || stream.readUint32LE() != kCaptureVersion) {
+		warning("runGfxBenchmark: %s is not a capture of this version", filename.c_str());
+		delete[] data;
+		return;
+	}
+	int width = stream.readUint32LE();
+	int height = stream.readUint32LE();
+
+	GfxTinyGL *gfx = new GfxTinyGL();
+	gfx->setupOffscreen(width, height);
+
+	GfxReplay *replay = new GfxReplay(gfx, &stream);
+	// The first pass creates the resources and is not measured
+	int frames = replay->play();
+	if (frames > 0 && loops > 0) {
+		static const struct {
+			const char *name;
+			bool binning;
+			bool simdSpans;
+		} configs[] = {
+			{ "scalar", false, false },
+			{ "simd spans", false, true },
+			{ "binned", true, false },
+			{ "binned simd spans", true, true }
+		};
+		static const char *fillers[TGL_FILL_COUNT] = {
+			"flat", "smooth", "mapping perspective", "flat shadow mask", "flat shadow"
+		};
+		unsigned int triangles[TGL_FILL_COUNT], pixels[TGL_FILL_COUNT];
+
+		// The work of each filler does not depend on the configuration, so
+		// it is counted in one more pass and the timed passes run without
+		// the counters
+		tglEnable(TGL_FILL_STATS);
+		tglResetFillStats();
+		replay->play();
+		tglGetFillStats(triangles, pixels);
+		tglDisable(TGL_FILL_STATS);
+
+		double totalTriangles = 0, totalPixels = 0;
+		for (int f = 0; f < TGL_FILL_COUNT; f++) {
+			totalTriangles += triangles[f];
+			totalPixels += pixels[f];
+		}
+
+		debug("runGfxBenchmark: %s, %d frames, %d loops", filename.c_str(), frames, loops);
+		for (int c = 0; c < ARRAYSIZE(configs); c++) {
+			if (configs[c].simdSpans && !TinyGL::ZB_hasSimdSpans())
+				continue;
+
+			gfx->setRasterizerOptions(configs[c].binning, configs[c].simdSpans);
+			uint32 start = g_system->getMillis();
+			for (int l = 0; l < loops; l++)
+				replay->play();
+			uint32 time = MAX<uint32>(g_system->getMillis() - start, 1);
+
+			debug("%-18s %8.2f frames/s %12.0f triangles/s %8.2f Mpixels/s", configs[c].name,
+				  frames * loops * 1000.0 / time, totalTriangles * loops * 1000.0 / time,
+				  totalPixels * loops / 1000.0 / time);
+		}
+
+		debug("per frame:");
+		for (int f = 0; f < TGL_FILL_COUNT; f++) {
+			if (triangles[f] == 0)
+				continue;
+			debug("%-18s %8u triangles %10u pixels", fillers[f], triangles[f] / frames, pixels[f] / frames);
+		}
+	} else if (frames == 0) {
+		warning("runGfxBenchmark: %s has no complete frame", filename.c_str());
+	}
+
+	delete replay;
+	delete gfx;
+	g_driver = NULL;
+	delete[] data;
+}
+
+} // end of namespace Grim
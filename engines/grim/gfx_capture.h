@@ -0,0 +1,211 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ */
+
+#ifndef GRIM_GFX_CAPTURE_H
+#define GRIM_GFX_CAPTURE_H
+
+#include "common/hashmap.h"
+#include "common/str.h"
+
+#include "engines/grim/gfx_base.h"
+
+namespace Common {
+	class WriteStream;
+}
+
+namespace Grim {
+
+class GfxTinyGL;
+
+struct GfxCapturePointerHash {
+	uint operator()(const void *ptr) const { return (uint)((size_t)ptr >> 2); }
+};
+
+/**
+ * Records the calls made to the software renderer into a file, so that the
+ * frames can be replayed by runGfxBenchmark without the rest of the engine.
+ *
+ * The capture forwards every call to the wrapped driver and writes the
+ * ones that draw to the screen. Meshes, faces and sprites are stored with
+ * the model view matrix they were drawn with, textures and bitmaps with
+ * their data, when first used. Text objects are stored as rendered by the
+ * driver, since the replay has no fonts, and movie frames with their
+ * pixels.
+ *
+ * The model view matrix is read back from TinyGL, so only GfxTinyGL can be
+ * captured.
+ *
+ * Configured with the "gfx_capture" (file name), "gfx_capture_skip"
+ * (frames to let pass first) and "gfx_capture_frames" keys.
+ */
+class GfxCapture : public GfxBase {
+public:
+	GfxCapture(GfxTinyGL *gfx, const Common::String &filename, int skipFrames, int numFrames);
+	virtual ~GfxCapture();
+
+	byte *setupScreen(int screenW, int screenH, bool fullscreen);
+	bool isHardwareAccelerated();
+
+	void setupCamera(float fov, float nclip, float fclip, float roll);
+	void positionCamera(Math::Vector3d pos, Math::Vector3d interest);
+
+	void clearScreen();
+	void flipBuffer();
+	void invalidateScreen();
+
+	void getBoundingBoxPos(const Mesh *mesh, int *x1, int *y1, int *x2, int *y2);
+	void startActorDraw(Math::Vector3d pos, float scale, const Math::Angle &yaw,
+						const Math::Angle &pitch, const Math::Angle &roll);
+	void finishActorDraw();
+	void setShadow(Shadow *shadow);
+	void drawShadowPlanes();
+	void setShadowMode();
+	void clearShadowMode();
+	void setShadowColor(byte r, byte g, byte b);
+	void getShadowColor(byte *r, byte *g, byte *b);
+
+	void set3DMode();
+
+	void translateViewpointStart(Math::Vector3d pos, const Math::Angle &pitch,
+								 const Math::Angle &yaw, const Math::Angle &roll);
+	void translateViewpointFinish();
+
+	void drawHierachyNode(const ModelNode *node, int *x1, int *y1, int *x2, int *y2);
+	void drawMesh(const Mesh *mesh);
+	void drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts);
+	void drawSprite(const Sprite *sprite);
+
+	void enableLights();
+	void disableLights();
+	void setupLight(Light *light, int lightId);
+
+	void createMaterial(Texture *material, const char *data, const CMap *cmap);
+	void selectMaterial(const Texture *material);
+	void destroyMaterial(Texture *material);
+	bool setMaterialColormap(Texture *material, const CMap *cmap);
+
+	void createBitmap(BitmapData *bitmap);
+	void prepareBitmap(BitmapData *bitmap);
+	void drawBitmap(const Bitmap *bitmap);
+	void destroyBitmap(BitmapData *bitmap);
+
+	void createFont(Font *font);
+	void destroyFont(Font *font);
+
+	void createTextObject(TextObject *text);
+	void drawTextObject(TextObject *text);
+	void destroyTextObject(TextObject *text);
+
+	Bitmap *getScreenshot(int w, int h);
+	void storeDisplay();
+	void copyStoredToDisplay();
+
+	void dimScreen();
+	void dimRegion(int x, int y, int w, int h, float level);
+	void irisAroundRegion(int x1, int y1, int x2, int y2);
+
+	void drawEmergString(int x, int y, const char *text, const Color &fgColor);
+	void loadEmergFont();
+
+	void drawRectangle(PrimitiveObject *primitive);
+	void drawLine(PrimitiveObject *primitive);
+	void drawPolygon(PrimitiveObject *primitive);
+
+	void prepareMovieFrame(Graphics::Surface *frame);
+	void drawMovieFrame(int offsetX, int offsetY);
+	void releaseMovieFrame();
+
+	const char *getVideoDeviceName();
+
+	void saveState(SaveGame *state);
+	void restoreState(SaveGame *state);
+
+	void renderBitmaps(bool render);
+	void renderZBitmaps(bool render);
+
+private:
+	struct TextureCopy {
+		int _width, _height;
+		bool _hasAlpha;
+		char _colors[256 * 3];
+		byte *_data;
+	};
+
+	struct BitmapCopy {
+		int _format, _bpp;
+		int _width, _height;
+		int _numImages;
+		byte *_data;
+	};
+
+	typedef Common::HashMap<const void *, uint32, GfxCapturePointerHash> IdMap;
+	typedef Common::HashMap<const void *, TextureCopy *, GfxCapturePointerHash> TextureMap;
+	typedef Common::HashMap<const void *, BitmapCopy *, GfxCapturePointerHash> BitmapMap;
+
+	void startCapture();
+	void finishCapture();
+	void writeOp(int op);
+	void writeFloat(float value);
+	void writeVector(const Math::Vector3d &vec);
+	void writeModelView();
+	uint32 writeTexture(const Texture *texture);
+	uint32 writeBitmap(const BitmapData *bitmap);
+	uint32 writeMesh(const Mesh *mesh);
+	uint32 writeShadow(const Shadow *shadow);
+	uint32 writeText(TextObject *text);
+	void writePrimitive(int op, PrimitiveObject *primitive);
+
+	GfxTinyGL *_gfx;
+	Common::String _filename;
+	Common::WriteStream *_out;
+	int _skipFrames;
+	int _numFrames;
+	int _frame;
+	uint32 _nextId;
+	bool _inMesh;
+
+	// Copies of the data of every live texture and bitmap, they can be
+	// recorded any time after they were created.
+	TextureMap _textures;
+	BitmapMap _bitmaps;
+
+	// Ids of the resources already written to the current capture
+	IdMap _textureIds;
+	IdMap _bitmapIds;
+	IdMap _meshIds;
+	IdMap _shadowIds;
+	IdMap _textIds;
+};
+
+/**
+ * Replays a file written by GfxCapture against an offscreen TinyGL renderer
+ * with each rasterizer configuration, and reports frames, triangles and
+ * pixels per second together with the work done by each triangle filler.
+ *
+ * @param filename	the capture to replay
+ * @param loops		how many times each configuration replays the capture
+ */
+void runGfxBenchmark(const Common::String &filename, int loops);
+
+} // end of namespace Grim
+
+#endif
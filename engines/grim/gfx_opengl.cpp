@@ -420,6 +420,11 @@ void GfxOpenGL::set3DMode() {
 	glDepthFunc(GL_LESS);
 }
 
+void GfxOpenGL::drawMesh(const Mesh *mesh) {
+	for (int i = 0; i < mesh->_numFaces; i++)
+		mesh->_faces[i].draw(mesh->_vertices, mesh->_vertNormals, mesh->_textureVerts);
+}
+
 void GfxOpenGL::drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts) {
 	// Support transparency in actor objects, such as the message tube
 	// in Manny's Office
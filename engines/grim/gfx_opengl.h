@@ -78,6 +78,7 @@ public:
 	void translateViewpointFinish();
 
 	void drawHierachyNode(const ModelNode *node, int *x1, int *y1, int *x2, int *y2);
+	void drawMesh(const Mesh *mesh);
 	void drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts);
 	void drawSprite(const Sprite *sprite);
 
@@ -22,6 +22,7 @@
 
 #include "common/endian.h"
 #include "common/system.h"
+#include "common/config-manager.h"
 
 #include "graphics/surface.h"
 
@@ -143,15 +144,73 @@ TGLint tgluProject(TGLfloat objx, TGLfloat objy, TGLfloat objz, const TGLfloat m
 	return TGL_TRUE;
 }
 
+// out = a * b
+static void multMatrix(TGLfloat out[16], const TGLfloat a[16], const TGLfloat b[16]) {
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			out[col * 4 + row] = a[row] * b[col * 4] + a[4 + row] * b[col * 4 + 1] +
+								 a[8 + row] * b[col * 4 + 2] + a[12 + row] * b[col * 4 + 3];
+		}
+	}
+}
+
+// Projects count points, sets of 3, with the combined model view and
+// projection matrix mvp and grows the window bounds to include them.
+static void tgluProjectBounds(const TGLfloat *points, int count, const TGLfloat mvp[16], const TGLint viewport[4],
+		TGLfloat *left, TGLfloat *top, TGLfloat *right, TGLfloat *bottom) {
+	const TGLfloat halfW = viewport[2] / 2.0f, halfH = viewport[3] / 2.0f;
+
+	for (int i = 0; i < count; i++, points += 3) {
+		TGLfloat x = mvp[0] * points[0] + mvp[4] * points[1] + mvp[8] * points[2] + mvp[12];
+		TGLfloat y = mvp[1] * points[0] + mvp[5] * points[1] + mvp[9] * points[2] + mvp[13];
+		TGLfloat w = mvp[3] * points[0] + mvp[7] * points[1] + mvp[11] * points[2] + mvp[15];
+		if (w == 0.0f)
+			continue;
+
+		TGLfloat winX = viewport[0] + (1 + x / w) * halfW;
+		TGLfloat winY = viewport[1] + (1 + y / w) * halfH;
+		if (winX > *right)
+			*right = winX;
+		if (winX < *left)
+			*left = winX;
+		if (winY < *top)
+			*top = winY;
+		if (winY > *bottom)
+			*bottom = winY;
+	}
+}
+
+// Threads rasterizing the bands of binned triangles besides the main one
+static int getBandThreads() {
+	int threads = 3;
+	if (ConfMan.hasKey("tinygl_band_threads"))
+		threads = ConfMan.getInt("tinygl_band_threads");
+	return threads;
+}
+
 GfxTinyGL::GfxTinyGL() {
 	g_driver = this;
 	_zb = NULL;
 	_storedDisplay = NULL;
+	_offscreen = false;
+	// Rasterize actors in screen bands instead of triangle by triangle
+	_triangleBinning = ConfMan.hasKey("tinygl_binning") && ConfMan.getBool("tinygl_binning");
+	// Only restore and flip the parts of the screen that changed
+	_dirtyRects = ConfMan.hasKey("tinygl_dirty_rects") && ConfMan.getBool("tinygl_dirty_rects");
+	_clearPending = false;
+	_screenValid = false;
+	_flipAll = true;
+	_background = NULL;
+	_backgroundZ = NULL;
+	_pendingBackground = NULL;
+	_pendingBackgroundZ = NULL;
 }
 
 GfxTinyGL::~GfxTinyGL() {
 	delete[] _storedDisplay;
 	if (_zb) {
+		for (Common::HashMap<const CMap *, Palettes, CMapHash>::iterator i = _palettes.begin(); i != _palettes.end(); ++i)
+			tglDeleteTextures(2, i->_value.textures);
 		TinyGL::glClose();
 		ZB_close(_zb);
 	}
@@ -160,27 +219,63 @@ GfxTinyGL::~GfxTinyGL() {
 byte *GfxTinyGL::setupScreen(int screenW, int screenH, bool fullscreen) {
 	byte *buffer = g_system->setupScreen(screenW, screenH, fullscreen, false);
 
-	_screenWidth = screenW;
-	_screenHeight = screenH;
-	_screenBPP = 15;
 	_isFullscreen = g_system->getFeatureState(OSystem::kFeatureFullscreenMode);
 
 	g_system->showMouse(!fullscreen);
 
 	g_system->setWindowCaption("Residual: Software 3D Renderer");
 
+	setupZBuffer(screenW, screenH, buffer);
+
+	return buffer;
+}
+
+byte *GfxTinyGL::setupOffscreen(int screenW, int screenH) {
+	_isFullscreen = false;
+	_offscreen = true;
+
+	// Let TinyGL allocate the frame buffer
+	setupZBuffer(screenW, screenH, NULL);
+
+	return (byte *)_zb->pbuf;
+}
+
+void GfxTinyGL::setupZBuffer(int screenW, int screenH, byte *buffer) {
+	_screenWidth = screenW;
+	_screenHeight = screenH;
+	_screenBPP = 15;
+
 	_zb = TinyGL::ZB_open(screenW, screenH, ZB_MODE_5R6G5B, buffer);
 	TinyGL::glInit(_zb);
+	if (_triangleBinning)
+		TinyGL::ZB_setBandThreads(_zb, getBandThreads());
+	// The rasterized bounds are only needed for the dirty rects
+	_zb->track_damage = _dirtyRects;
 
 	_storedDisplay = new byte[640 * 480 * 2];
 	memset(_storedDisplay, 0, 640 * 480 * 2);
 
 	_currentShadowArray = NULL;
 
+	_clearPending = false;
+	_screenValid = false;
+	_flipAll = true;
+	_damage.clear();
+	_flipDamage.clear();
+
 	TGLfloat ambientSource[] = { 0.0f, 0.0f, 0.0f, 1.0f };
 	tglLightModelfv(TGL_LIGHT_MODEL_AMBIENT, ambientSource);
 
-	return buffer;
+	// Store the materials in tiles, which keeps texturing in cache
+	if (ConfMan.hasKey("tinygl_texture_tiling") && ConfMan.getBool("tinygl_texture_tiling"))
+		tglEnable(TGL_TEXTURE_TILING);
+}
+
+void GfxTinyGL::setRasterizerOptions(bool binning, bool simdSpans) {
+	_triangleBinning = binning;
+	if (binning && !_zb->band_pool)
+		TinyGL::ZB_setBandThreads(_zb, getBandThreads());
+	_zb->simd_spans = simdSpans && TinyGL::ZB_hasSimdSpans();
 }
 
 const char *GfxTinyGL::getVideoDeviceName() {
@@ -210,13 +305,137 @@ void GfxTinyGL::positionCamera(Math::Vector3d pos, Math::Vector3d interest) {
 }
 
 void GfxTinyGL::clearScreen() {
+	if (_dirtyRects) {
+		// The clear waits for the first thing drawn that isn't a full
+		// screen background. When the backgrounds are the same as the
+		// ones on the screen only the damaged rectangles get restored.
+		_clearPending = true;
+		_pendingBackground = NULL;
+		_pendingBackgroundZ = NULL;
+		return;
+	}
+
 	memset(_zb->pbuf, 0, 640 * 480 * 2);
 	memset(_zb->zbuf, 0, 640 * 480 * 2);
 	memset(_zb->zbuf2, 0, 640 * 480 * 4);
 }
 
 void GfxTinyGL::flipBuffer() {
-	g_system->updateScreen();
+	if (!_dirtyRects) {
+		if (!_offscreen)
+			g_system->updateScreen();
+		return;
+	}
+
+	restoreBackground();
+	collectDamage();
+	if (!_offscreen) {
+		if (_flipAll)
+			g_system->updateScreen();
+		else
+			g_system->updateScreenRects(_flipDamage.begin(), _flipDamage.size());
+	}
+	_flipDamage.clear();
+	_flipAll = false;
+}
+
+void GfxTinyGL::invalidateScreen() {
+	_screenValid = false;
+	_flipAll = true;
+}
+
+static void addRect(Common::Array<Common::Rect> &rects, Common::Rect rect) {
+	// Rectangles close to each other are merged, which keeps the list short
+	for (uint i = 0; i < rects.size();) {
+		Common::Rect r = rects[i];
+		r.grow(8);
+		if (r.intersects(rect)) {
+			rect.extend(rects[i]);
+			rects.remove_at(i);
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+	rects.push_back(rect);
+
+	if (rects.size() > 16) {
+		for (uint i = 1; i < rects.size(); i++)
+			rects[0].extend(rects[i]);
+		rects.resize(1);
+	}
+}
+
+void GfxTinyGL::restoreBackground() {
+	if (!_clearPending)
+		return;
+	_clearPending = false;
+
+	collectDamage();
+	if (_screenValid && _pendingBackground == _background && _pendingBackgroundZ == _backgroundZ) {
+		for (uint i = 0; i < _damage.size(); i++)
+			restoreRect(_damage[i]);
+	} else {
+		_background = _pendingBackground;
+		_backgroundZ = _pendingBackgroundZ;
+		restoreRect(Common::Rect(640, 480));
+		_screenValid = true;
+		_flipAll = true;
+	}
+	_damage.clear();
+}
+
+// Puts back the background, the background z-buffer and an empty
+// actor z-buffer inside rect, as a full clear and redraw would.
+void GfxTinyGL::restoreRect(const Common::Rect &rect) {
+	const int w = rect.width();
+	for (int y = rect.top; y < rect.bottom; y++) {
+		const int offset = y * 640 + rect.left;
+		memset(_zb->zbuf2 + offset, 0, w * 4);
+		if (_backgroundZ)
+			memcpy(_zb->zbuf + offset, _backgroundZ + offset * 2, w * 2);
+		else
+			memset(_zb->zbuf + offset, 0, w * 2);
+
+		uint16 *dst = (uint16 *)_zb->pbuf + offset;
+		if (_background) {
+			const byte *src = _background + offset * 2;
+			for (int x = 0; x < w; x++) {
+				uint16 pixel = READ_UINT16(src + x * 2);
+				dst[x] = pixel != 0xf81f ? pixel : 0;
+			}
+		} else {
+			memset(dst, 0, w * 2);
+		}
+	}
+	addRect(_flipDamage, rect);
+}
+
+void GfxTinyGL::addDamage(int x, int y, int w, int h) {
+	if (!_dirtyRects)
+		return;
+
+	int x2 = MIN(x + w, 640);
+	int y2 = MIN(y + h, 480);
+	x = MAX(x, 0);
+	y = MAX(y, 0);
+	if (x >= x2 || y >= y2)
+		return;
+
+	Common::Rect rect(x, y, x2, y2);
+	addRect(_damage, rect);
+	addRect(_flipDamage, rect);
+}
+
+// Adds what TinyGL rasterized to the damage. The bounds are of the
+// vertices, the fillers may round a pixel past them.
+void GfxTinyGL::collectDamage() {
+	if (_zb->damage_x1 > _zb->damage_x2)
+		return;
+
+	addDamage(_zb->damage_x1 - 1, _zb->damage_y1 - 1, _zb->damage_x2 - _zb->damage_x1 + 3,
+			  _zb->damage_y2 - _zb->damage_y1 + 3);
+	TinyGL::ZB_resetDamage(_zb);
 }
 
 bool GfxTinyGL::isHardwareAccelerated() {
@@ -281,40 +500,35 @@ void GfxTinyGL::getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2,
 		return;
 	}
 
+	TGLfloat modelView[16], projection[16], mvp[16];
+	TGLint viewPort[4];
+
+	tglGetFloatv(TGL_MODELVIEW_MATRIX, modelView);
+	tglGetFloatv(TGL_PROJECTION_MATRIX, projection);
+	tglGetIntegerv(TGL_VIEWPORT, viewPort);
+	multMatrix(mvp, projection, modelView);
+
+	// idle actors seen by a still camera keep their bounds
+	Mesh::ScreenBounds &bounds = model->_screenBounds;
+	if (bounds._valid && memcmp(bounds._matrix, mvp, sizeof(mvp)) == 0 &&
+			memcmp(bounds._viewport, viewPort, sizeof(viewPort)) == 0) {
+		*x1 = bounds._x1;
+		*y1 = bounds._y1;
+		*x2 = bounds._x2;
+		*y2 = bounds._y2;
+		return;
+	}
+	memcpy(bounds._matrix, mvp, sizeof(mvp));
+	memcpy(bounds._viewport, viewPort, sizeof(viewPort));
+	bounds._valid = true;
+
 	TGLfloat top = 1000;
 	TGLfloat right = -1000;
 	TGLfloat left = 1000;
 	TGLfloat bottom = -1000;
-	TGLfloat winX, winY, winZ;
-
-	for (int i = 0; i < model->_numFaces; i++) {
-		Math::Vector3d v;
-		float* pVertices;
-
-		for (int j = 0; j < model->_faces[i]._numVertices; j++) {
-			TGLfloat modelView[16], projection[16];
-			TGLint viewPort[4];
-
-			tglGetFloatv(TGL_MODELVIEW_MATRIX, modelView);
-			tglGetFloatv(TGL_PROJECTION_MATRIX, projection);
-			tglGetIntegerv(TGL_VIEWPORT, viewPort);
 
-			pVertices = model->_vertices + 3 * model->_faces[i]._vertices[j];
-
-			v.set(*(pVertices), *(pVertices + 1), *(pVertices + 2));
-
-			tgluProject(v.x(), v.y(), v.z(), modelView, projection, viewPort, &winX, &winY, &winZ);
-
-			if (winX > right)
-				right = winX;
-			if (winX < left)
-				left = winX;
-			if (winY < top)
-				top = winY;
-			if (winY > bottom)
-				bottom = winY;
-		}
-	}
+	// the array vertices are exactly the vertices used by the faces
+	tgluProjectBounds(model->_arrayVertices, model->_numArrayVerts, mvp, viewPort, &left, &top, &right, &bottom);
 
 	float t = bottom;
 	bottom = 480 - top;
@@ -330,17 +544,17 @@ void GfxTinyGL::getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2,
 		bottom = 479;
 
 	if (top > 479 || left > 639 || bottom < 0 || right < 0) {
-		*x1 = -1;
-		*y1 = -1;
-		*x2 = -1;
-		*y2 = -1;
+		*x1 = bounds._x1 = -1;
+		*y1 = bounds._y1 = -1;
+		*x2 = bounds._x2 = -1;
+		*y2 = bounds._y2 = -1;
 		return;
 	}
 
-	*x1 = (int)left;
-	*y1 = (int)top;
-	*x2 = (int)right;
-	*y2 = (int)bottom;
+	*x1 = bounds._x1 = (int)left;
+	*y1 = bounds._y1 = (int)top;
+	*x2 = bounds._x2 = (int)right;
+	*y2 = bounds._y2 = (int)bottom;
 /*
 	uint16 *dst = (uint16 *)_zb->pbuf;
 	uint16 c = 0xffff;
@@ -360,6 +574,9 @@ void GfxTinyGL::getBoundingBoxPos(const Mesh *model, int *x1, int *y1, int *x2,
 
 void GfxTinyGL::startActorDraw(Math::Vector3d pos, float scale, const Math::Angle &yaw,
 							   const Math::Angle &pitch, const Math::Angle &roll) {
+	restoreBackground();
+	if (_triangleBinning)
+		tglEnable(TGL_TRIANGLE_BINNING);
 	tglEnable(TGL_TEXTURE_2D);
 	tglMatrixMode(TGL_MODELVIEW);
 	tglPushMatrix();
@@ -389,6 +606,8 @@ void GfxTinyGL::finishActorDraw() {
 	tglMatrixMode(TGL_MODELVIEW);
 	tglPopMatrix();
 	tglDisable(TGL_TEXTURE_2D);
+	if (_triangleBinning)
+		tglDisable(TGL_TRIANGLE_BINNING);
 
 	if (_currentShadowArray) {
 		tglSetShadowMaskBuf(NULL);
@@ -441,6 +660,7 @@ void GfxTinyGL::clearShadowMode() {
 }
 
 void GfxTinyGL::set3DMode() {
+	restoreBackground();
 	tglMatrixMode(TGL_MODELVIEW);
 	tglEnable(TGL_DEPTH_TEST);
 }
@@ -465,6 +685,41 @@ void GfxTinyGL::getShadowColor(byte *r, byte *g, byte *b) {
 	*b = _shadowColorB;
 }
 
+void GfxTinyGL::drawMesh(const Mesh *mesh) {
+	tglEnableClientState(TGL_VERTEX_ARRAY);
+	tglEnableClientState(TGL_NORMAL_ARRAY);
+	tglEnableClientState(TGL_TEXTURE_COORD_ARRAY);
+	tglVertexPointer(3, TGL_FLOAT, 0, mesh->_arrayVertices);
+	tglNormalPointer(TGL_FLOAT, 0, mesh->_arrayNormals);
+	tglTexCoordPointer(2, TGL_FLOAT, 0, mesh->_arrayTextureVerts);
+
+	// The vertices are shared by many faces. With the arrays locked TinyGL
+	// transforms and lights each of them only once, while selecting the
+	// materials in between only touches the texture state.
+	// Faces without texture vertices keep using the current texture
+	// coordinate, which is the last one of the previous face, like the
+	// immediate mode path does.
+	tglLockArrays(0, mesh->_numArrayVerts);
+	bool texCoords = true;
+	for (int i = 0; i < mesh->_numFaces; i++) {
+		const MeshFace *face = &mesh->_faces[i];
+		face->_material->select();
+		if (texCoords != (face->_texVertices != NULL)) {
+			texCoords = !texCoords;
+			if (texCoords)
+				tglEnableClientState(TGL_TEXTURE_COORD_ARRAY);
+			else
+				tglDisableClientState(TGL_TEXTURE_COORD_ARRAY);
+		}
+		tglDrawElements(TGL_POLYGON, face->_numVertices, TGL_UNSIGNED_INT, face->_arrayIndices);
+	}
+	tglUnlockArrays();
+
+	tglDisableClientState(TGL_VERTEX_ARRAY);
+	tglDisableClientState(TGL_NORMAL_ARRAY);
+	tglDisableClientState(TGL_TEXTURE_COORD_ARRAY);
+}
+
 void GfxTinyGL::drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts) {
 	tglNormal3fv(const_cast<float *>(face->_normal.getData()));
 	tglBegin(TGL_POLYGON);
@@ -624,6 +879,10 @@ void GfxTinyGL::setupLight(Light *light, int lightId) {
 }
 
 void GfxTinyGL::createBitmap(BitmapData *bitmap) {
+	// Bitmaps are blitted straight from their data, see prepareBitmap
+}
+
+void GfxTinyGL::prepareBitmap(BitmapData *bitmap) {
 	// We want an RGB565-bitmap in TinyGL.
 	if (bitmap->_colorFormat != BM_RGB565) {
 		bitmap->convertToColorFormat(0, BM_RGB565);
@@ -639,6 +898,11 @@ void GfxTinyGL::createBitmap(BitmapData *bitmap) {
 	}
 }
 
+uint32 GfxTinyGL::getNativeBitmapFormat() const {
+	// RGB565 color and 16 bit depth bitmaps, in native byte order
+	return MKTAG('T', 'G', 'L', '1');
+}
+
 void TinyGLBlit(byte *dst, byte *src, int x, int y, int width, int height, bool trans) {
 	int srcPitch = width * 2;
 	int dstPitch = 640 * 2;
@@ -650,12 +914,14 @@ void TinyGLBlit(byte *dst, byte *src, int x, int y, int width, int height, bool
 
 	if (x < 0) {
 		srcX = -x;
+		width += x;
 		x = 0;
 	} else {
 		srcX = 0;
 	}
 	if (y < 0) {
 		srcY = -y;
+		height += y;
 		y = 0;
 	} else {
 		srcY = 0;
@@ -667,8 +933,11 @@ void TinyGLBlit(byte *dst, byte *src, int x, int y, int width, int height, bool
 	if (y + height > 480)
 		height -= (y + height) - 480;
 
+	if (width <= 0 || height <= 0)
+		return;
+
 	dst += (x + (y * 640)) * 2;
-	src += (srcX + (srcY * width)) * 2;
+	src += srcX * 2 + srcY * srcPitch;
 
 	int copyWidth = width * 2;
 
@@ -698,15 +967,33 @@ void GfxTinyGL::drawBitmap(const Bitmap *bitmap) {
 	}
 
 	assert(bitmap->getActiveImage() > 0);
+	if (_clearPending && bitmap->getX() == 0 && bitmap->getY() == 0 &&
+			bitmap->getWidth() == 640 && bitmap->getHeight() == 480) {
+		// a background, drawn by restoreBackground
+		const byte *data = (const byte *)bitmap->getData(bitmap->getActiveImage() - 1);
+		if (format == 1 && !_pendingBackground) {
+			_pendingBackground = data;
+			return;
+		} else if (format == 5 && !_pendingBackgroundZ) {
+			_pendingBackgroundZ = data;
+			return;
+		}
+	}
+	restoreBackground();
+
 	if (bitmap->getFormat() == 1)
 		TinyGLBlit((byte *)_zb->pbuf, (byte *)bitmap->getData(bitmap->getActiveImage() - 1),
 			bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight(), true);
 	else
 		TinyGLBlit((byte *)_zb->zbuf, (byte *)bitmap->getData(bitmap->getActiveImage() - 1),
 			bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight(), false);
+	addDamage(bitmap->getX(), bitmap->getY(), bitmap->getWidth(), bitmap->getHeight());
 }
 
-void GfxTinyGL::destroyBitmap(BitmapData *) { }
+void GfxTinyGL::destroyBitmap(BitmapData *) {
+	// A new background may get the memory of the one on the screen
+	invalidateScreen();
+}
 
 void GfxTinyGL::createFont(Font *font) {
 }
@@ -714,11 +1001,6 @@ void GfxTinyGL::createFont(Font *font) {
 void GfxTinyGL::destroyFont(Font *font) {
 }
 
-struct TextObjectData {
-	byte *data;
-	int width, height, x, y;
-};
-
 void GfxTinyGL::createTextObject(TextObject *text) {
 	int numLines = text->getNumLines();
 	const Common::String *lines = text->getLines();
@@ -792,13 +1074,16 @@ void GfxTinyGL::createTextObject(TextObject *text) {
 
 void GfxTinyGL::drawTextObject(TextObject *text) {
 	TextObjectData *userData = (TextObjectData *)text->getUserData();
-	if (userData) {
-		int numLines = text->getNumLines();
-		for (int i = 0; i < numLines; ++i) {
-			TinyGLBlit((byte *)_zb->pbuf, userData[i].data, userData[i].x, userData[i].y, userData[i].width, userData[i].height, true);
-		}
-	}
+	if (userData)
+		drawTextLines(userData, text->getNumLines());
+}
 
+void GfxTinyGL::drawTextLines(const TextObjectData *lines, int numLines) {
+	restoreBackground();
+	for (int i = 0; i < numLines; ++i) {
+		TinyGLBlit((byte *)_zb->pbuf, lines[i].data, lines[i].x, lines[i].y, lines[i].width, lines[i].height, true);
+		addDamage(lines[i].x, lines[i].y, lines[i].width, lines[i].height);
+	}
 }
 
 void GfxTinyGL::destroyTextObject(TextObject *text) {
@@ -812,40 +1097,68 @@ void GfxTinyGL::destroyTextObject(TextObject *text) {
 	}
 }
 
-void GfxTinyGL::createMaterial(Texture *material, const char *data, const CMap *cmap) {
-	material->_texture = new TGLuint[1];
-	tglGenTextures(1, (TGLuint *)material->_texture);
-	char *texdata = new char[material->_width * material->_height * 4];
-	char *texdatapos = texdata;
-	for (int y = 0; y < material->_height; y++) {
-		for (int x = 0; x < material->_width; x++) {
-			uint8 col = *(uint8 *)(data);
-			if (col == 0) {
-				memset(texdatapos, 0, 4); // transparent
-				if (!material->_hasAlpha) {
-					texdatapos[3] = '\xff'; // fully opaque
-				}
-			} else {
-				memcpy(texdatapos, cmap->_colors + 3 * (col), 3);
-				texdatapos[3] = '\xff'; // fully opaque
-			}
-			texdatapos += 4;
-			data++;
-		}
+// What GfxTinyGL keeps in Texture::_texture
+struct TinyGLMaterial {
+	TGLuint texture;
+	const CMap *cmap;
+};
+
+// Returns the palette texture of the colormap, creating it for the first
+// material using it. Each call must be paired with releasePalette().
+TGLuint GfxTinyGL::acquirePalette(const CMap *cmap, bool hasAlpha) {
+	Common::HashMap<const CMap *, Palettes, CMapHash>::iterator i = _palettes.find(cmap);
+	if (i != _palettes.end()) {
+		i->_value.refCount++;
+		return i->_value.textures[hasAlpha];
+	}
+
+	Palettes palettes;
+	byte colors[256 * 4];
+	for (int c = 1; c < 256; c++) {
+		memcpy(colors + 4 * c, cmap->_colors + 3 * c, 3);
+		colors[4 * c + 3] = 0xff; // fully opaque
+	}
+	tglGenTextures(2, palettes.textures);
+	for (int j = 0; j < 2; j++) {
+		colors[0] = colors[1] = colors[2] = 0;
+		colors[3] = j ? 0 : 0xff; // color 0 is transparent in textures with alpha
+		tglBindTexture(TGL_TEXTURE_2D, palettes.textures[j]);
+		tglTexImage2D(TGL_TEXTURE_2D, 0, 3, 256, 1, 0, TGL_RGBA, TGL_UNSIGNED_BYTE, colors);
 	}
-	TGLuint *textures = (TGLuint *)material->_texture;
-	tglBindTexture(TGL_TEXTURE_2D, textures[0]);
+	palettes.refCount = 1;
+	_palettes[cmap] = palettes;
+	return palettes.textures[hasAlpha];
+}
+
+void GfxTinyGL::releasePalette(const CMap *cmap) {
+	Common::HashMap<const CMap *, Palettes, CMapHash>::iterator i = _palettes.find(cmap);
+	assert(i != _palettes.end());
+	if (--i->_value.refCount == 0) {
+		tglDeleteTextures(2, i->_value.textures);
+		_palettes.erase(i);
+	}
+}
+
+void GfxTinyGL::createMaterial(Texture *material, const char *data, const CMap *cmap) {
+	// The texels stay color indexes, the colors come from the palette
+	// texture of the colormap.
+	TinyGLMaterial *userData = new TinyGLMaterial;
+	userData->cmap = cmap;
+	TGLuint palette = acquirePalette(cmap, material->_hasAlpha);
+	tglGenTextures(1, &userData->texture);
+	material->_texture = userData;
+	tglBindTexture(TGL_TEXTURE_2D, userData->texture);
 	tglTexParameteri(TGL_TEXTURE_2D, TGL_TEXTURE_WRAP_S, TGL_REPEAT);
 	tglTexParameteri(TGL_TEXTURE_2D, TGL_TEXTURE_WRAP_T, TGL_REPEAT);
 	tglTexParameteri(TGL_TEXTURE_2D, TGL_TEXTURE_MAG_FILTER, TGL_LINEAR);
 	tglTexParameteri(TGL_TEXTURE_2D, TGL_TEXTURE_MIN_FILTER, TGL_LINEAR);
-	tglTexImage2D(TGL_TEXTURE_2D, 0, 3, material->_width, material->_height, 0, TGL_RGBA, TGL_UNSIGNED_BYTE, texdata);
-	delete[] texdata;
+	tglTexParameteri(TGL_TEXTURE_2D, TGL_TEXTURE_PALETTE, palette);
+	tglTexImage2D(TGL_TEXTURE_2D, 0, 1, material->_width, material->_height, 0, TGL_COLOR_INDEX, TGL_UNSIGNED_BYTE, const_cast<char *>(data));
 }
 
 void GfxTinyGL::selectMaterial(const Texture *material) {
-	TGLuint *textures = (TGLuint *)material->_texture;
-	tglBindTexture(TGL_TEXTURE_2D, textures[0]);
+	const TinyGLMaterial *userData = (const TinyGLMaterial *)material->_texture;
+	tglBindTexture(TGL_TEXTURE_2D, userData->texture);
 	tglPushMatrix();
 	tglMatrixMode(TGL_TEXTURE);
 	tglLoadIdentity();
@@ -855,8 +1168,22 @@ void GfxTinyGL::selectMaterial(const Texture *material) {
 }
 
 void GfxTinyGL::destroyMaterial(Texture *material) {
-	tglDeleteTextures(1, (TGLuint *)material->_texture);
-	delete[] (TGLuint *)material->_texture;
+	TinyGLMaterial *userData = (TinyGLMaterial *)material->_texture;
+	tglDeleteTextures(1, &userData->texture);
+	releasePalette(userData->cmap);
+	delete userData;
+}
+
+bool GfxTinyGL::setMaterialColormap(Texture *material, const CMap *cmap) {
+	TinyGLMaterial *userData = (TinyGLMaterial *)material->_texture;
+	if (userData->cmap == cmap)
+		return true;
+	TGLuint palette = acquirePalette(cmap, material->_hasAlpha);
+	releasePalette(userData->cmap);
+	userData->cmap = cmap;
+	tglBindTexture(TGL_TEXTURE_2D, userData->texture);
+	tglTexParameteri(TGL_TEXTURE_2D, TGL_TEXTURE_PALETTE, palette);
+	return true;
 }
 
 void GfxTinyGL::prepareMovieFrame(Graphics::Surface* frame) {
@@ -866,10 +1193,13 @@ void GfxTinyGL::prepareMovieFrame(Graphics::Surface* frame) {
 }
 
 void GfxTinyGL::drawMovieFrame(int offsetX, int offsetY) {
+	restoreBackground();
 	if (_smushWidth == 640 && _smushHeight == 480) {
 		memcpy(_zb->pbuf, _smushBitmap, 640 * 480 * 2);
+		addDamage(0, 0, 640, 480);
 	} else {
 		TinyGLBlit((byte *)_zb->pbuf, _smushBitmap, offsetX, offsetY, _smushWidth, _smushHeight, false);
+		addDamage(offsetX, offsetY, _smushWidth, _smushHeight);
 	}
 }
 
@@ -882,6 +1212,8 @@ void GfxTinyGL::loadEmergFont() {
 void GfxTinyGL::drawEmergString(int x, int y, const char *text, const Color &fgColor) {
 	uint16 color = ((fgColor.getRed() & 0xF8) << 8) | ((fgColor.getGreen() & 0xFC) << 3) | (fgColor.getBlue() >> 3);
 
+	restoreBackground();
+	addDamage(x, y, strlen(text) * 10, 13);
 	for (int l = 0; l < (int)strlen(text); l++) {
 		int c = text[l];
 		assert(c >= 32 && c <= 127);
@@ -936,11 +1268,14 @@ Bitmap *GfxTinyGL::getScreenshot(int w, int h) {
 }
 
 void GfxTinyGL::storeDisplay() {
+	restoreBackground();
 	memcpy(_storedDisplay, _zb->pbuf, 640 * 480 * 2);
 }
 
 void GfxTinyGL::copyStoredToDisplay() {
+	restoreBackground();
 	memcpy(_zb->pbuf, _storedDisplay, 640 * 480 * 2);
+	invalidateScreen();
 }
 
 void GfxTinyGL::dimScreen() {
@@ -956,6 +1291,8 @@ void GfxTinyGL::dimScreen() {
 }
 
 void GfxTinyGL::dimRegion(int x, int y, int w, int h, float level) {
+	restoreBackground();
+	addDamage(x, y, w, h);
 	uint16 *data = (uint16 *)_zb->pbuf;
 	for (int ly = y; ly < y + h; ly++) {
 		for (int lx = x; lx < x + w; lx++) {
@@ -970,6 +1307,8 @@ void GfxTinyGL::dimRegion(int x, int y, int w, int h, float level) {
 }
 
 void GfxTinyGL::irisAroundRegion(int x1, int y1, int x2, int y2) {
+	restoreBackground();
+	invalidateScreen();
 	uint16 *data = (uint16 *)_zb->pbuf;
 	for (int ly = 0; ly < _screenHeight; ly++) {
 		for (int lx = 0; lx < _screenWidth; lx++) {
@@ -989,6 +1328,9 @@ void GfxTinyGL::drawRectangle(PrimitiveObject *primitive) {
 	int x2 = primitive->getP2().x;
 	int y2 = primitive->getP2().y;
 
+	restoreBackground();
+	addDamage(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+
 	const Color &color = *primitive->getColor();
 	uint16 c = ((color.getRed() & 0xF8) << 8) | ((color.getGreen() & 0xFC) << 3) | (color.getBlue() >> 3);
 
@@ -1025,6 +1367,9 @@ void GfxTinyGL::drawLine(PrimitiveObject *primitive) {
 	int x2 = primitive->getP2().x;
 	int y2 = primitive->getP2().y;
 
+	restoreBackground();
+	addDamage(x1, MIN(y1, y2) - 1, x2 - x1 + 1, ABS(y2 - y1) + 3);
+
 	const Color &color = *primitive->getColor();
 	uint16 c = ((color.getRed() & 0xF8) << 8) | ((color.getGreen() & 0xFC) << 3) | (color.getBlue() >> 3);
 
@@ -1057,6 +1402,10 @@ void GfxTinyGL::drawPolygon(PrimitiveObject *primitive) {
 	float m;
 	int b;
 
+	restoreBackground();
+	addDamage(x1, MIN(y1, y2) - 1, x2 - x1 + 1, ABS(y2 - y1) + 3);
+	addDamage(x3, MIN(y3, y4) - 1, x4 - x3 + 1, ABS(y4 - y3) + 3);
+
 	const Color &color = *primitive->getColor();
 	uint16 c = ((color.getRed() & 0xF8) << 8) | ((color.getGreen() & 0xFC) << 3) | (color.getBlue() >> 3);
 
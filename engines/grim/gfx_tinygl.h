@@ -23,6 +23,10 @@
 #ifndef GRIM_GFX_TINYGL_H
 #define GRIM_GFX_TINYGL_H
 
+#include "common/array.h"
+#include "common/hashmap.h"
+#include "common/rect.h"
+
 #include "engines/grim/gfx_base.h"
 
 #include "graphics/tinygl/zgl.h"
@@ -40,6 +44,20 @@ public:
 
 	byte *setupScreen(int screenW, int screenH, bool fullscreen);
 
+	/**
+	 * Creates a render-context in memory, without a window.
+	 * Used to benchmark the rasterizer, see GfxCapture.
+	 */
+	byte *setupOffscreen(int screenW, int screenH);
+
+	/**
+	 * Selects the rasterizer paths, overriding the configuration.
+	 *
+	 * @param binning	rasterize actors in screen bands
+	 * @param simdSpans	use the SIMD span kernels, where compiled in
+	 */
+	void setRasterizerOptions(bool binning, bool simdSpans);
+
 	const char *getVideoDeviceName();
 
 	void setupCamera(float fov, float nclip, float fclip, float roll);
@@ -47,6 +65,7 @@ public:
 
 	void clearScreen();
 	void flipBuffer();
+	void invalidateScreen();
 
 	bool isHardwareAccelerated();
 
@@ -69,6 +88,7 @@ public:
 	void translateViewpointFinish();
 
 	void drawHierachyNode(const ModelNode *node, int *x1, int *y1, int *x2, int *y2);
+	void drawMesh(const Mesh *mesh);
 	void drawModelFace(const MeshFace *face, float *vertices, float *vertNormals, float *textureVerts);
 	void drawSprite(const Sprite *sprite);
 
@@ -79,17 +99,34 @@ public:
 	void createMaterial(Texture *material, const char *data, const CMap *cmap);
 	void selectMaterial(const Texture *material);
 	void destroyMaterial(Texture *material);
+	bool setMaterialColormap(Texture *material, const CMap *cmap);
 
 	void createBitmap(BitmapData *bitmap);
+	void prepareBitmap(BitmapData *bitmap);
+	uint32 getNativeBitmapFormat() const;
 	void drawBitmap(const Bitmap *bitmap);
 	void destroyBitmap(BitmapData *bitmap);
 
 	void createFont(Font *font);
 	void destroyFont(Font *font);
 
+	/**
+	 * A line of a text object, rendered by createTextObject to RGB565
+	 * with 0xf81f as the transparent color.
+	 */
+	struct TextObjectData {
+		byte *data;
+		int width, height, x, y;
+	};
+
 	void drawTextObject(TextObject *text);
 	void createTextObject(TextObject *text);
 	void destroyTextObject(TextObject *text);
+	/**
+	 * Draws rendered text lines, as drawTextObject does. Used by the
+	 * replay of GfxCapture, which has no fonts.
+	 */
+	void drawTextLines(const TextObjectData *lines, int numLines);
 
 	void dimScreen();
 	void dimRegion(int x, int y, int w, int h, float level);
@@ -113,12 +150,49 @@ public:
 protected:
 
 private:
+	void setupZBuffer(int screenW, int screenH, byte *buffer);
+	TGLuint acquirePalette(const CMap *cmap, bool hasAlpha);
+	void releasePalette(const CMap *cmap);
+	void restoreBackground();
+	void restoreRect(const Common::Rect &rect);
+	void addDamage(int x, int y, int w, int h);
+	void collectDamage();
+
 	TinyGL::ZBuffer *_zb;
 	byte *_screen;
 	byte *_smushBitmap;
 	int _smushWidth;
 	int _smushHeight;
 	byte *_storedDisplay;
+	bool _triangleBinning;
+
+	// The palette textures of each colormap, shared by all materials
+	// using it and deleted with the last of them. The first one is opaque,
+	// color 0 of the second one is transparent. The materials hold a
+	// reference to their colormap, so an entry never outlives its CMap.
+	struct Palettes {
+		TGLuint textures[2];
+		int refCount;
+	};
+	struct CMapHash {
+		uint operator()(const CMap *cmap) const { return (uint)((size_t)cmap >> 2); }
+	};
+	Common::HashMap<const CMap *, Palettes, CMapHash> _palettes;
+	bool _offscreen;
+
+	// Dirty rectangles, see clearScreen. The screen is the background
+	// plus what was drawn inside _damage since it was restored.
+	bool _dirtyRects;
+	bool _clearPending;
+	bool _screenValid;
+	bool _flipAll;
+	const byte *_background;
+	const byte *_backgroundZ;
+	const byte *_pendingBackground;
+	const byte *_pendingBackgroundZ;
+	Common::Array<Common::Rect> _damage;
+	// changed since the last flip
+	Common::Array<Common::Rect> _flipDamage;
 };
 
 } // end of namespace Grim
@@ -58,6 +58,8 @@
 #include "engines/grim/resource.h"
 #include "engines/grim/localize.h"
 #include "engines/grim/gfx_base.h"
+#include "engines/grim/gfx_capture.h"
+#include "engines/grim/gfx_tinygl.h"
 #include "engines/grim/lab.h"
 #include "engines/grim/bitmap.h"
 #include "engines/grim/font.h"
@@ -225,6 +227,20 @@ Common::Error GrimEngine::run() {
 	}
 	g_imuse = new Imuse(20, demo);
 
+	// Replays a capture made with gfx_capture instead of running the game
+	if (ConfMan.hasKey("gfx_benchmark")) {
+		int loops = ConfMan.hasKey("gfx_benchmark_loops") ? ConfMan.getInt("gfx_benchmark_loops") : 10;
+		runGfxBenchmark(ConfMan.get("gfx_benchmark"), loops);
+		return Common::kNoError;
+	}
+
+	// Decodes and converts all the bitmaps instead of running the game
+	if (ConfMan.hasKey("bitmap_benchmark") && ConfMan.getBool("bitmap_benchmark")) {
+		int loops = ConfMan.hasKey("bitmap_benchmark_loops") ? ConfMan.getInt("bitmap_benchmark_loops") : 10;
+		runBitmapBenchmark(loops);
+		return Common::kNoError;
+	}
+
 	bool fullscreen = (tolower(g_registry->get("fullscreen", "false")[0]) == 't');
 
 	if (!_softRenderer && !g_system->hasFeature(OSystem::kFeatureOpenGL)){
@@ -239,6 +255,17 @@ Common::Error GrimEngine::run() {
 		g_driver = CreateGfxOpenGL();
 #endif
 
+	if (ConfMan.hasKey("gfx_capture")) {
+		// The capture reads the TinyGL state back
+		if (_softRenderer) {
+			int skip = ConfMan.hasKey("gfx_capture_skip") ? ConfMan.getInt("gfx_capture_skip") : 0;
+			int frames = ConfMan.hasKey("gfx_capture_frames") ? ConfMan.getInt("gfx_capture_frames") : 1;
+			g_driver = new GfxCapture((GfxTinyGL *)g_driver, ConfMan.get("gfx_capture"), skip, frames);
+		} else {
+			warning("gfx_capture needs the software renderer, not capturing");
+		}
+	}
+
 	g_driver->setupScreen(640, 480, fullscreen);
 
 	// refresh the theme engine so that we can show the gui overlay without it crashing.
@@ -262,6 +289,8 @@ Common::Error GrimEngine::run() {
 	lua_iolibopen();
 	lua_strlibopen();
 	lua_mathlibopen();
+	// Spread garbage collections over the frames, in steps of this many units of work
+	lua_setgcstep(ConfMan.hasKey("lua_gc_step") ? ConfMan.getInt("lua_gc_step") : 0);
 
 	if (getGameType() == GType_GRIM) {
 		registerGrimOpcodes();
@@ -346,6 +375,14 @@ int GrimEngine::single_dofile(const char *filename) {
 
 extern int refSystemTable;
 
+void GrimEngine::pauseEngineIntern(bool pause) {
+	Engine::pauseEngineIntern(pause);
+
+	// The GUI has been drawn over the screen
+	if (!pause && g_driver)
+		g_driver->invalidateScreen();
+}
+
 void GrimEngine::handlePause() {
 	lua_Object func;
 
@@ -642,10 +679,10 @@ void GrimEngine::luaUpdate() {
 	}
 
 	_frameTimeCollection += _frameTime;
-	if (_frameTimeCollection > 10000) {
+	bool collect = _frameTimeCollection > 10000;
+	if (collect)
 		_frameTimeCollection = 0;
-		lua_collectgarbage(0);
-	}
+	lua_stepgarbage(collect);
 
 	lua_beginblock();
 	setFrameTime(_frameTime);
@@ -687,7 +724,9 @@ void GrimEngine::updateDisplayScene() {
 		if (g_movie->isPlaying()) {
 			_movieTime = g_movie->getMovieTime();
 			if (g_movie->isUpdateNeeded()) {
-				g_driver->prepareMovieFrame(g_movie->getDstSurface());
+				Graphics::Surface *frame = g_movie->getDstSurface();
+				if (frame)
+					g_driver->prepareMovieFrame(frame);
 				g_movie->clearUpdateNeeded();
 			}
 			int frame = g_movie->getFrame();
@@ -742,7 +781,9 @@ void GrimEngine::updateDisplayScene() {
 		if (g_movie->isPlaying()) {
 			_movieTime = g_movie->getMovieTime();
 			if (g_movie->isUpdateNeeded()) {
-				g_driver->prepareMovieFrame(g_movie->getDstSurface());
+				Graphics::Surface *frame = g_movie->getDstSurface();
+				if (frame)
+					g_driver->prepareMovieFrame(frame);
 				g_movie->clearUpdateNeeded();
 			}
 			if (g_movie->getFrame() > 0)
@@ -835,6 +876,10 @@ void GrimEngine::mainLoop() {
 		g_imuse->flushTracks();
 		g_imuse->refreshScripts();
 
+		// No resource is being parsed here, so cached blocks can go
+		g_resourceloader->trimCache();
+		g_resourceloader->processPrefetch();
+
 		// Process events
 		Common::Event event;
 		while (g_system->getEventManager()->pollEvent(event)) {
@@ -1036,6 +1081,7 @@ void GrimEngine::savegameSave() {
 	if (!_savedState) {
 		//TODO: Translate this!
 		GUI::displayErrorDialog("Error: the game could not be saved.");
+		g_driver->invalidateScreen();
 		return;
 	}
 
@@ -1191,6 +1237,12 @@ void GrimEngine::setSet(Set *scene) {
 		a->stopWalking();
 	}
 
+	if (gDebugLevel == DEBUG_NORMAL || gDebugLevel == DEBUG_ALL) {
+		ResourceLoader::CacheStats stats = g_resourceloader->getCacheStats();
+		debug("Resource cache: %u hits, %u misses, %u evictions, %u blocks in %u bytes",
+			  stats.hits, stats.misses, stats.evictions, stats.numEntries, stats.memorySize);
+	}
+
 	Set *lastSet = _currSet;
 	_currSet = scene;
 	_currSet->setSoundParameters(20, 127);
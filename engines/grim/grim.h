@@ -64,6 +64,7 @@ class GrimEngine : public Engine {
 protected:
 	// Engine APIs
 	virtual Common::Error run();
+	virtual void pauseEngineIntern(bool pause);
 
 public:
 	enum EngineMode {
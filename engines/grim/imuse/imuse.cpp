@@ -23,7 +23,9 @@
 #define FORBIDDEN_SYMBOL_EXCEPTION_setjmp
 #define FORBIDDEN_SYMBOL_EXCEPTION_longjmp
 
+#include "common/str.h"
 #include "common/timer.h"
+#include "common/thread.h"
 
 #include "engines/grim/savegame.h"
 #include "engines/grim/debug.h"
@@ -45,9 +47,36 @@ extern ImuseTable grimSeqMusicTable[];
 extern ImuseTable grimDemoStateMusicTable[];
 extern ImuseTable grimDemoSeqMusicTable[];
 
+// Orders the command slot accesses against the ring indices. Without a
+// known barrier the commands are applied straight away under _mutex.
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define IMUSE_COMMAND_BARRIER() __sync_synchronize()
+#endif
+
 void Imuse::timerHandler(void *refCon) {
 	Imuse *imuse = (Imuse *)refCon;
 	imuse->callback();
+	if (imuse->_decodeAheadWorker.isRunning())
+		imuse->_decodeAheadSignal.post();
+}
+
+// Decodes ahead of the play position of the sounds between two callbacks,
+// so that the next callback only copies already decoded data.
+int Imuse::decodeAheadThread(void *refCon) {
+	Imuse *imuse = (Imuse *)refCon;
+
+	for (;;) {
+		// Posted after every callback, and on quitting. _decodeAheadQuit is
+		// set before the post, so the wait orders it.
+		imuse->_decodeAheadSignal.wait();
+		if (imuse->_decodeAheadQuit)
+			break;
+		if (imuse->_pause)
+			continue;
+		while (imuse->_sound->decodeAhead())
+			;
+	}
+	return 0;
 }
 
 Imuse::Imuse(int fps, bool demo) {
@@ -56,12 +85,25 @@ Imuse::Imuse(int fps, bool demo) {
 	_sound = new ImuseSndMgr(_demo);
 	assert(_sound);
 	_callbackFps = fps;
+	_commandHead = 0;
+	_commandTail = 0;
+	_commandsApplied = 0;
+	memset(_status, 0, sizeof(_status));
+	_statusTail = 0;
+	_curMusicSoundName[0] = 0;
 	resetState();
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		_track[l] = new Track;
 		assert(_track[l]);
 		memset(_track[l], 0, sizeof(Track));
 		_track[l]->trackId = l;
+		TrackBuffers &buffers = _trackBuffers[l];
+		buffers.stream = NULL;
+		for (int i = 0; i < kTrackBufferCount; i++) {
+			buffers.data[i] = NULL;
+			buffers.size[i] = 0;
+		}
+		buffers.next = 0;
 	}
 	vimaInit(imuseDestTable);
 	if (_demo) {
@@ -71,14 +113,31 @@ Imuse::Imuse(int fps, bool demo) {
 		_stateMusicTable = grimStateMusicTable;
 		_seqMusicTable = grimSeqMusicTable;
 	}
+	// Without threads the callback decodes the blocks as it reaches them
+	_decodeAheadQuit = false;
+	if (_decodeAheadSignal.isValid())
+		_decodeAheadWorker.start(decodeAheadThread, this);
 	g_system->getTimerManager()->installTimerProc(timerHandler, 1000000 / _callbackFps, this);
 }
 
 Imuse::~Imuse() {
 	g_system->getTimerManager()->removeTimerProc(timerHandler);
-	stopAllSounds();
+	_decodeAheadQuit = true;
+	_decodeAheadSignal.post();
+	_decodeAheadWorker.wait();
+	{
+		Common::StackLock lock(_mutex);
+		processCommands();
+		stopAllTracks();
+	}
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		delete _track[l];
+		// The stream may still be playing from the buffers
+		TrackBuffers &buffers = _trackBuffers[l];
+		if (buffers.stream)
+			g_system->getMixer()->stopHandle(buffers.handle);
+		for (int i = 0; i < kTrackBufferCount; i++)
+			free(buffers.data[i]);
 	}
 	delete _sound;
 }
@@ -89,8 +148,106 @@ void Imuse::resetState() {
 	memset(_attributes, 0, sizeof(_attributes));
 }
 
+bool Imuse::postCommand(const Command &cmd) {
+#ifdef IMUSE_COMMAND_BARRIER
+	uint32 head = _commandHead;
+	if (head - _commandTail == IMUSE_COMMAND_QUEUE_SIZE)
+		return false;
+
+	_commands[head % IMUSE_COMMAND_QUEUE_SIZE] = cmd;
+
+	// Publish the slot only once it is completely written
+	IMUSE_COMMAND_BARRIER();
+	_commandHead = head + 1;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Imuse::sendCommand(int type, const char *soundName, int param1, int param2, int param3, int param4, int param5) {
+	Command cmd;
+	cmd.type = type;
+	Common::strlcpy(cmd.soundName, soundName, sizeof(cmd.soundName));
+	cmd.param1 = param1;
+	cmd.param2 = param2;
+	cmd.param3 = param3;
+	cmd.param4 = param4;
+	cmd.param5 = param5;
+	if (postCommand(cmd))
+		return;
+
+	// The ring is full, apply it in order on this thread instead
+	Common::StackLock lock(_mutex);
+	processCommands();
+	executeCommand(cmd);
+	publishStatus();
+}
+
+void Imuse::processCommands() {
+#ifdef IMUSE_COMMAND_BARRIER
+	// Called with _mutex held. The slots are handed back by publishStatus().
+	uint32 tail = _commandsApplied;
+	while (tail != _commandHead) {
+		IMUSE_COMMAND_BARRIER();
+		executeCommand(_commands[tail % IMUSE_COMMAND_QUEUE_SIZE]);
+		tail++;
+	}
+	_commandsApplied = tail;
+#endif
+}
+
+// Publishes the status of the tracks for the queries of the script side.
+// Called with _mutex held, after the tracks changed.
+void Imuse::publishStatus() {
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
+		Track *track = _track[l];
+		TrackStatus &s = status[l];
+		memcpy(s.soundName, track->soundName, sizeof(s.soundName));
+		s.used = track->used;
+		s.toBeRemoved = track->toBeRemoved;
+		s.playing = track->used && g_system->getMixer()->isSoundHandleActive(track->handle);
+		s.volGroupId = track->volGroupId;
+		s.vol = track->vol;
+		s.pan = track->pan;
+		s.pos = 0;
+		if (track->feedSize >= 12)
+			s.pos = (5 * (track->dataOffset + track->regionOffset)) / (track->feedSize / 12);
+	}
+
+	{
+		Common::StackLock lock(_statusMutex);
+		memcpy(_status, status, sizeof(_status));
+		_statusTail = _commandsApplied;
+	}
+
+#ifdef IMUSE_COMMAND_BARRIER
+	// Hand the slots back only once the status covers them
+	IMUSE_COMMAND_BARRIER();
+	_commandTail = _commandsApplied;
+#endif
+}
+
+// The status of the tracks as the script side sees them: the last
+// published one, with the commands posted since applied to it. Only
+// called on the engine thread, which is the only one to reuse the slots
+// of the ring, so they stay valid.
+void Imuse::getStatus(TrackStatus *status) {
+	uint32 tail;
+	{
+		Common::StackLock lock(_statusMutex);
+		memcpy(status, _status, sizeof(_status));
+		tail = _statusTail;
+	}
+
+	for (; tail != _commandHead; tail++)
+		applyToStatus(status, _commands[tail % IMUSE_COMMAND_QUEUE_SIZE]);
+}
+
 void Imuse::restoreState(SaveGame *savedState) {
 	Common::StackLock lock(_mutex);
+	processCommands();
 	debug("Imuse::restoreState() started.");
 
 	savedState->beginSection('IMUS');
@@ -153,12 +310,14 @@ void Imuse::restoreState(SaveGame *savedState) {
 	}
 	savedState->endSection();
 	g_system->getMixer()->pauseAll(false);
+	publishStatus();
 
 	debug("Imuse::restoreState() finished.");
 }
 
 void Imuse::saveState(SaveGame *savedState) {
 	Common::StackLock lock(_mutex);
+	processCommands();
 	debug("Imuse::saveState() started.");
 
 	savedState->beginSection('IMUS');
@@ -191,6 +350,7 @@ void Imuse::saveState(SaveGame *savedState) {
 		savedState->writeLESint32(track->mixerFlags);
 	}
 	savedState->endSection();
+	publishStatus();
 	debug("Imuse::saveState() finished.");
 }
 
@@ -209,6 +369,7 @@ int32 Imuse::makeMixerFlags(int32 flags) {
 
 void Imuse::callback() {
 	Common::StackLock lock(_mutex);
+	processCommands();
 
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		Track *track = _track[l];
@@ -222,7 +383,7 @@ void Imuse::callback() {
 			}
 
 			if (_pause)
-				return;
+				break;
 
 			if (track->volFadeUsed) {
 				if (track->volFadeStep < 0) {
@@ -297,7 +458,8 @@ void Imuse::callback() {
 				continue;
 
 			do {
-				result = _sound->getDataFromRegion(track->soundDesc, track->curRegion, &data, track->regionOffset, mixer_size);
+				data = getTrackBuffer(track, mixer_size);
+				result = _sound->getDataFromRegion(track->soundDesc, track->curRegion, data, track->regionOffset, mixer_size);
 				if (channels == 1) {
 					result &= ~1;
 				}
@@ -309,10 +471,10 @@ void Imuse::callback() {
 					result = mixer_size;
 
 				if (g_system->getMixer()->isReady()) {
-					track->stream->queueBuffer(data, result, DisposeAfterUse::YES, makeMixerFlags(track->mixerFlags));
+					queueTrackBuffer(track, data, result);
 					track->regionOffset += result;
 				} else
-					delete[] data;
+					freeTrackBuffer(track, data);
 
 				if (_sound->isEndOfRegion(track->soundDesc, track->curRegion)) {
 					switchToNextRegion(track);
@@ -328,6 +490,50 @@ void Imuse::callback() {
 			}
 		}
 	}
+
+	publishStatus();
+}
+
+// Returns a buffer for size bytes of the track's audio, to be passed to
+// queueTrackBuffer(). The next buffer of the track's ring was queued
+// kTrackBufferCount buffers ago, so the stream is done with it as long as
+// fewer buffers are queued. Otherwise, or while the ring still belongs to
+// a previous stream that is playing, a buffer the stream frees is used.
+byte *Imuse::getTrackBuffer(Track *track, int32 size) {
+	TrackBuffers &buffers = _trackBuffers[track->trackId];
+	if (buffers.stream != track->stream) {
+		if (buffers.stream && g_system->getMixer()->isSoundHandleActive(buffers.handle))
+			return (byte *)malloc(size);
+		buffers.stream = track->stream;
+		buffers.handle = track->handle;
+		buffers.next = 0;
+	}
+	if (track->stream->numQueuedStreams() >= kTrackBufferCount)
+		return (byte *)malloc(size);
+
+	int next = buffers.next;
+	if (size > buffers.size[next]) {
+		free(buffers.data[next]);
+		buffers.data[next] = (byte *)malloc(size);
+		buffers.size[next] = size;
+	}
+	return buffers.data[next];
+}
+
+void Imuse::queueTrackBuffer(Track *track, byte *data, int32 size) {
+	TrackBuffers &buffers = _trackBuffers[track->trackId];
+	if (data == buffers.data[buffers.next]) {
+		track->stream->queueBuffer(data, size, DisposeAfterUse::NO, makeMixerFlags(track->mixerFlags));
+		buffers.next = (buffers.next + 1) % kTrackBufferCount;
+	} else {
+		track->stream->queueBuffer(data, size, DisposeAfterUse::YES, makeMixerFlags(track->mixerFlags));
+	}
+}
+
+// Drops a buffer from getTrackBuffer() that was not queued
+void Imuse::freeTrackBuffer(Track *track, byte *data) {
+	if (data != _trackBuffers[track->trackId].data[_trackBuffers[track->trackId].next])
+		free(data);
 }
 
 void Imuse::switchToNextRegion(Track *track) {
@@ -24,6 +24,7 @@
 #define GRIM_IMUSE_H
 
 #include "common/mutex.h"
+#include "common/thread.h"
 
 #include "engines/grim/imuse/imuse_track.h"
 
@@ -31,20 +32,101 @@ namespace Grim {
 
 #define MAX_IMUSE_TRACKS 16
 #define MAX_IMUSE_FADETRACKS 16
+#define IMUSE_COMMAND_QUEUE_SIZE 64
 
 struct ImuseTable;
 class SaveGame;
 
 class Imuse {
 private:
+	enum CommandType {
+		kCommandSetPriority,
+		kCommandSetVolume,
+		kCommandSetPan,
+		kCommandSetHookId,
+		kCommandSelectVolumeGroup,
+		kCommandSetFadeVolume,
+		kCommandSetFadePan,
+		kCommandStopSound,
+		kCommandStartSound,
+		kCommandFadeOutMusic,
+		kCommandFadeOutMusicAndStartNew,
+		kCommandFlushTracks,
+		kCommandStopAllSounds
+	};
+
+	struct Command {
+		int32 type;
+		char soundName[32];
+		int32 param1;
+		int32 param2;
+		int32 param3;
+		int32 param4;
+		int32 param5;
+	};
+
+	// What the script side can ask about a track, see getStatus()
+	struct TrackStatus {
+		char soundName[32];
+		bool used;
+		bool toBeRemoved;
+		bool playing;		// the mixer handle is active
+		int32 volGroupId;
+		int32 vol;
+		int32 pan;
+		int32 pos;			// in 60 Hz ticks
+	};
+
+	// Buffers the callback queues to a track's stream without handing them
+	// over, one ring for each track slot. A ring stays with the last stream
+	// it fed until the mixer is done with that stream.
+	enum { kTrackBufferCount = 8 };
+	struct TrackBuffers {
+		Audio::QueuingAudioStream *stream;
+		Audio::SoundHandle handle;
+		byte *data[kTrackBufferCount];
+		int32 size[kTrackBufferCount];
+		int next;
+	};
 
 	int _callbackFps;
 
 	Track *_track[MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS];
+	TrackBuffers _trackBuffers[MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS];
 
+	// Held by whoever changes the tracks, which is the callback for a whole
+	// tick. The script side posts every change through the ring below and
+	// answers its queries from _status, so it only takes _mutex in
+	// saveState() and restoreState(), and in sendCommand() when the ring is
+	// full or there is no barrier for it.
 	Common::Mutex _mutex;
 	ImuseSndMgr *_sound;
 
+	// Decodes the MCMP sounds ahead of their play position, into the
+	// decoded block cache of each sound, so that the callback mostly
+	// copies. Woken after every callback.
+	Common::Semaphore _decodeAheadSignal;
+	Common::Thread _decodeAheadWorker;
+	volatile bool _decodeAheadQuit;
+
+	// Commands posted by the script side and applied by whoever holds _mutex
+	// next, usually the callback. Only the engine thread posts, and the
+	// consumers are serialized by _mutex, so this is a single producer,
+	// single consumer ring that posting never has to lock. A slot is only
+	// handed back once the status of the tracks after it is published, as
+	// getStatus() reads the commands not covered by the status yet.
+	Command _commands[IMUSE_COMMAND_QUEUE_SIZE];
+	volatile uint32 _commandHead;
+	volatile uint32 _commandTail;
+	uint32 _commandsApplied;
+
+	// The tracks as of the last publishStatus(), and the ring position they
+	// include. _statusMutex is only held to copy them.
+	TrackStatus _status[MAX_IMUSE_TRACKS];
+	uint32 _statusTail;
+	Common::Mutex _statusMutex;
+	char _curMusicSoundName[32];
+
 	bool _pause;
 	bool _demo;
 
@@ -58,34 +140,54 @@ private:
 	int32 makeMixerFlags(int32 flags);
 	static void timerHandler(void *refConf);
 	void callback();
+	static int decodeAheadThread(void *refCon);
+	byte *getTrackBuffer(Track *track, int32 size);
+	void queueTrackBuffer(Track *track, byte *data, int32 size);
+	void freeTrackBuffer(Track *track, byte *data);
 	void switchToNextRegion(Track *track);
 	int allocSlot(int priority);
 	void selectVolumeGroup(const char *soundName, int volGroupId);
 
+	bool startTrack(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority, Track *otherTrack);
 	void fadeOutMusic(int fadeDelay);
 	void fadeOutMusicAndStartNew(int fadeDelay, const char *filename, int hookId, int vol, int pan);
+	void fadeOutMusicTrack(int fadeDelay);
+	void fadeOutMusicTrackAndStartNew(int fadeDelay, const char *filename, int hookId, int vol, int pan);
+	void flushRemovedTracks();
+	void stopAllTracks();
 	Track *cloneToFadeOutTrack(Track *track, int fadeDelay);
 	Track *moveToFadeOutTrack(Track *track, int fadeDelay);
 
 	void playMusic(const ImuseTable *table, int atribPos, bool sequence);
 
 	void flushTrack(Track *track);
+	Track *findTrack(const char *soundName);
+
+	bool postCommand(const Command &cmd);
+	void sendCommand(int type, const char *soundName, int param1 = 0, int param2 = 0,
+					 int param3 = 0, int param4 = 0, int param5 = 0);
+	void processCommands();
+	void executeCommand(const Command &cmd);
+	void publishStatus();
+	void getStatus(TrackStatus *status);
+	static TrackStatus *findStatus(TrackStatus *status, const char *soundName);
+	static TrackStatus *findMusicStatus(TrackStatus *status);
+	static void startStatus(TrackStatus *status, const char *soundName, int volGroupId, int volume, int pan);
+	static void applyToStatus(TrackStatus *status, const Command &cmd);
 
 public:
 	Imuse(int fps, bool demo);
 	~Imuse();
 
-	bool startSound(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority, Track *otherTrack);
+	bool startSound(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority);
 	bool startVoice(const char *soundName, int volume = 127, int pan = 64);
 	void startMusic(const char *soundName, int hookId, int volume, int pan);
-	void startMusicWithOtherPos(const char *soundName, int hookId, int volume, int pan, Track *otherTrack);
 	void startSfx(const char *soundName, int priority = 127);
 
 	void restoreState(SaveGame *savedState);
 	void saveState(SaveGame *savedState);
 	void resetState();
 
-	Track *findTrack(const char *soundName);
 	void setPriority(const char *soundName, int priority);
 	void setVolume(const char *soundName, int volume);
 	int getVolume(const char *soundName);
@@ -36,10 +36,15 @@ McmpMgr::McmpMgr() {
 	_numCompItems = 0;
 	_curSample = -1;
 	_compInput = NULL;
-	_outputSize = 0;
 	_file = NULL;
 	_numCompItems = 0;
-	_lastBlock = -1;
+	_useCount = 0;
+	_nextBlock = 0;
+	for (int i = 0; i < MCMP_CACHED_BLOCKS; i++) {
+		_blocks[i].block = -1;
+		_blocks[i].lastUse = 0;
+		_blocks[i].filling = false;
+	}
 }
 
 McmpMgr::~McmpMgr() {
@@ -96,7 +101,58 @@ bool McmpMgr::openSound(const char *filename, byte **resPtr, int &offsetData) {
 	return true;
 }
 
-int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
+// The slot holding the decoded block, or NULL. Called with _mutex held.
+McmpMgr::DecodedBlock *McmpMgr::findBlock(int32 block) {
+	for (int i = 0; i < MCMP_CACHED_BLOCKS; i++) {
+		if (_blocks[i].block == block && !_blocks[i].filling)
+			return &_blocks[i];
+	}
+	return NULL;
+}
+
+// The least recently used slot that is not being filled. Only one slot
+// is filled at a time, so there always is one. Called with _mutex held.
+McmpMgr::DecodedBlock *McmpMgr::freeSlot() {
+	DecodedBlock *slot = NULL;
+	for (int i = 0; i < MCMP_CACHED_BLOCKS; i++) {
+		if (!_blocks[i].filling && (!slot || _blocks[i].lastUse < slot->lastUse))
+			slot = &_blocks[i];
+	}
+	assert(slot);
+	return slot;
+}
+
+// Reads and decodes the block into the slot. Called with _fileMutex held.
+void McmpMgr::decodeBlock(int32 block, DecodedBlock *slot) {
+	// hack: two more zero bytes at the end of input buffer
+	_compInput[_compTable[block].compSize] = 0;
+	_compInput[_compTable[block].compSize + 1] = 0;
+	_file->seek(_compTable[block].offset, SEEK_SET);
+	_file->read(_compInput, _compTable[block].compSize);
+	if (_compTable[block].decompSize > 0x2000) {
+		error("McmpMgr::decodeBlock() decompSize: %d", _compTable[block].decompSize);
+	}
+	decompressVima(_compInput, (int16 *)slot->data, _compTable[block].decompSize, imuseDestTable);
+	slot->size = _compTable[block].decompSize;
+}
+
+// Returns the decoded block, from the cache if possible. Otherwise the
+// block is decoded here into the least recently used slot; if the decode
+// ahead thread is on the same block it just gets decoded twice. Called
+// with _mutex held.
+const McmpMgr::DecodedBlock *McmpMgr::getBlock(int32 block) {
+	DecodedBlock *slot = findBlock(block);
+	if (!slot) {
+		slot = freeSlot();
+		Common::StackLock lock(_fileMutex);
+		decodeBlock(block, slot);
+		slot->block = block;
+	}
+	slot->lastUse = ++_useCount;
+	return slot;
+}
+
+int32 McmpMgr::decompressSample(int32 offset, int32 size, byte *dest) {
 	int32 i, final_size, output_size;
 	int skip, first_block, last_block;
 
@@ -105,6 +161,8 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 		return 0;
 	}
 
+	Common::StackLock lock(_mutex);
+
 	first_block = offset / 0x2000;
 	last_block = (offset + size - 1) / 0x2000;
 	skip = offset % 0x2000;
@@ -113,26 +171,12 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 	if ((last_block >= _numCompItems) && (_numCompItems > 0))
 		last_block = _numCompItems - 1;
 
-	int32 blocks_final_size = 0x2000 * (1 + last_block - first_block);
-	*comp_final = (byte *)malloc(blocks_final_size * sizeof(byte));
 	final_size = 0;
 
 	for (i = first_block; i <= last_block; i++) {
-		if (_lastBlock != i) {
-			// hack: two more zero bytes at the end of input buffer
-			_compInput[_compTable[i].compSize] = 0;
-			_compInput[_compTable[i].compSize + 1] = 0;
-			_file->seek(_compTable[i].offset, SEEK_SET);
-			_file->read(_compInput, _compTable[i].compSize);
-			decompressVima(_compInput, (int16 *)_compOutput, _compTable[i].decompSize, imuseDestTable);
-			_outputSize = _compTable[i].decompSize;
-			if (_outputSize > 0x2000) {
-				error("McmpMgr::decompressSample() _outputSize: %d", _outputSize);
-			}
-			_lastBlock = i;
-		}
+		const DecodedBlock *decoded = getBlock(i);
 
-		output_size = _outputSize - skip;
+		output_size = decoded->size - skip;
 
 		if ((output_size + skip) > 0x2000) // workaround
 			output_size -= (output_size + skip) - 0x2000;
@@ -140,9 +184,7 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 		if (output_size > size)
 			output_size = size;
 
-		assert(final_size + output_size <= blocks_final_size);
-
-		memcpy(*comp_final + final_size, _compOutput + skip, output_size);
+		memcpy(dest + final_size, decoded->data + skip, output_size);
 		final_size += output_size;
 
 		size -= output_size;
@@ -152,8 +194,44 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 
 		skip = 0;
 	}
+	_nextBlock = last_block + 1;
 
 	return final_size;
 }
 
+// Decodes one of the MCMP_DECODE_AHEAD blocks following the last one
+// read, so that it is cached by the time the sound gets there. The slot
+// is reserved under _mutex but filled without it, so decompressSample()
+// can go on copying meanwhile. Returns false if there was nothing to do.
+bool McmpMgr::decodeAhead() {
+	DecodedBlock *slot = NULL;
+	int32 block;
+	{
+		Common::StackLock lock(_mutex);
+		if (!_file)
+			return false;
+		for (block = _nextBlock; block < _nextBlock + MCMP_DECODE_AHEAD && block < _numCompItems; block++) {
+			if (!findBlock(block)) {
+				slot = freeSlot();
+				break;
+			}
+		}
+		if (!slot)
+			return false;
+		slot->block = -1;
+		slot->filling = true;
+	}
+
+	{
+		Common::StackLock lock(_fileMutex);
+		decodeBlock(block, slot);
+	}
+
+	Common::StackLock lock(_mutex);
+	slot->block = block;
+	slot->filling = false;
+	slot->lastUse = ++_useCount;
+	return true;
+}
+
 } // end of namespace Grim
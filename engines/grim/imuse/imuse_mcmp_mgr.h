@@ -23,8 +23,13 @@
 #ifndef GRIM_MCMP_MGR_H
 #define GRIM_MCMP_MGR_H
 
+#include "common/mutex.h"
+
 namespace Grim {
 
+#define MCMP_CACHED_BLOCKS 4
+#define MCMP_DECODE_AHEAD 2
+
 class McmpMgr {
 private:
 
@@ -35,14 +40,34 @@ private:
 		int32 offset;
 	};
 
+	struct DecodedBlock {
+		int32 block;	// -1 if the slot is free
+		int32 size;
+		uint32 lastUse;
+		bool filling;	// being decoded by decodeAhead(), not to be used or reused
+		byte data[0x2000];
+	};
+
 	CompTable *_compTable;
 	int16 _numCompItems;
 	int _curSample;
 	Common::File *_file;
-	byte _compOutput[0x2000];
 	byte *_compInput;
-	int _outputSize;
-	int _lastBlock;
+	DecodedBlock _blocks[MCMP_CACHED_BLOCKS];
+	uint32 _useCount;
+	int32 _nextBlock;
+	// The iMuse callback reads samples while the decode ahead thread fills
+	// the cache. _mutex guards the slots and is only held to look them up
+	// and copy from them. _fileMutex guards the file and _compInput and is
+	// held while a block is read and decoded, so the callback only waits
+	// for a decode when the block it needs was not decoded ahead.
+	Common::Mutex _mutex;
+	Common::Mutex _fileMutex;
+
+	DecodedBlock *findBlock(int32 block);
+	DecodedBlock *freeSlot();
+	void decodeBlock(int32 block, DecodedBlock *slot);
+	const DecodedBlock *getBlock(int32 block);
 
 public:
 
@@ -50,7 +75,8 @@ public:
 	~McmpMgr();
 
 	bool openSound(const char *filename, byte **resPtr, int &offsetData);
-	int32 decompressSample(int32 offset, int32 size, byte **comp_final);
+	int32 decompressSample(int32 offset, int32 size, byte *dest);
+	bool decodeAhead();
 };
 
 } // end of namespace Grim
@@ -50,7 +50,11 @@ void Imuse::flushTrack(Track *track) {
 }
 
 void Imuse::flushTracks() {
-	Common::StackLock lock(_mutex);
+	sendCommand(kCommandFlushTracks, "");
+}
+
+void Imuse::flushRemovedTracks() {
+	// Called with _mutex held
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		Track *track = _track[l];
 		if (track->used && track->toBeRemoved && !g_system->getMixer()->isSoundHandleActive(track->handle)) {
@@ -60,17 +64,10 @@ void Imuse::flushTracks() {
 }
 
 void Imuse::refreshScripts() {
-	Common::StackLock lock(_mutex);
-	bool found = false;
-
-	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
-		Track *track = _track[l];
-		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
-			found = true;
-		}
-	}
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
 
-	if (!found && _curMusicState) {
+	if (!findMusicStatus(status) && _curMusicState) {
 		setMusicSequence(0);
 	}
 }
@@ -78,32 +75,26 @@ void Imuse::refreshScripts() {
 bool Imuse::startVoice(const char *soundName, int volume, int pan) {
 	if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_ALL)
 		debug("Imuse::startVoice(): SoundName %s, vol:%d, pan:%d", soundName, volume, pan);
-	return startSound(soundName, IMUSE_VOLGRP_VOICE, 0, volume, pan, 127, NULL);
+	return startSound(soundName, IMUSE_VOLGRP_VOICE, 0, volume, pan, 127);
 }
 
 void Imuse::startMusic(const char *soundName, int hookId, int volume, int pan) {
 	if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_ALL)
 		debug("Imuse::startMusic(): SoundName %s, hookId:%d, vol:%d, pan:%d", soundName, hookId, volume, pan);
-	startSound(soundName, IMUSE_VOLGRP_MUSIC, hookId, volume, pan, 126, NULL);
-}
-
-void Imuse::startMusicWithOtherPos(const char *soundName, int hookId, int volume, int pan, Track *otherTrack) {
-	if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_ALL)
-		debug("Imuse::startMusicWithOtherPos(): SoundName %s, hookId:%d, vol:%d, pan:%d", soundName, hookId, volume, pan);
-	startSound(soundName, IMUSE_VOLGRP_MUSIC, hookId, volume, pan, 126, otherTrack);
+	startSound(soundName, IMUSE_VOLGRP_MUSIC, hookId, volume, pan, 126);
 }
 
 void Imuse::startSfx(const char *soundName, int priority) {
 	if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_ALL)
 		debug("Imuse::startSfx(): SoundName %s, priority:%d", soundName, priority);
-	startSound(soundName, IMUSE_VOLGRP_SFX, 0, 127, 0, priority, NULL);
+	startSound(soundName, IMUSE_VOLGRP_SFX, 0, 127, 0, priority);
 }
 
 int32 Imuse::getPosIn60HzTicks(const char *soundName) {
-	Common::StackLock lock(_mutex);
-	Track *getTrack = NULL;
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
 
-	getTrack = findTrack(soundName);
+	TrackStatus *getTrack = findStatus(status, soundName);
 	// Warn the user if the track was not found
 	if (getTrack == NULL) {
 		if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_WARN || gDebugLevel == DEBUG_ALL)
@@ -111,16 +102,17 @@ int32 Imuse::getPosIn60HzTicks(const char *soundName) {
 		return false;
 	}
 
-	int32 pos = (5 * (getTrack->dataOffset + getTrack->regionOffset)) / (getTrack->feedSize / 12);
-	return pos;
+	return getTrack->pos;
 }
 
 bool Imuse::isVoicePlaying() {
-	Common::StackLock lock(_mutex);
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
+
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
-		Track *track = _track[l];
+		TrackStatus *track = &status[l];
 		if (track->used && track->volGroupId == IMUSE_VOLGRP_VOICE) {
-			if (g_system->getMixer()->isSoundHandleActive(track->handle))
+			if (track->playing)
 				return true;
 		}
 	}
@@ -129,16 +121,16 @@ bool Imuse::isVoicePlaying() {
 }
 
 bool Imuse::getSoundStatus(const char *soundName) {
-	Common::StackLock lock(_mutex);
-	Track *track = NULL;
-
 	// If there's no name then don't try to get the status!
 	if (strlen(soundName) == 0)
 		return false;
 
-	track = findTrack(soundName);
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
+
+	TrackStatus *track = findStatus(status, soundName);
 	// Warn the user if the track was not found
-	if (track == NULL || !g_system->getMixer()->isSoundHandleActive(track->handle)) {
+	if (track == NULL || !track->playing) {
 		// This debug warning should be "light" since this function gets called
 		// on occassion to see if a sound has stopped yet
 		if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_NORMAL || gDebugLevel == DEBUG_ALL)
@@ -149,26 +141,19 @@ bool Imuse::getSoundStatus(const char *soundName) {
 }
 
 void Imuse::stopSound(const char *soundName) {
-	Common::StackLock lock(_mutex);
 	if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_ALL)
 		debug("Imuse::stopSound(): SoundName %s", soundName);
-	Track *removeTrack = NULL;
-
-	removeTrack = findTrack(soundName);
-	// Warn the user if the track was not found
-	if (removeTrack == NULL) {
-		if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_WARN || gDebugLevel == DEBUG_ALL)
-			warning("Sound track '%s' could not be found to stop", soundName);
-		return;
-	}
-	flushTrack(removeTrack);
+	sendCommand(kCommandStopSound, soundName);
 }
 
 void Imuse::stopAllSounds() {
-	Common::StackLock lock(_mutex);
 	if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_ALL)
 		debug("Imuse::stopAllSounds()");
+	sendCommand(kCommandStopAllSounds, "");
+}
 
+void Imuse::stopAllTracks() {
+	// Called with _mutex held
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		Track *track = _track[l];
 		if (track->used) {
@@ -33,6 +33,9 @@ namespace Grim {
 
 ImuseSndMgr::ImuseSndMgr(bool demo) {
 	_demo = demo;
+	_decodeAheadSound = 0;
+	_decodingMgr = NULL;
+	_closedMgr = NULL;
 	for (int l = 0; l < MAX_IMUSE_SOUNDS; l++) {
 		memset(&_sounds[l], 0, sizeof(SoundDesc));
 	}
@@ -186,13 +189,17 @@ ImuseSndMgr::SoundDesc *ImuseSndMgr::openSound(const char *soundName, int volGro
 		}
 	} else if (scumm_stricmp(extension, "wav") == 0 || scumm_stricmp(extension, "imc") == 0 ||
 			(_demo && scumm_stricmp(extension, "imu") == 0)) {
-		sound->mcmpMgr = new McmpMgr();
-		if (!sound->mcmpMgr->openSound(soundName, &ptr, headerSize)) {
+		McmpMgr *mcmpMgr = new McmpMgr();
+		if (!mcmpMgr->openSound(soundName, &ptr, headerSize)) {
+			delete mcmpMgr;
 			closeSound(sound);
 			return NULL;
 		}
 		parseSoundHeader(ptr, sound, headerSize);
 		sound->mcmpData = true;
+		// Only hand it to decodeAhead() once it is ready
+		Common::StackLock lock(_mutex);
+		sound->mcmpMgr = mcmpMgr;
 	} else {
 		error("ImuseSndMgr::openSound() Unrecognized extension for sound file %s", soundName);
 	}
@@ -203,8 +210,13 @@ ImuseSndMgr::SoundDesc *ImuseSndMgr::openSound(const char *soundName, int volGro
 void ImuseSndMgr::closeSound(SoundDesc *sound) {
 	assert(checkForProperHandle(sound));
 
+	Common::StackLock lock(_mutex);
+
 	if (sound->mcmpMgr) {
-		delete sound->mcmpMgr;
+		if (sound->mcmpMgr == _decodingMgr)
+			_closedMgr = sound->mcmpMgr;
+		else
+			delete sound->mcmpMgr;
 		sound->mcmpMgr = NULL;
 	}
 
@@ -326,7 +338,9 @@ int ImuseSndMgr::getJumpFade(SoundDesc *sound, int number) {
 	return sound->jump[number].fadeDelay;
 }
 
-int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size) {
+// Copies or decodes up to size bytes of the region into buf, which has to
+// hold at least size bytes. Returns how many bytes were written.
+int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte *buf, int32 offset, int32 size) {
 	assert(checkForProperHandle(sound));
 	assert(buf && offset >= 0 && size >= 0);
 	assert(region >= 0 && region < sound->numRegions);
@@ -344,11 +358,44 @@ int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte **buf, i
 	if (sound->mcmpData) {
 		size = sound->mcmpMgr->decompressSample(region_offset + offset, size, buf);
 	} else {
-		*buf = (byte *)malloc(sizeof(byte) * size);
-		memcpy(*buf, sound->resPtr + region_offset + offset, size);
+		memcpy(buf, sound->resPtr + region_offset + offset, size);
 	}
 
 	return size;
 }
 
+// Decodes the next block of one of the open MCMP sounds, going round them,
+// so that the iMuse callback mostly copies already decoded data. Runs on
+// the decode ahead thread without the iMuse lock, and without _mutex while
+// decoding. Returns false if every sound was already decoded ahead.
+bool ImuseSndMgr::decodeAhead() {
+	for (int i = 0; i < MAX_IMUSE_SOUNDS; i++) {
+		McmpMgr *mgr;
+		int l = (_decodeAheadSound + i) % MAX_IMUSE_SOUNDS;
+		{
+			Common::StackLock lock(_mutex);
+			mgr = _sounds[l].mcmpMgr;
+			if (!mgr)
+				continue;
+			_decodingMgr = mgr;
+		}
+
+		bool decoded = mgr->decodeAhead();
+
+		Common::StackLock lock(_mutex);
+		_decodingMgr = NULL;
+		if (_closedMgr) {
+			// The sound was closed meanwhile
+			delete _closedMgr;
+			_closedMgr = NULL;
+			decoded = false;
+		}
+		if (decoded) {
+			_decodeAheadSound = l + 1;
+			return true;
+		}
+	}
+	return false;
+}
+
 } // end of namespace Grim
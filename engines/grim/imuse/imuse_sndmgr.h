@@ -23,6 +23,8 @@
 #ifndef GRIM_IMUSE_SNDMGR_H
 #define GRIM_IMUSE_SNDMGR_H
 
+#include "common/mutex.h"
+
 #include "audio/mixer.h"
 #include "audio/audiostream.h"
 
@@ -84,6 +86,13 @@ private:
 
 	SoundDesc _sounds[MAX_IMUSE_SOUNDS];
 	bool _demo;
+	int _decodeAheadSound;
+	// Guards the McmpMgr of each sound while decodeAhead() picks one from
+	// the decode ahead thread. The McmpMgr being decoded is not deleted by
+	// closeSound() but left to decodeAhead(), so neither waits for the other.
+	Common::Mutex _mutex;
+	McmpMgr *_decodingMgr;
+	McmpMgr *_closedMgr;
 
 	bool checkForProperHandle(SoundDesc *soundDesc);
 	SoundDesc *allocSlot();
@@ -112,7 +121,8 @@ public:
 	int getJumpHookId(SoundDesc *sound, int number);
 	int getJumpFade(SoundDesc *sound, int number);
 
-	int32 getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size);
+	int32 getDataFromRegion(SoundDesc *sound, int region, byte *buf, int32 offset, int32 size);
+	bool decodeAhead();
 };
 
 } // end of namespace Grim
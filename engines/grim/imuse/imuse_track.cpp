@@ -25,6 +25,7 @@
 #include "common/textconsole.h"
 
 #include "engines/grim/debug.h"
+#include "engines/grim/resource.h"
 
 #include "engines/grim/imuse/imuse.h"
 
@@ -34,7 +35,7 @@ int Imuse::allocSlot(int priority) {
 	int l, lowest_priority = 127;
 	int trackId = -1;
 
-	// allocSlot called by startSound so no locking is necessary
+	// allocSlot called by startTrack so no locking is necessary
 	for (l = 0; l < MAX_IMUSE_TRACKS; l++) {
 		if (!_track[l]->used) {
 			trackId = l;
@@ -72,8 +73,19 @@ int Imuse::allocSlot(int priority) {
 	return trackId;
 }
 
-bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority, Track *otherTrack) {
-	Common::StackLock lock(_mutex);
+// The sound is opened and started by the callback. Only a missing file
+// can be told right away.
+bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority) {
+	if (!g_resourceloader->getFileExists(soundName)) {
+		warning("Imuse::startSound() Can't find sound '%s'", soundName);
+		return false;
+	}
+	sendCommand(kCommandStartSound, soundName, volGroupId, hookId, volume, pan, priority);
+	return true;
+}
+
+bool Imuse::startTrack(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority, Track *otherTrack) {
+	// Called with _mutex held
 	Track *track = NULL;
 	int i;
 
@@ -84,7 +96,7 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 		// Filenames are case insensitive, see findTrack
 		if (!scumm_stricmp(_track[i]->soundName, soundName)) {
 			if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_NORMAL || gDebugLevel == DEBUG_ALL)
-				printf("Imuse::startSound(): Track '%s' already playing.\n", soundName);
+				printf("Imuse::startTrack(): Track '%s' already playing.\n", soundName);
 			return true;
 		}
 	}
@@ -97,7 +109,7 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 
 	int l = allocSlot(priority);
 	if (l == -1) {
-		warning("Imuse::startSound() Can't start sound - no free slots");
+		warning("Imuse::startTrack() Can't start sound - no free slots");
 		return false;
 	}
 
@@ -165,48 +177,23 @@ Track *Imuse::findTrack(const char *soundName) {
 }
 
 void Imuse::setPriority(const char *soundName, int priority) {
-	Common::StackLock lock(_mutex);
-	Track *changeTrack = NULL;
 	assert ((priority >= 0) && (priority <= 127));
-
-	changeTrack = findTrack(soundName);
-	// Check to make sure we found the track
-	if (changeTrack == NULL) {
-		warning("Unable to find track '%s' to change priority", soundName);
-		return;
-	}
-	changeTrack->priority = priority;
+	sendCommand(kCommandSetPriority, soundName, priority);
 }
 
 void Imuse::setVolume(const char *soundName, int volume) {
-	Common::StackLock lock(_mutex);
-	Track *changeTrack;
-
-	changeTrack = findTrack(soundName);
-	if (changeTrack == NULL) {
-		warning("Unable to find track '%s' to change volume", soundName);
-		return;
-	}
-	changeTrack->vol = volume * 1000;
+	sendCommand(kCommandSetVolume, soundName, volume);
 }
 
 void Imuse::setPan(const char *soundName, int pan) {
-	Common::StackLock lock(_mutex);
-	Track *changeTrack;
-
-	changeTrack = findTrack(soundName);
-	if (changeTrack == NULL) {
-		warning("Unable to find track '%s' to change pan", soundName);
-		return;
-	}
-	changeTrack->pan = pan * 1000;
+	sendCommand(kCommandSetPan, soundName, pan);
 }
 
 int Imuse::getVolume(const char *soundName) {
-	Common::StackLock lock(_mutex);
-	Track *getTrack;
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
 
-	getTrack = findTrack(soundName);
+	TrackStatus *getTrack = findStatus(status, soundName);
 	if (getTrack == NULL) {
 		warning("Unable to find track '%s' to get volume", soundName);
 		return 0;
@@ -215,23 +202,16 @@ int Imuse::getVolume(const char *soundName) {
 }
 
 void Imuse::setHookId(const char *soundName, int hookId) {
-	Common::StackLock lock(_mutex);
-	Track *changeTrack;
-
-	changeTrack = findTrack(soundName);
-	if (changeTrack == NULL) {
-		warning("Unable to find track '%s' to change hook id", soundName);
-		return;
-	}
-	changeTrack->curHookId = hookId;
+	sendCommand(kCommandSetHookId, soundName, hookId);
 }
 
 int Imuse::getCountPlayedTracks(const char *soundName) {
-	Common::StackLock lock(_mutex);
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
 	int count = 0;
 
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
-		Track *track = _track[l];
+		TrackStatus *track = &status[l];
 		if (track->used && !track->toBeRemoved && (scumm_stricmp(track->soundName, soundName) == 0)) {
 			count++;
 		}
@@ -241,86 +221,237 @@ int Imuse::getCountPlayedTracks(const char *soundName) {
 }
 
 void Imuse::selectVolumeGroup(const char *soundName, int volGroupId) {
-	Common::StackLock lock(_mutex);
-	Track *changeTrack;
 	assert((volGroupId >= 1) && (volGroupId <= 4));
 
 	if (volGroupId == 4)
 		volGroupId = 3;
 
-	changeTrack = findTrack(soundName);
-	if (changeTrack == NULL) {
-		warning("Unable to find track '%s' to change volume group id", soundName);
-		return;
-	}
-	changeTrack->volGroupId = volGroupId;
+	sendCommand(kCommandSelectVolumeGroup, soundName, volGroupId);
 }
 
 void Imuse::setFadeVolume(const char *soundName, int destVolume, int duration) {
-	Common::StackLock lock(_mutex);
-	Track *changeTrack;
-
-	changeTrack = findTrack(soundName);
-	if (changeTrack == NULL) {
-		warning("Unable to find track '%s' to change fade volume", soundName);
-		return;
-	}
-	changeTrack->volFadeDelay = duration;
-	changeTrack->volFadeDest = destVolume * 1000;
-	changeTrack->volFadeStep = (changeTrack->volFadeDest - changeTrack->vol) * 60 * (1000 / _callbackFps) / (1000 * duration);
-	changeTrack->volFadeUsed = true;
+	sendCommand(kCommandSetFadeVolume, soundName, destVolume, duration);
 }
 
 void Imuse::setFadePan(const char *soundName, int destPan, int duration) {
-	Common::StackLock lock(_mutex);
-	Track *changeTrack;
+	sendCommand(kCommandSetFadePan, soundName, destPan, duration);
+}
 
-	changeTrack = findTrack(soundName);
-	if (changeTrack == NULL) {
-		warning("Unable to find track '%s' to change fade pan", soundName);
-		return;
+void Imuse::executeCommand(const Command &cmd) {
+	// Called with _mutex held
+	Track *changeTrack = findTrack(cmd.soundName);
+
+	switch (cmd.type) {
+	case kCommandSetPriority:
+		// Check to make sure we found the track
+		if (changeTrack == NULL) {
+			warning("Unable to find track '%s' to change priority", cmd.soundName);
+			return;
+		}
+		changeTrack->priority = cmd.param1;
+		break;
+	case kCommandSetVolume:
+		if (changeTrack == NULL) {
+			warning("Unable to find track '%s' to change volume", cmd.soundName);
+			return;
+		}
+		changeTrack->vol = cmd.param1 * 1000;
+		break;
+	case kCommandSetPan:
+		if (changeTrack == NULL) {
+			warning("Unable to find track '%s' to change pan", cmd.soundName);
+			return;
+		}
+		changeTrack->pan = cmd.param1 * 1000;
+		break;
+	case kCommandSetHookId:
+		if (changeTrack == NULL) {
+			warning("Unable to find track '%s' to change hook id", cmd.soundName);
+			return;
+		}
+		changeTrack->curHookId = cmd.param1;
+		break;
+	case kCommandSelectVolumeGroup:
+		if (changeTrack == NULL) {
+			warning("Unable to find track '%s' to change volume group id", cmd.soundName);
+			return;
+		}
+		changeTrack->volGroupId = cmd.param1;
+		break;
+	case kCommandSetFadeVolume:
+		if (changeTrack == NULL) {
+			warning("Unable to find track '%s' to change fade volume", cmd.soundName);
+			return;
+		}
+		changeTrack->volFadeDelay = cmd.param2;
+		changeTrack->volFadeDest = cmd.param1 * 1000;
+		changeTrack->volFadeStep = (changeTrack->volFadeDest - changeTrack->vol) * 60 * (1000 / _callbackFps) / (1000 * cmd.param2);
+		changeTrack->volFadeUsed = true;
+		break;
+	case kCommandSetFadePan:
+		if (changeTrack == NULL) {
+			warning("Unable to find track '%s' to change fade pan", cmd.soundName);
+			return;
+		}
+		changeTrack->panFadeDelay = cmd.param2;
+		changeTrack->panFadeDest = cmd.param1 * 1000;
+		changeTrack->panFadeStep = (changeTrack->panFadeDest - changeTrack->pan) * 60 * (1000 / _callbackFps) / (1000 * cmd.param2);
+		changeTrack->panFadeUsed = true;
+		break;
+	case kCommandStopSound:
+		// Warn the user if the track was not found
+		if (changeTrack == NULL) {
+			if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_WARN || gDebugLevel == DEBUG_ALL)
+				warning("Sound track '%s' could not be found to stop", cmd.soundName);
+			return;
+		}
+		flushTrack(changeTrack);
+		break;
+	case kCommandStartSound:
+		startTrack(cmd.soundName, cmd.param1, cmd.param2, cmd.param3, cmd.param4, cmd.param5, NULL);
+		break;
+	case kCommandFadeOutMusic:
+		fadeOutMusicTrack(cmd.param1);
+		break;
+	case kCommandFadeOutMusicAndStartNew:
+		fadeOutMusicTrackAndStartNew(cmd.param1, cmd.soundName, cmd.param2, cmd.param3, cmd.param4);
+		break;
+	case kCommandFlushTracks:
+		flushRemovedTracks();
+		break;
+	case kCommandStopAllSounds:
+		stopAllTracks();
+		break;
+	default:
+		error("Imuse::executeCommand(): Unknown command %d", cmd.type);
 	}
-	changeTrack->panFadeDelay = duration;
-	changeTrack->panFadeDest = destPan * 1000;
-	changeTrack->panFadeStep = (changeTrack->panFadeDest - changeTrack->pan) * 60 * (1000 / _callbackFps) / (1000 * duration);
-	changeTrack->panFadeUsed = true;
 }
 
-char *Imuse::getCurMusicSoundName() {
-	Common::StackLock lock(_mutex);
+Imuse::TrackStatus *Imuse::findStatus(TrackStatus *status, const char *soundName) {
+	// Matches like findTrack()
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
-		Track *track = _track[l];
-		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
-			return track->soundName;
+		TrackStatus *track = &status[l];
+		if (track->used && !track->toBeRemoved
+				&& strlen(track->soundName) != 0 && scumm_stricmp(track->soundName, soundName) == 0) {
+			return track;
 		}
 	}
 	return NULL;
 }
 
-int Imuse::getCurMusicPan() {
-	Common::StackLock lock(_mutex);
+Imuse::TrackStatus *Imuse::findMusicStatus(TrackStatus *status) {
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
-		Track *track = _track[l];
+		TrackStatus *track = &status[l];
 		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
-			return track->pan / 1000;
+			return track;
 		}
 	}
-	return 0;
+	return NULL;
 }
 
-int Imuse::getCurMusicVol() {
-	Common::StackLock lock(_mutex);
+// A track as startTrack() would start it, unless the sound is already
+// there. When no slot is free the callback may replace a track of lower
+// priority, which is left for the next published status to tell.
+void Imuse::startStatus(TrackStatus *status, const char *soundName, int volGroupId, int volume, int pan) {
+	int slot = -1;
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
-		Track *track = _track[l];
-		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
-			return track->vol / 1000;
+		if (status[l].used && !scumm_stricmp(status[l].soundName, soundName))
+			return;
+		if (!status[l].used && slot == -1)
+			slot = l;
+	}
+	if (slot == -1)
+		return;
+
+	TrackStatus *track = &status[slot];
+	memset(track, 0, sizeof(TrackStatus));
+	Common::strlcpy(track->soundName, soundName, sizeof(track->soundName));
+	track->used = true;
+	track->playing = true;
+	track->volGroupId = volGroupId;
+	track->vol = volume * 1000;
+	track->pan = pan * 1000;
+}
+
+// Changes the status as far as the queries can tell what the command will
+// do to the tracks. Fades and hooks only show once the callback ran.
+void Imuse::applyToStatus(TrackStatus *status, const Command &cmd) {
+	TrackStatus *track = findStatus(status, cmd.soundName);
+
+	switch (cmd.type) {
+	case kCommandSetVolume:
+		if (track)
+			track->vol = cmd.param1 * 1000;
+		break;
+	case kCommandSetPan:
+		if (track)
+			track->pan = cmd.param1 * 1000;
+		break;
+	case kCommandSelectVolumeGroup:
+		if (track)
+			track->volGroupId = cmd.param1;
+		break;
+	case kCommandStopSound:
+		if (track)
+			track->toBeRemoved = true;
+		break;
+	case kCommandStartSound:
+		startStatus(status, cmd.soundName, cmd.param1, cmd.param3, cmd.param4);
+		break;
+	case kCommandFadeOutMusic:
+		track = findMusicStatus(status);
+		if (track)
+			track->toBeRemoved = true;
+		break;
+	case kCommandFadeOutMusicAndStartNew:
+		track = findMusicStatus(status);
+		if (track) {
+			startStatus(status, cmd.soundName, IMUSE_VOLGRP_MUSIC, cmd.param3, cmd.param4);
+			track->toBeRemoved = true;
 		}
+		break;
+	case kCommandStopAllSounds:
+		memset(status, 0, MAX_IMUSE_TRACKS * sizeof(TrackStatus));
+		break;
+	default:
+		break;
 	}
-	return 0;
+}
+
+char *Imuse::getCurMusicSoundName() {
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
+	TrackStatus *track = findMusicStatus(status);
+	if (!track)
+		return NULL;
+	Common::strlcpy(_curMusicSoundName, track->soundName, sizeof(_curMusicSoundName));
+	return _curMusicSoundName;
+}
+
+int Imuse::getCurMusicPan() {
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
+	TrackStatus *track = findMusicStatus(status);
+	return track ? track->pan / 1000 : 0;
+}
+
+int Imuse::getCurMusicVol() {
+	TrackStatus status[MAX_IMUSE_TRACKS];
+	getStatus(status);
+	TrackStatus *track = findMusicStatus(status);
+	return track ? track->vol / 1000 : 0;
 }
 
 void Imuse::fadeOutMusic(int duration) {
-	Common::StackLock lock(_mutex);
+	sendCommand(kCommandFadeOutMusic, "", duration);
+}
+
+void Imuse::fadeOutMusicAndStartNew(int fadeDelay, const char *filename, int hookId, int vol, int pan) {
+	sendCommand(kCommandFadeOutMusicAndStartNew, filename, fadeDelay, hookId, vol, pan);
+}
+
+void Imuse::fadeOutMusicTrack(int duration) {
+	// Called with _mutex held
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
 		Track *track = _track[l];
 		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
@@ -330,13 +461,14 @@ void Imuse::fadeOutMusic(int duration) {
 	}
 }
 
-void Imuse::fadeOutMusicAndStartNew(int fadeDelay, const char *filename, int hookId, int vol, int pan) {
-	Common::StackLock lock(_mutex);
-
+void Imuse::fadeOutMusicTrackAndStartNew(int fadeDelay, const char *filename, int hookId, int vol, int pan) {
+	// Called with _mutex held
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
 		Track *track = _track[l];
 		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
-			startMusicWithOtherPos(filename, 0, vol, pan, track);
+			if (gDebugLevel == DEBUG_IMUSE || gDebugLevel == DEBUG_ALL)
+				debug("Imuse::fadeOutMusicTrackAndStartNew(): SoundName %s, vol:%d, pan:%d", filename, vol, pan);
+			startTrack(filename, IMUSE_VOLGRP_MUSIC, 0, vol, pan, 126, track);
 			moveToFadeOutTrack(track, fadeDelay);
 			break;
 		}
@@ -154,21 +154,31 @@ KeyframeAnim::~KeyframeAnim() {
 	g_resourceloader->uncacheKeyframe(this);
 }
 
-bool KeyframeAnim::animate(ModelNode *nodes, int num, float time, float fade, bool tagged) const {
-	// Without this sending the bread down the tube in "mo" often crashes,
-	// because it goes outside the bounds of the array of the nodes.
-	if (num >= _numJoints)
-		return false;
+void KeyframeAnim::animate(const ModelNode *nodes, int numNodes, float time, Common::Array<int> &cursors, float *pose) const {
+	if (cursors.size() != (uint)_numJoints) {
+		cursors.resize(_numJoints);
+		for (int i = 0; i < _numJoints; i++)
+			cursors[i] = 0;
+	}
 
 	float frame = time * _fps;
 
 	if (frame > _numFrames)
 		frame = _numFrames;
 
-	if (_nodes[num] && tagged == ((_type & nodes[num]._type) != 0)) {
-		return _nodes[num]->animate(nodes[num], frame, fade, (_flags & 256) == 0);
-	} else {
-		return false;
+	bool useDelta = (_flags & 256) == 0;
+	for (int i = 0; i < numNodes; i++, pose += kPoseSize) {
+		// Without the joints check sending the bread down the tube in "mo"
+		// often crashes, because it goes outside the bounds of the array
+		// of the nodes.
+		if (i < _numJoints && _nodes[i] && _nodes[i]->animate(nodes[i], frame, useDelta, cursors[i], pose)) {
+			bool tagged = (_type & nodes[i]._type) != 0;
+			pose[kPoseUntagged] = tagged ? 0.f : 1.f;
+			pose[kPoseTagged] = tagged ? 1.f : 0.f;
+		} else {
+			pose[kPoseUntagged] = 0.f;
+			pose[kPoseTagged] = 0.f;
+		}
 	}
 }
 
@@ -243,20 +253,30 @@ KeyframeAnim::KeyframeNode::~KeyframeNode() {
 	delete[] _entries;
 }
 
-bool KeyframeAnim::KeyframeNode::animate(ModelNode &node, float frame, float fade, bool useDelta) const {
+bool KeyframeAnim::KeyframeNode::animate(const ModelNode &node, float frame, bool useDelta, int &cursor, float *pose) const {
 	if (_numEntries == 0)
 		return false;
 
-	// Do a binary search for the nearest previous frame
-	// Loop invariant: entries_[low].frame_ <= frame < entries_[high].frame_
-	int low = 0, high = _numEntries;
-	while (high > low + 1) {
-		int mid = (low + high) / 2;
-		if (_entries[mid]._frame <= frame)
-			low = mid;
-		else
-			high = mid;
+	// Find the nearest previous frame. The animations mostly move forward
+	// by less than a keyframe per call, so start from where the last call
+	// stopped and only do a binary search when going back.
+	int low = cursor;
+	if (low >= _numEntries || (low > 0 && _entries[low]._frame > frame)) {
+		// Loop invariant: entries_[low].frame_ <= frame < entries_[high].frame_
+		int high = _numEntries;
+		low = 0;
+		while (high > low + 1) {
+			int mid = (low + high) / 2;
+			if (_entries[mid]._frame <= frame)
+				low = mid;
+			else
+				high = mid;
+		}
+	} else {
+		while (low + 1 < _numEntries && _entries[low + 1]._frame <= frame)
+			low++;
 	}
+	cursor = low;
 
 	float dt = frame - _entries[low]._frame;
 	Math::Vector3d pos = _entries[low]._pos;
@@ -270,16 +290,13 @@ bool KeyframeAnim::KeyframeNode::animate(ModelNode &node, float frame, float fad
 		roll += dt * _entries[low]._droll;
 	}
 
-	node._animPos += (pos - node._pos) * fade;
-
-	Math::Angle dpitch = pitch - node._pitch;
-	node._animPitch += dpitch.normalize(-180) * fade;
-
-	Math::Angle dyaw = yaw - node._yaw;
-	node._animYaw += dyaw.normalize(-180) * fade;
-
-	Math::Angle droll = roll - node._roll;
-	node._animRoll += droll.normalize(-180) * fade;
+	pos -= node._pos;
+	pose[kPosePos + 0] = pos.x();
+	pose[kPosePos + 1] = pos.y();
+	pose[kPosePos + 2] = pos.z();
+	pose[kPosePitch] = (pitch - node._pitch).getDegrees(-180);
+	pose[kPoseYaw] = (yaw - node._yaw).getDegrees(-180);
+	pose[kPoseRoll] = (roll - node._roll).getDegrees(-180);
 
 	return true;
 }
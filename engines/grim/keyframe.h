@@ -23,6 +23,8 @@
 #ifndef GRIM_KEYFRAME_H
 #define GRIM_KEYFRAME_H
 
+#include "common/array.h"
+
 #include "math/vector3d.h"
 
 #include "engines/grim/object.h"
@@ -34,12 +36,40 @@ class TextSplitter;
 
 class KeyframeAnim : public Object {
 public:
+	/**
+	 * Layout of the pose written by animate(), kPoseSize floats per node.
+	 * The position and the angles are the offsets from the rest pose of the
+	 * node, the angles normalized to [-180, 180). The two flags are 1 when
+	 * the animation moves the node for untagged resp. tagged playback and 0
+	 * otherwise.
+	 */
+	enum {
+		kPosePos = 0,
+		kPosePitch = 3,
+		kPoseYaw = 4,
+		kPoseRoll = 5,
+		kPoseUntagged = 6,
+		kPoseTagged = 7,
+		kPoseSize = 8
+	};
+
 	KeyframeAnim(const Common::String &filename, const char *data, int len);
 	~KeyframeAnim();
 
 	void loadBinary(const char *data, int len);
 	void loadText(TextSplitter &ts);
-	bool animate(ModelNode *nodes, int num, float time, float fade, bool tagged) const;
+	/**
+	 * Samples the animation at the given time for all the nodes at once.
+	 *
+	 * @param nodes		the nodes of the model
+	 * @param numNodes	the number of nodes
+	 * @param time		the time in seconds
+	 * @param cursors	the playback cursors of the caller, one per joint;
+	 *					they are advanced from the previous call instead of
+	 *					searching the keyframes from scratch
+	 * @param pose		receives numNodes * kPoseSize floats
+	 */
+	void animate(const ModelNode *nodes, int numNodes, float time, Common::Array<int> &cursors, float *pose) const;
 	int getMarker(float startTime, float stopTime) const;
 
 	float getLength() const { return _numFrames / _fps; }
@@ -72,7 +102,7 @@ private:
 		void loadText(TextSplitter &ts);
 		~KeyframeNode();
 
-		bool animate(ModelNode &node, float frame, float fade, bool useDelta) const;
+		bool animate(const ModelNode &node, float frame, bool useDelta, int &cursor, float *pose) const;
 
 		char _meshName[32];
 		int _numEntries;
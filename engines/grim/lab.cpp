@@ -20,21 +20,39 @@
  *
  */
 
+#if defined(POSIX)
+// Re-enable some forbidden symbols to avoid clashes with stat.h and unistd.h.
+#define FORBIDDEN_SYMBOL_EXCEPTION_unistd_h
+#define FORBIDDEN_SYMBOL_EXCEPTION_mkdir
+#endif
+
 #include "common/endian.h"
 #include "common/file.h"
+#include "common/fs.h"
+#include "common/md5.h"
+#include "common/memstream.h"
 #include "common/substream.h"
+#include "common/config-manager.h"
 
 #include "engines/grim/grim.h"
 #include "engines/grim/lab.h"
 #include "engines/grim/lua/lua.h"
 #include "engines/grim/colormap.h"
 
+#if defined(POSIX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace Grim {
 
-bool Lab::open(const Common::String &filename) {
+bool Lab::open(const Common::String &filename, Common::SeekableReadStream *index) {
 	_labFileName = filename;
 
 	close();
+	_indexed = false;
 
 	_f = new Common::File();
 	if (!_f->open(filename))
@@ -47,14 +65,70 @@ bool Lab::open(const Common::String &filename) {
 
 	_f->readUint32LE(); // version
 
-	if (g_grim->getGameType() == GType_GRIM)
+	if (index && loadIndex(index))
+		_indexed = true;
+	else if (g_grim->getGameType() == GType_GRIM)
 		parseGrimFileTable();
 	else
 		parseMonkey4FileTable();
 
+	// With "lab_mmap" set the whole archive is mapped once and resources
+	// are handed out as views into the mapping instead of heap copies.
+	if (ConfMan.hasKey("lab_mmap") && ConfMan.getBool("lab_mmap")) {
+		if (!mapFile())
+			warning("Could not memory map %s, falling back to reads", filename.c_str());
+	}
+
 	return true;
 }
 
+bool Lab::mapFile() {
+#if defined(POSIX)
+	Common::ArchiveMemberPtr member = SearchMan.getMember(_labFileName);
+	const Common::FSNode *node = dynamic_cast<const Common::FSNode *>(member.get());
+	if (!node)
+		return false;
+
+	int fd = ::open(node->getPath().c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	_mapData = (const char *)data;
+	_mapSize = st.st_size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Lab::unmapFile() {
+#if defined(POSIX)
+	if (_mapData)
+		munmap(const_cast<char *>(_mapData), _mapSize);
+#endif
+	_mapData = NULL;
+	_mapSize = 0;
+}
+
+// Whether the entry lies inside the first size bytes of the archive. A bad
+// file table must not turn into reads or views past the end of it.
+bool Lab::isEntryInside(const LabEntry &entry, uint32 size) {
+	return entry.offset >= 0 && entry.len >= 0 && (uint32)entry.offset <= size &&
+		(uint32)entry.len <= size - (uint32)entry.offset;
+}
+
 void Lab::parseGrimFileTable() {
 	uint32 entryCount = _f->readUint32LE();
 	uint32 stringTableSize = _f->readUint32LE();
@@ -122,6 +196,96 @@ void Lab::parseMonkey4FileTable() {
 	delete[] stringTable;
 }
 
+static void writeIndexString(Common::WriteStream *out, const Common::String &str) {
+	out->writeUint32LE(str.size());
+	out->write(str.c_str(), str.size());
+}
+
+static bool readIndexString(Common::SeekableReadStream *in, Common::String &str) {
+	uint32 len = in->readUint32LE();
+	if (in->eos() || len > 1024)
+		return false;
+
+	char *buf = new char[len];
+	uint32 read = in->read(buf, len);
+	str = Common::String(buf, read);
+	delete[] buf;
+	return read == len;
+}
+
+// Identifies the contents of the archive for the index: besides the size,
+// the modification time where the file system has one, and a checksum of
+// the header and the start of the file table.
+void Lab::getStamp(uint32 &modTime, uint8 digest[16]) const {
+	modTime = 0;
+#if defined(POSIX)
+	Common::ArchiveMemberPtr member = SearchMan.getMember(_labFileName);
+	const Common::FSNode *node = dynamic_cast<const Common::FSNode *>(member.get());
+	struct stat st;
+	if (node && stat(node->getPath().c_str(), &st) == 0)
+		modTime = (uint32)st.st_mtime;
+#endif
+
+	int32 pos = _f->pos();
+	_f->seek(0, SEEK_SET);
+	if (!Common::computeStreamMD5(*_f, digest, 4096))
+		memset(digest, 0, 16);
+	_f->seek(pos, SEEK_SET);
+}
+
+void Lab::saveIndex(Common::WriteStream *out) const {
+	uint32 modTime;
+	uint8 digest[16];
+	getStamp(modTime, digest);
+
+	writeIndexString(out, _labFileName);
+	out->writeUint32LE(_f->size());
+	out->writeUint32LE(modTime);
+	out->write(digest, 16);
+	out->writeUint32LE(_entries.size());
+
+	for (LabMap::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
+		writeIndexString(out, i->_key);
+		out->writeSint32LE(i->_value.offset);
+		out->writeSint32LE(i->_value.len);
+	}
+}
+
+bool Lab::loadIndex(Common::SeekableReadStream *index) {
+	uint32 modTime;
+	uint8 digest[16];
+	getStamp(modTime, digest);
+
+	Common::String name;
+	if (!readIndexString(index, name))
+		return false;
+	uint32 size = index->readUint32LE();
+	uint32 indexModTime = index->readUint32LE();
+	uint8 indexDigest[16];
+	index->read(indexDigest, 16);
+	uint32 entryCount = index->readUint32LE();
+	if (index->eos() || !name.equalsIgnoreCase(_labFileName) || size != (uint32)_f->size() ||
+		indexModTime != modTime || memcmp(indexDigest, digest, 16) != 0)
+		return false;
+
+	for (uint32 i = 0; i < entryCount; i++) {
+		Common::String fname;
+		bool valid = readIndexString(index, fname);
+
+		LabEntry entry;
+		entry.offset = index->readSint32LE();
+		entry.len = index->readSint32LE();
+		if (!valid || index->eos() || !isEntryInside(entry, size)) {
+			_entries.clear();
+			return false;
+		}
+
+		_entries[fname] = entry;
+	}
+
+	return true;
+}
+
 bool Lab::getFileExists(const Common::String &filename) const {
 	return _entries.contains(filename);
 }
@@ -131,50 +295,86 @@ bool Lab::isOpen() const {
 }
 
 Block *Lab::getFileBlock(const Common::String &filename) const {
-	if (!getFileExists(filename))
+	LabMap::const_iterator i = _entries.find(filename);
+	if (i == _entries.end())
 		return 0;
 
-	const LabEntry &i = _entries[filename];
+	return getFileBlock(i->_key, i->_value);
+}
+
+Block *Lab::getFileBlock(const Common::String &filename, const LabEntry &entry, Common::SeekableReadStream *archive) const {
+	if (_mapData) {
+		if (!isEntryInside(entry, _mapSize)) {
+			warning("%s is outside of %s", filename.c_str(), _labFileName.c_str());
+			return NULL;
+		}
+		return new Block(_mapData + entry.offset, entry.len, DisposeAfterUse::NO);
+	}
 
-	_f->seek(i.offset, SEEK_SET);
-	char *data = new char[i.len];
-	_f->read(data, i.len);
-	return new Block(data, i.len);
+	if (!archive)
+		archive = _f;
+	archive->seek(entry.offset, SEEK_SET);
+	char *data = new char[entry.len];
+	if (archive->read(data, entry.len) != (uint32)entry.len) {
+		delete[] data;
+		return NULL;
+	}
+	return new Block(data, entry.len);
 }
 
 LuaFile *Lab::openNewStreamLua(const Common::String &filename) const {
-	if (!getFileExists(filename))
+	LabMap::const_iterator i = _entries.find(filename);
+	if (i == _entries.end())
 		return 0;
 
-	Common::File *file = new Common::File();
-	file->open(_labFileName);
-	file->seek(_entries[filename].offset, SEEK_SET);
+	return openNewStreamLua(i->_value);
+}
 
+LuaFile *Lab::openNewStreamLua(const LabEntry &entry) const {
 	LuaFile *filehandle = new LuaFile();
-	filehandle->_in = file;
+	filehandle->_in = openNewStreamFile(entry);
 
 	return filehandle;
 }
 
 Common::File *Lab::openNewStreamFile(const Common::String &filename) const {
-	if (!getFileExists(filename))
+	LabMap::const_iterator i = _entries.find(filename);
+	if (i == _entries.end())
 		return 0;
 
+	return openNewStreamFile(i->_value);
+}
+
+Common::File *Lab::openNewStreamFile(const LabEntry &entry) const {
 	Common::File *file = new Common::File();
 	file->open(_labFileName);
-	file->seek(_entries[filename].offset, SEEK_SET);
+	file->seek(entry.offset, SEEK_SET);
 
 	return file;
 }
+
 // SubStream, for usage with GZipReadStream
 Common::SeekableReadStream *Lab::openNewSubStreamFile(const Common::String &filename) const {
-	if (!getFileExists(filename))
+	LabMap::const_iterator i = _entries.find(filename);
+	if (i == _entries.end())
 		return 0;
 
+	return openNewSubStreamFile(i->_key, i->_value);
+}
+
+Common::SeekableReadStream *Lab::openNewSubStreamFile(const Common::String &filename, const LabEntry &entry) const {
+	if (_mapData) {
+		if (!isEntryInside(entry, _mapSize)) {
+			warning("%s is outside of %s", filename.c_str(), _labFileName.c_str());
+			return NULL;
+		}
+		return new Common::MemoryReadStream((const byte *)_mapData + entry.offset, entry.len);
+	}
+
 	Common::File *file = new Common::File();
 	file->open(_labFileName);
 	Common::SeekableSubReadStream *substream;
-	substream = new Common::SeekableSubReadStream(file, _entries[filename].offset, _entries[filename].offset + _entries[filename].len, DisposeAfterUse::YES );
+	substream = new Common::SeekableSubReadStream(file, entry.offset, entry.offset + entry.len, DisposeAfterUse::YES );
 	return substream;
 }
 
@@ -186,6 +386,8 @@ int Lab::getFileLength(const Common::String &filename) const {
 }
 
 void Lab::close() {
+	unmapFile();
+
 	delete _f;
 	_f = NULL;
 
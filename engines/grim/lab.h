@@ -26,9 +26,12 @@
 #include "common/hashmap.h"
 #include "common/hash-str.h"
 #include "common/str.h"
+#include "common/types.h"
 
 namespace Common {
 	class File;
+	class SeekableReadStream;
+	class WriteStream;
 }
 
 namespace Grim {
@@ -37,24 +40,43 @@ class LuaFile;
 
 class Block {
 public:
-	Block(const char *dataPtr, int length) : _data(dataPtr), _len(length) {}
+	/**
+	 * Wraps a resource buffer. With DisposeAfterUse::NO the block is only
+	 * a view (e.g. into a memory mapped LAB) and does not free the data.
+	 */
+	Block(const char *dataPtr, int length, DisposeAfterUse::Flag dispose = DisposeAfterUse::YES) :
+		_data(dataPtr), _len(length), _dispose(dispose) {}
 	const char *getData() const { return _data; }
 	int getLen() const { return _len; }
 
-	~Block() { delete[] _data; }
+	~Block() {
+		if (_dispose == DisposeAfterUse::YES)
+			delete[] _data;
+	}
 
 private:
 	Block();
 	const char *_data;
 	int _len;
+	DisposeAfterUse::Flag _dispose;
 };
 
 class Lab {
 public:
-	Lab() : _f(NULL) { }
-
-	bool open(const Common::String &filename);
+	Lab() : _f(NULL), _mapData(NULL), _mapSize(0), _indexed(false) { }
+
+	/**
+	 * Open a LAB archive. If an index stream is given, the file table is
+	 * read from it (see saveIndex) instead of being parsed from the archive.
+	 * Should the index not match the archive, the table is parsed as usual
+	 * and isIndexed() returns false.
+	 */
+	bool open(const Common::String &filename, Common::SeekableReadStream *index = NULL);
 	bool isOpen() const;
+	bool isIndexed() const { return _indexed; }
+	void saveIndex(Common::WriteStream *out) const;
+	bool isMapped() const { return _mapData != NULL; }
+	const Common::String &getFileName() const { return _labFileName; }
 	void close();
 	bool getFileExists(const Common::String &filename) const;
 	Block *getFileBlock(const Common::String &filename) const;
@@ -68,13 +90,36 @@ public:
 	struct LabEntry {
 		int offset, len;
 	};
+	typedef Common::HashMap<Common::String, LabEntry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> LabMap;
+
+	/**
+	 * The same as the functions above, for an entry of getEntries() which
+	 * was already looked up. The file name is only used in messages.
+	 *
+	 * getFileBlock() can read through the given handle on the archive
+	 * instead of the shared one, e.g. from a thread other than the main
+	 * one. Memory mapped archives return views as usual.
+	 */
+	Block *getFileBlock(const Common::String &filename, const LabEntry &entry, Common::SeekableReadStream *archive = NULL) const;
+	Common::File *openNewStreamFile(const LabEntry &entry) const;
+	Common::SeekableReadStream *openNewSubStreamFile(const Common::String &filename, const LabEntry &entry) const;
+	LuaFile *openNewStreamLua(const LabEntry &entry) const;
+
+	const LabMap &getEntries() const { return _entries; }
 
 private:
 	void parseGrimFileTable();
 	void parseMonkey4FileTable();
+	bool loadIndex(Common::SeekableReadStream *index);
+	bool mapFile();
+	void unmapFile();
+	void getStamp(uint32 &modTime, uint8 digest[16]) const;
+	static bool isEntryInside(const LabEntry &entry, uint32 size);
 
 	Common::File *_f;
-	typedef Common::HashMap<Common::String, LabEntry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> LabMap;
+	const char *_mapData;
+	uint32 _mapSize;
+	bool _indexed;
 	LabMap _entries;
 	Common::String _labFileName;
 };
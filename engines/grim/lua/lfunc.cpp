@@ -33,6 +33,7 @@ TProtoFunc *luaF_newproto() {
 	f->consts = NULL;
 	f->nconsts = 0;
 	f->locvars = NULL;
+	f->slots = NULL;
 	luaO_insertlist(&rootproto, (GCnode *)f);
 	nblocks += gcsizeproto(f);
 	return f;
@@ -42,6 +43,7 @@ static void freefunc(TProtoFunc *f) {
 	luaM_free(f->code);
 	luaM_free(f->locvars);
 	luaM_free(f->consts);
+	luaM_free(f->slots);
 	luaM_free(f);
 }
 
@@ -145,50 +145,90 @@ static GCnode *listcollect(GCnode *l) {
 	return frees;
 }
 
+/*
+** =======================================================
+** Marking
+** =======================================================
+** Marking is tri-color: white objects have marked == 0, gray ones wait
+** in a gray list with marked == GCGRAY and black ones have marked == 1.
+** Strings have no children and go straight to black.
+*/
+
+#define GCGRAY 3
+
+struct GrayList {
+	TObject *objects;
+	int32 size;
+	int32 top;
+};
+
+static GrayList gray = { NULL, 0, 0 };  // objects waiting to be traversed
+static GrayList grayagain = { NULL, 0, 0 };  // black tables written to during the mark phase
+
+static void graypush(GrayList *l, TObject *o) {
+	if (l->top >= l->size)
+		l->size = luaM_growvector(&l->objects, l->top, TObject, memEM, MAX_INT);
+	l->objects[l->top++] = *o;
+}
+
+static void grayfree(GrayList *l) {
+	luaM_free(l->objects);
+	l->objects = NULL;
+	l->size = 0;
+	l->top = 0;
+}
+
+static void graymark(GCnode *head, lua_Type t, TObject *o) {
+	if (!head->marked) {
+		TObject g;
+		head->marked = GCGRAY;
+		ttype(&g) = t;
+		g.value = o->value;
+		graypush(&gray, &g);
+	}
+}
+
 static void strmark(TaggedString *s) {
 	if (!s->head.marked)
 		s->head.marked = 1;
 }
 
-static void protomark(TProtoFunc *f) {
-	if (!f->head.marked) {
-		LocVar *v = f->locvars;
-		int32 i;
-		f->head.marked = 1;
-		if (f->fileName)
-			strmark(f->fileName);
-		for (i = 0; i < f->nconsts; i++)
-			markobject(&f->consts[i]);
-		if (v) {
-			for (; v->line != -1; v++) {
-				if (v->varname)
-					strmark(v->varname);
-			}
+static int32 protomark(TProtoFunc *f) {
+	LocVar *v = f->locvars;
+	int32 i;
+	f->head.marked = 1;
+	if (f->fileName)
+		strmark(f->fileName);
+	for (i = 0; i < f->nconsts; i++)
+		markobject(&f->consts[i]);
+	if (v) {
+		for (; v->line != -1; v++) {
+			if (v->varname)
+				strmark(v->varname);
 		}
 	}
+	return f->nconsts + 1;
 }
 
-static void closuremark(Closure *f) {
-	if (!f->head.marked) {
-		int32 i;
-		f->head.marked = 1;
-		for (i = f->nelems; i >= 0; i--)
-			markobject(&f->consts[i]);
-	}
+static int32 closuremark(Closure *f) {
+	int32 i;
+	f->head.marked = 1;
+	for (i = f->nelems; i >= 0; i--)
+		markobject(&f->consts[i]);
+	return f->nelems + 2;
 }
 
-static void hashmark(Hash *h) {
-	if (!h->head.marked) {
-		int32 i;
-		h->head.marked = 1;
-		for (i = 0; i < nhash(h); i++) {
-			Node *n = node(h, i);
-			if (ttype(ref(n)) != LUA_T_NIL) {
-				markobject(&n->ref);
-				markobject(&n->val);
-			}
+static int32 hashmark(Hash *h) {
+	int32 i;
+	h->head.marked = 1;
+	for (i = 0; i < nhash(h); i++) {
+		Node *n = node(h, i);
+		if (ttype(ref(n)) != LUA_T_NIL) {
+			markobject(&n->ref);
+			markobject(&n->val);
 		}
 	}
+	return nhash(h) + 1;
 }
 
 static void globalmark() {
@@ -207,15 +247,15 @@ static int32 markobject(TObject *o) {
 		strmark(tsvalue(o));
 		break;
 	case LUA_T_ARRAY:
-		hashmark(avalue(o));
+		graymark(&avalue(o)->head, LUA_T_ARRAY, o);
 		break;
 	case LUA_T_CLOSURE:
 	case LUA_T_CLMARK:
-		closuremark(o->value.cl);
+		graymark(&clvalue(o)->head, LUA_T_CLOSURE, o);
 		break;
 	case LUA_T_PROTO:
 	case LUA_T_PMARK:
-		protomark(o->value.tf);
+		graymark(&tfvalue(o)->head, LUA_T_PROTO, o);
 		break;
 	default:
 		break;  // numbers, cprotos, etc
@@ -223,6 +263,26 @@ static int32 markobject(TObject *o) {
 	return 0;
 }
 
+// Traverses gray objects until about 'work' units are done, and returns
+// what is left of it.
+static int32 propagate(int32 work) {
+	while (gray.top > 0 && work > 0) {
+		TObject o = gray.objects[--gray.top];
+		switch (ttype(&o)) {
+		case LUA_T_ARRAY:
+			work -= hashmark(avalue(&o));
+			break;
+		case LUA_T_CLOSURE:
+			work -= closuremark(clvalue(&o));
+			break;
+		default:
+			work -= protomark(tfvalue(&o));
+			break;
+		}
+	}
+	return work;
+}
+
 static void markall() {
 	luaD_travstack(markobject); // mark stack objects
 	globalmark();  // mark global variable values and names
@@ -231,12 +291,16 @@ static void markall() {
 }
 
 int32 lua_collectgarbage(int32 limit) {
-	int32 recovered = nblocks;  // to subtract nblocks after gc
+	int32 recovered;
 	Hash *freetable;
 	TaggedString *freestr;
 	TProtoFunc *freefunc;
 	Closure *freeclos;
+	luaC_completecycle();
+	recovered = nblocks;  // to subtract nblocks after gc
 	markall();
+	propagate(MAX_INT);
+	grayfree(&gray);
 	invalidaterefs();
 	freestr = luaS_collector();
 	freetable = (Hash *)listcollect(&roottable);
@@ -255,9 +319,229 @@ int32 lua_collectgarbage(int32 limit) {
 	return recovered;
 }
 
+/*
+** =======================================================
+** Incremental collection
+** =======================================================
+** With a step size set by lua_setgcstep, a cycle marks the roots when
+** it starts and then does about that many units of work per step.
+** Tables are the only objects that change after they are created, so a
+** write to a black table turns it gray again (luaC_tablebarrier) and the
+** atomic step traverses it once more, together with the stacks, locked
+** refs and tag methods. Global values are marked as they are set
+** (luaC_globalbarrier). The atomic step then detaches the object lists
+** and the sweep walks them a few objects at a time, while the objects
+** created meanwhile are linked to the now empty lists and stay alive.
+** While a cycle runs, GCthreshold is the point where allocation itself
+** does the next step, so that the cycle keeps ahead of the scripts even
+** when the per frame steps are too small.
+*/
+
+#define GCSTEPMUL 8  // units of work per block allocated during a cycle
+
+enum GCState {
+	GCSpause,
+	GCSpropagate,
+	GCSsweep,
+	GCSsweepstring
+};
+
+struct SweepList {
+	GCnode *root;
+	GCnode *next;  // next object to sweep
+	GCnode *survivors;
+	GCnode *lastSurvivor;
+	GCnode *frees;
+};
+
+enum { SWEEP_TABLE, SWEEP_CLOSURE, SWEEP_PROTO, SWEEP_N };
+
+static int32 gcStepSize = 0;  // 0: stop-the-world collections
+static GCState gcState = GCSpause;
+static SweepList sweepLists[SWEEP_N];
+static int32 sweepList;
+static TaggedString *freeStrings = NULL;
+static bool deferFree;  // some tag has a GC tag method, free at the end of the cycle
+
+static void freegarbage() {
+	luaH_free((Hash *)sweepLists[SWEEP_TABLE].frees);
+	luaF_freeclosure((Closure *)sweepLists[SWEEP_CLOSURE].frees);
+	luaF_freeproto((TProtoFunc *)sweepLists[SWEEP_PROTO].frees);
+	luaS_free(freeStrings);
+	sweepLists[SWEEP_TABLE].frees = NULL;
+	sweepLists[SWEEP_CLOSURE].frees = NULL;
+	sweepLists[SWEEP_PROTO].frees = NULL;
+	freeStrings = NULL;
+}
+
+static bool hasgcIM() {
+	int32 t;
+	for (t = 0; t >= last_tag; t--) {
+		if (t != LUA_T_NIL && ttype(luaT_getim(t, IM_GC)) != LUA_T_NIL)
+			return true;
+	}
+	return false;
+}
+
+static void beginsweep(SweepList *s, GCnode *root) {
+	s->root = root;
+	s->next = root->next;
+	s->survivors = NULL;
+	s->lastSurvivor = NULL;
+	s->frees = NULL;
+	root->next = NULL;
+}
+
+// Returns true when the whole list is swept.
+static bool sweep(SweepList *s, int32 *work) {
+	while (s->next && *work > 0) {
+		GCnode *o = s->next;
+		s->next = o->next;
+		if (o->marked) {
+			o->marked = 0;
+			o->next = NULL;
+			if (s->lastSurvivor)
+				s->lastSurvivor->next = o;
+			else
+				s->survivors = o;
+			s->lastSurvivor = o;
+		} else {
+			o->next = s->frees;
+			s->frees = o;
+		}
+		(*work)--;
+	}
+	if (s->next)
+		return false;
+	if (s->lastSurvivor) {
+		s->lastSurvivor->next = s->root->next;
+		s->root->next = s->survivors;
+	}
+	return true;
+}
+
+static void begincycle() {
+	markall();
+	gcState = GCSpropagate;
+}
+
+static void atomic() {
+	luaD_travstack(markobject);
+	travlock();
+	luaT_travtagmethods(markobject);
+	while (grayagain.top > 0)
+		graypush(&gray, &grayagain.objects[--grayagain.top]);
+	propagate(MAX_INT);
+	grayfree(&gray);
+	grayfree(&grayagain);
+	invalidaterefs();
+	deferFree = hasgcIM();
+	luaS_beginsweep();
+	beginsweep(&sweepLists[SWEEP_TABLE], &roottable);
+	beginsweep(&sweepLists[SWEEP_CLOSURE], &rootcl);
+	beginsweep(&sweepLists[SWEEP_PROTO], &rootproto);
+	sweepList = SWEEP_TABLE;
+	gcState = GCSsweep;
+}
+
+static void endcycle() {
+	gcState = GCSpause;
+	GCthreshold = MAX_INT;  // to avoid GC during GC
+	if (deferFree) {
+		luaC_hashcallIM((Hash *)sweepLists[SWEEP_TABLE].frees);  // GC tag methods for tables
+		luaC_strcallIM(freeStrings);  // GC tag methods for userdata
+	}
+	luaD_gcIM(&luaO_nilobject);  // GC tag method for nil (signal end of GC)
+	freegarbage();
+	GCthreshold = 2 * nblocks;
+}
+
+static void gcstep(int32 work) {
+	while (work > 0) {
+		switch (gcState) {
+		case GCSpause:
+			return;
+		case GCSpropagate:
+			work = propagate(work);
+			if (gray.top == 0)
+				atomic();
+			break;
+		case GCSsweep:
+			if (sweep(&sweepLists[sweepList], &work) && ++sweepList == SWEEP_N)
+				gcState = GCSsweepstring;
+			break;
+		case GCSsweepstring:
+			{
+				int32 n = luaS_sweepstep(&freeStrings);
+				if (n < 0) {
+					endcycle();
+					return;
+				}
+				work -= n;
+			}
+			break;
+		}
+	}
+	if (!deferFree)
+		freegarbage();
+	if (gcState != GCSpause)
+		GCthreshold = nblocks + gcStepSize / GCSTEPMUL;
+}
+
+void luaC_completecycle() {
+	if (gcState != GCSpause)
+		gcstep(MAX_INT);
+}
+
+void luaC_tablebarrier(Hash *t) {
+	if (gcState == GCSpropagate && t->head.marked == 1) {
+		TObject o;
+		t->head.marked = GCGRAY;
+		ttype(&o) = LUA_T_ARRAY;
+		avalue(&o) = t;
+		graypush(&grayagain, &o);
+	}
+}
+
+void luaC_globalbarrier(TaggedString *g) {
+	if (gcState == GCSpropagate) {
+		strmark(g);
+		markobject(&g->globalval);
+	}
+}
+
+void lua_setgcstep(int32 work) {
+	gcStepSize = work;
+	if (gcStepSize <= 0)
+		luaC_completecycle();
+}
+
+// Does one step of the running cycle. With 'start' set a new cycle begins
+// when none is running; without a step size that is a full collection.
+void lua_stepgarbage(int32 start) {
+	if (gcStepSize <= 0) {
+		if (start)
+			lua_collectgarbage(0);
+		return;
+	}
+	if (gcState == GCSpause) {
+		if (!start)
+			return;
+		begincycle();
+	}
+	gcstep(gcStepSize);
+}
+
 void luaC_checkGC() {
-	if (nblocks >= GCthreshold)
+	if (nblocks < GCthreshold)
+		return;
+	if (gcStepSize <= 0) {
 		lua_collectgarbage(0);
+		return;
+	}
+	if (gcState == GCSpause)
+		begincycle();
+	gcstep(gcStepSize);
 }
 
 } // end of namespace Grim
@@ -6,6 +6,9 @@
 #define FORBIDDEN_SYMBOL_EXCEPTION_setjmp
 #define FORBIDDEN_SYMBOL_EXCEPTION_longjmp
 
+#include "common/debug.h"
+#include "common/memorypool.h"
+
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lstate.h"
 #include "engines/grim/lua/lua.h"
@@ -25,20 +28,142 @@ int32 luaM_growaux(void **block, int32 nelems, int32 size, const char *errormsg,
 #ifndef LUA_DEBUG
 
 /*
-** generic allocation routine.
-** real ANSI systems do not need some of these tests,
-** since realloc(NULL, s)==malloc(s) and realloc(b, 0)==free(b).
-** But some systems (e.g. Sun OS) are not that ANSI...
+** Blocks of up to 4096 bytes come from a Common::MemoryPool per size
+** class, larger ones from malloc. Every block starts with a header that
+** tells which, so luaM_free does not need the size.
 */
+
+union BlockHeader {
+	struct {
+		int32 sizeClass;  // LARGE_BLOCK for blocks from malloc
+		int32 size;
+	} b;
+	double align;
+};
+
+enum {
+	NUM_SMALL_CLASSES = 16,  // 16 to 256 bytes, in steps of 16
+	NUM_MEDIUM_CLASSES = 4,  // 320 to 512 bytes, in steps of 64
+	NUM_CLASSES = NUM_SMALL_CLASSES + NUM_MEDIUM_CLASSES + 3,  // then 1024, 2048 and 4096 bytes
+	LARGE_BLOCK = NUM_CLASSES,
+	MAX_POOLED = 4096
+};
+
+struct PoolStats {
+	uint32 allocs;
+	uint32 live;
+	uint32 peak;
+};
+
+static Common::MemoryPool *pools[NUM_CLASSES];
+static PoolStats stats[NUM_CLASSES + 1];  // the last one counts the large blocks
+
+static int32 classsize(int32 c) {
+	if (c < NUM_SMALL_CLASSES)
+		return (c + 1) * 16;
+	if (c < NUM_SMALL_CLASSES + NUM_MEDIUM_CLASSES)
+		return 256 + (c - NUM_SMALL_CLASSES + 1) * 64;
+	return 1024 << (c - NUM_SMALL_CLASSES - NUM_MEDIUM_CLASSES);
+}
+
+static int32 sizeclass(int32 size) {
+	if (size <= 256)
+		return (size - 1) / 16;
+	if (size <= 512)
+		return NUM_SMALL_CLASSES + (size - 257) / 64;
+	if (size <= 1024)
+		return NUM_SMALL_CLASSES + NUM_MEDIUM_CLASSES;
+	if (size <= 2048)
+		return NUM_SMALL_CLASSES + NUM_MEDIUM_CLASSES + 1;
+	return NUM_SMALL_CLASSES + NUM_MEDIUM_CLASSES + 2;
+}
+
+static void countalloc(int32 c) {
+	PoolStats *s = &stats[c];
+	s->allocs++;
+	if (++s->live > s->peak)
+		s->peak = s->live;
+}
+
+static void *allocblock(int32 size) {
+	BlockHeader *h;
+	int32 c;
+	if (size > MAX_POOLED) {
+		c = LARGE_BLOCK;
+		h = (BlockHeader *)malloc(sizeof(BlockHeader) + size);
+		if (!h)
+			lua_error(memEM);
+	} else {
+		c = sizeclass(size);
+		if (!pools[c])
+			pools[c] = new Common::MemoryPool(sizeof(BlockHeader) + classsize(c));
+		h = (BlockHeader *)pools[c]->allocChunk();
+	}
+	h->b.sizeClass = c;
+	h->b.size = size;
+	countalloc(c);
+	return h + 1;
+}
+
+static void freeblock(BlockHeader *h) {
+	int32 c = h->b.sizeClass;
+	stats[c].live--;
+	if (c == LARGE_BLOCK)
+		free(h);
+	else
+		pools[c]->freeChunk(h);
+}
+
 void *luaM_realloc(void *block, int32 size) {
+	BlockHeader *h;
+	void *newblock;
+	if (!block)
+		return size == 0 ? NULL : allocblock(size);
+	h = (BlockHeader *)block - 1;
 	if (size == 0) {
-		free(block);
+		freeblock(h);
 		return NULL;
 	}
-	block = block ? realloc(block, size) : malloc(size);
-	if (!block)
-		lua_error(memEM);
-	return block;
+	if (h->b.sizeClass == LARGE_BLOCK) {
+		if (size > MAX_POOLED) {
+			h = (BlockHeader *)realloc(h, sizeof(BlockHeader) + size);
+			if (!h)
+				lua_error(memEM);
+			h->b.size = size;
+			stats[LARGE_BLOCK].allocs++;
+			return h + 1;
+		}
+	} else if (size <= classsize(h->b.sizeClass)) {
+		h->b.size = size;
+		return block;
+	}
+	newblock = allocblock(size);
+	memcpy(newblock, block, MIN(size, h->b.size));
+	freeblock(h);
+	return newblock;
+}
+
+void luaM_freeunused() {
+	int32 c;
+	for (c = 0; c < NUM_CLASSES; c++) {
+		if (pools[c] && stats[c].live == 0) {
+			delete pools[c];
+			pools[c] = NULL;
+		} else if (pools[c]) {
+			pools[c]->freeUnusedPages();
+		}
+	}
+}
+
+void luaM_printstats() {
+	int32 c;
+	for (c = 0; c < NUM_CLASSES; c++) {
+		if (stats[c].allocs)
+			debug("Lua memory: %4d bytes: %8u allocations, %6u live, %6u peak", classsize(c),
+				  stats[c].allocs, stats[c].live, stats[c].peak);
+	}
+	debug("Lua memory: large: %8u allocations, %6u live, %6u peak", stats[LARGE_BLOCK].allocs,
+		  stats[LARGE_BLOCK].live, stats[LARGE_BLOCK].peak);
 }
 
 #else
@@ -85,6 +210,13 @@ void *luaM_realloc(void *block, int32 size) {
 	return (int32 *)block+1;
 }
 
+void luaM_freeunused() {
+}
+
+void luaM_printstats() {
+	debug("Lua memory: %d blocks, %d bytes", numblocks, totalmem);
+}
+
 #endif
 
 } // end of namespace Grim
@@ -19,13 +19,15 @@ namespace Grim {
 
 void *luaM_realloc (void *oldblock, int32 size);
 int32 luaM_growaux (void **block, int32 nelems, int32 size, const char *errormsg, int32 limit);
+void luaM_freeunused();
+void luaM_printstats();
 
-#define luaM_free(b)						free((b))
-#define luaM_malloc(t)						malloc((t))
-#define luaM_new(t)							((t *)malloc(sizeof(t)))
-#define luaM_newvector(n, t)				((t *)malloc((n) * sizeof(t)))
+#define luaM_free(b)						luaM_realloc((b), 0)
+#define luaM_malloc(t)						luaM_realloc(NULL, (t))
+#define luaM_new(t)							((t *)luaM_malloc(sizeof(t)))
+#define luaM_newvector(n, t)				((t *)luaM_malloc((n) * sizeof(t)))
 #define luaM_growvector(old, n, t, e, l)	(luaM_growaux((void**)old, n, sizeof(t), e, l))
-#define luaM_reallocvector(v, n, t)			((t *)realloc(v,(n) * sizeof(t)))
+#define luaM_reallocvector(v, n, t)			((t *)luaM_realloc(v,(n) * sizeof(t)))
 
 #ifdef LUA_DEBUG
 extern int32 numblocks;
@@ -98,6 +98,7 @@ typedef struct TProtoFunc {
 	int32 lineDefined;
 	TaggedString  *fileName;
 	struct LocVar *locvars;  // ends with line = -1
+	int32 *slots;  // per constant node hints for dotted reads (lazily allocated)
 } TProtoFunc;
 
 typedef struct LocVar {
@@ -325,6 +325,7 @@ void lua_Restore(SaveGame *savedState) {
 		arraysObj->idObj.low = savedState->readLESint32();
 		arraysObj->idObj.hi = savedState->readLESint32();
 		tempProtoFunc = luaM_new(TProtoFunc);
+		tempProtoFunc->slots = NULL;
 		luaO_insertlist(oldProto, (GCnode *)tempProtoFunc);
 		oldProto = (GCnode *)tempProtoFunc;
 		PointerId ptr;
@@ -457,6 +458,7 @@ void lua_Restore(SaveGame *savedState) {
 	} else {
 		IMtable = NULL;
 	}
+	luaT_changed();
 
 	last_tag = savedState->readLESint32();
 	refSize = savedState->readLESint32();
@@ -588,6 +590,7 @@ void lua_Restore(SaveGame *savedState) {
 
 	for (; currentState; currentState--)
 		lua_state = lua_state->next;
+	lua_resettasks();
 
 	arraysAllreadySort = false;
 	arrayStringsCount = 0;
@@ -53,6 +53,7 @@ stringtable *string_root;
 int32 last_tag;
 struct IM *IMtable;
 int32 IMtable_size;
+int32 IMversion;
 
 LState *lua_state = NULL;
 LState *lua_rootState = NULL;
@@ -91,6 +92,10 @@ void lua_stateinit(LState *state) {
 	state->task = NULL;
 	state->some_task = NULL;
 	state->taskFunc.ttype = LUA_T_NIL;
+	state->readyPrev = NULL;
+	state->readyNext = NULL;
+	state->ready = false;
+	state->runFrame = 0;
 
 	state->stack.stack = luaM_newvector(STACK_UNIT, TObject);
 	state->stack.top = state->stack.stack;
@@ -98,6 +103,7 @@ void lua_stateinit(LState *state) {
 }
 
 void lua_statedeinit(LState *state) {
+	lua_unscheduletask(state);
 	if (state->prev)
 		state->prev->next = state->next;
 	if (state->next)
@@ -114,7 +120,7 @@ void lua_statedeinit(LState *state) {
 		}
 	}
 
-	free(state->stack.stack);
+	luaM_free(state->stack.stack);
 }
 
 void lua_resetglobals() {
@@ -211,6 +217,7 @@ void lua_open() {
 }
 
 void lua_close() {
+	luaC_completecycle();
 	TaggedString *alludata = luaS_collectudata();
 	GCthreshold = MAX_INT;  // to avoid GC during GC
 	luaC_hashcallIM((Hash *)roottable.next);  // GC t.methods for tables
@@ -237,11 +244,15 @@ void lua_close() {
 	IMtable = NULL;
 	refArray = NULL;
 	lua_rootState = lua_state = NULL;
+	lua_resettasks();
 
 #ifdef LUA_DEBUG
 	printf("total de blocos: %ld\n", numblocks);
 	printf("total de memoria: %ld\n", totalmem);
 #endif
+	if (gDebugLevel == DEBUG_LUA || gDebugLevel == DEBUG_ALL)
+		luaM_printstats();
+	luaM_freeunused();
 }
 
 bool lua_isopen() {
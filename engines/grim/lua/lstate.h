@@ -71,6 +71,7 @@ extern stringtable *string_root;
 extern int32 last_tag;
 extern struct IM *IMtable;
 extern int32 IMtable_size;
+extern int32 IMversion;  // changed whenever a tag method is set
 
 struct LState {
 	LState *prev; // handle to previous state in list
@@ -90,6 +91,10 @@ struct LState {
 	TObject	taskFunc;
 	struct C_Lua_Stack Cblocks[MAX_C_BLOCKS];
 	int numCblocks; // number of nested Cblocks
+	LState *readyPrev; // handles in the scheduler's list of runnable states
+	LState *readyNext;
+	bool ready; // flag mean if state is in that list
+	uint32 runFrame; // last lua_runtasks call that ran the state
 };
 
 extern LState *lua_state, *lua_rootState;
@@ -8,6 +8,7 @@
 
 #include "common/util.h"
 
+#include "engines/grim/lua/lgc.h"
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lobject.h"
 #include "engines/grim/lua/lstate.h"
@@ -20,6 +21,9 @@ namespace Grim {
 
 TaggedString EMPTY = {{NULL, 2}, 0, 0L, {LUA_T_NIL, {NULL}}, {0}};
 
+// First string table an incremental sweep has not reached yet.
+static int32 sweepstring = NUM_HASHS;
+
 void luaS_init() {
 	int32 i;
 	string_root = luaM_newvector(NUM_HASHS, stringtable);
@@ -91,6 +95,14 @@ static TaggedString *newone(const char *buff, int32 tag, uint32 h) {
 	return ts;
 }
 
+// Strings in a table the sweep has not reached yet are marked, so that
+// it does not free a string that is handed out again or was just created.
+static TaggedString *keep(TaggedString *ts, stringtable *tb) {
+	if (ts->head.marked == 0 && tb - string_root >= sweepstring)
+		ts->head.marked = 1;
+	return ts;
+}
+
 static TaggedString *insert(const char *buff, int32 tag, stringtable *tb) {
 	TaggedString *ts;
 	uint32 h = hash(buff, tag);
@@ -107,7 +119,7 @@ static TaggedString *insert(const char *buff, int32 tag, stringtable *tb) {
 		else if ((ts->constindex >= 0) ? // is a string?
 				(tag == LUA_T_STRING && (strcmp(buff, ts->str) == 0)) :
 				((tag == ts->globalval.ttype || tag == LUA_ANYTAG) && buff == (const char *)ts->globalval.value.ts))
-			return ts;
+			return keep(ts, tb);
 		if (++i == size)
 			i = 0;
 	}
@@ -117,7 +129,7 @@ static TaggedString *insert(const char *buff, int32 tag, stringtable *tb) {
 	else
 		tb->nuse++;
 	ts = tb->hash[i] = newone(buff, tag, h);
-	return ts;
+	return keep(ts, tb);
 }
 
 TaggedString *luaS_createudata(void *udata, int32 tag) {
@@ -138,7 +150,7 @@ TaggedString *luaS_new(const char *str) {
 
 TaggedString *luaS_newfixedstring(const char *str) {
 	TaggedString *ts = luaS_new(str);
-	if (ts->head.marked == 0)
+	if (ts->head.marked <= 1)
 		ts->head.marked = 2;  // avoid GC
 	return ts;
 }
@@ -159,35 +171,57 @@ void luaS_free(TaggedString *l) {
 static void remove_from_list(GCnode *l) {
 	while (l) {
 		GCnode *next = l->next;
-		while (next && !next->marked)
-			next = l->next = next->next;
+		while (next && !next->marked) {
+			l->next = next->next;
+			next->next = next;  // signal it is in no list
+			next = l->next;
+		}
 		l = next;
 	}
 }
 
+static TaggedString *collecttable(stringtable *tb, TaggedString *frees) {
+	int32 j;
+	for (j = 0; j < tb->size; j++) {
+		TaggedString *t = tb->hash[j];
+		if (!t)
+			continue;
+		if (t->head.marked == 1)
+			t->head.marked = 0;
+		else if (!t->head.marked) {
+			t->head.next = (GCnode *)frees;
+			frees = t;
+			tb->hash[j] = &EMPTY;
+		}
+	}
+	return frees;
+}
+
 TaggedString *luaS_collector() {
 	TaggedString *frees = NULL;
 	int32 i;
 	remove_from_list(&rootglobal);
-	for (i = 0; i < NUM_HASHS; i++) {
-		stringtable *tb = &string_root[i];
-		int32 j;
-		for (j = 0; j < tb->size; j++) {
-			TaggedString *t = tb->hash[j];
-			if (!t)
-				continue;
-			if (t->head.marked == 1)
-				t->head.marked = 0;
-			else if (!t->head.marked) {
-				t->head.next = (GCnode *)frees;
-				frees = t;
-				tb->hash[j] = &EMPTY;
-			}
-		}
-	}
+	for (i = 0; i < NUM_HASHS; i++)
+		frees = collecttable(&string_root[i], frees);
 	return frees;
 }
 
+void luaS_beginsweep() {
+	remove_from_list(&rootglobal);
+	sweepstring = 0;
+}
+
+// Sweeps the next string table of an incremental collection and returns
+// its size, or -1 once all of them are swept.
+int32 luaS_sweepstep(TaggedString **frees) {
+	stringtable *tb;
+	if (sweepstring == NUM_HASHS)
+		return -1;
+	tb = &string_root[sweepstring++];
+	*frees = collecttable(tb, *frees);
+	return tb->size + 1;
+}
+
 TaggedString *luaS_collectudata() {
 	TaggedString *frees = NULL;
 	int32 i;
@@ -225,6 +259,7 @@ void luaS_freeall() {
 
 void luaS_rawsetglobal(TaggedString *ts, TObject *newval) {
 	ts->globalval = *newval;
+	luaC_globalbarrier(ts);
 	if (ts->head.next == (GCnode *)ts) {  // is not in list?
 		ts->head.next = rootglobal.next;
 		rootglobal.next = (GCnode *)ts;
@@ -14,6 +14,8 @@ namespace Grim {
 void luaS_init();
 TaggedString *luaS_createudata(void *udata, int32 tag);
 TaggedString *luaS_collector();
+void luaS_beginsweep();
+int32 luaS_sweepstep(TaggedString **frees);
 void luaS_free (TaggedString *l);
 TaggedString *luaS_new(const char *str);
 TaggedString *luaS_newfixedstring (const char *str);
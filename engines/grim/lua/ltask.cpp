@@ -12,6 +12,7 @@
 #include "engines/grim/lua/ldo.h"
 #include "engines/grim/lua/lvm.h"
 
+#include "common/hashmap.h"
 #include "common/textconsole.h"
 
 namespace Grim {
@@ -32,6 +33,90 @@ void lua_taskresume(lua_Task *task, Closure *closure, TProtoFunc *protofunc, Stk
 	task->S = &lua_state->stack;
 }
 
+/*
+** Scheduler
+** The states of the scripts form a list in start order. The ones that are
+** not paused are also linked in a ready list, in the same order, and
+** lua_runtasks only walks that one. Task ids are looked up in a hash.
+*/
+
+static LState *readyHead = NULL;
+static Common::HashMap<uint32, LState *> *taskIds = NULL;
+static uint32 taskFrame = 0;
+
+static void readyinsert(LState *state) {
+	// keep the start order: go after the closest ready state before this one
+	LState *p = state->prev;
+	while (p && !p->ready)
+		p = p->prev;
+	state->readyPrev = p;
+	state->readyNext = p ? p->readyNext : readyHead;
+	if (state->readyNext)
+		state->readyNext->readyPrev = state;
+	if (p)
+		p->readyNext = state;
+	else
+		readyHead = state;
+	state->ready = true;
+	// a paused state resumed by a script that runs later gets its turn in this frame still
+	if (state->runFrame != taskFrame)
+		state->updated = false;
+}
+
+static void readyremove(LState *state) {
+	if (state->readyPrev)
+		state->readyPrev->readyNext = state->readyNext;
+	else
+		readyHead = state->readyNext;
+	if (state->readyNext)
+		state->readyNext->readyPrev = state->readyPrev;
+	state->readyPrev = NULL;
+	state->readyNext = NULL;
+	state->ready = false;
+}
+
+static void reschedule(LState *state) {
+	if (!state->paused && !state->ready)
+		readyinsert(state);
+	else if (state->paused && state->ready)
+		readyremove(state);
+}
+
+static LState *findstate(uint32 id) {
+	if (!taskIds)
+		return NULL;
+	Common::HashMap<uint32, LState *>::iterator i = taskIds->find(id);
+	return i != taskIds->end() ? i->_value : NULL;
+}
+
+void lua_scheduletask(LState *state) {
+	if (!taskIds)
+		taskIds = new Common::HashMap<uint32, LState *>();
+	(*taskIds)[state->id] = state;
+	reschedule(state);
+}
+
+void lua_unscheduletask(LState *state) {
+	if (findstate(state->id) == state)
+		taskIds->erase(state->id);
+	if (state->ready)
+		readyremove(state);
+}
+
+// Rebuilds the scheduler from the list of states, after it was restored.
+void lua_resettasks() {
+	LState *state;
+	readyHead = NULL;
+	delete taskIds;
+	taskIds = NULL;
+	if (!lua_rootState)
+		return;
+	for (state = lua_rootState->next; state != NULL; state = state->next) {
+		state->ready = false;
+		lua_scheduletask(state);
+	}
+}
+
 void start_script() {
 	lua_Object paramObj = lua_getparam(1);
 	lua_Type type = ttype(Address(paramObj));
@@ -55,6 +140,7 @@ void start_script() {
 	if (state->next)
 		state->next->prev = state;
 	lua_state->next = state;
+	lua_scheduletask(state);
 
 	state->taskFunc.ttype = type;
 	state->taskFunc.value = Address(paramObj)->value;
@@ -84,17 +170,15 @@ void next_script() {
 
 	if (type == LUA_T_TASK) {
 		uint32 task = (uint32)nvalue(Address(paramObj));
-		LState *state;
-		for (state = lua_rootState->next; state != NULL; state = state->next) {
-			if (state->id == task) {
-				if (state->next) {
-					ttype(lua_state->stack.top) = LUA_T_TASK;
-					nvalue(lua_state->stack.top) = (float)state->next->id;
-					incr_top;
-				} else
-					lua_pushnil();
-				return;
-			}
+		LState *state = findstate(task);
+		if (state) {
+			if (state->next) {
+				ttype(lua_state->stack.top) = LUA_T_TASK;
+				nvalue(lua_state->stack.top) = (float)state->next->id;
+				incr_top;
+			} else
+				lua_pushnil();
+			return;
 		}
 	}
 
@@ -116,10 +200,7 @@ void stop_script() {
 
 	if (type == LUA_T_TASK) {
 		uint32 task = (uint32)nvalue(Address(paramObj));
-		for (state = lua_rootState->next; state != NULL; state = state->next) {
-			if (state->id == task)
-				break;
-		}
+		state = findstate(task);
 		if (state) {
 			if (state != lua_state) {
 				lua_statedeinit(state);
@@ -154,12 +235,10 @@ void identify_script() {
 		lua_error("Bad argument to identify_script");
 
 	uint32 task = (uint32)nvalue(Address(paramObj));
-	LState *state;
-	for (state = lua_rootState->next; state != NULL; state = state->next) {
-		if (state->id == task) {
-			luaA_pushobject(&state->taskFunc);
-			return;
-		}
+	LState *state = findstate(task);
+	if (state) {
+		luaA_pushobject(&state->taskFunc);
+		return;
 	}
 
 	lua_pushnil();
@@ -174,13 +253,10 @@ void find_script() {
 
 	if (type == LUA_T_TASK) {
 		uint32 task = (uint32)nvalue(Address(paramObj));
-		LState *state;
-		for (state = lua_rootState->next; state != NULL; state = state->next) {
-			if (state->id == task) {
-				lua_pushobject(paramObj);
-				lua_pushnumber(1.0f);
-				return;
-			}
+		if (findstate(task)) {
+			lua_pushobject(paramObj);
+			lua_pushnumber(1.0f);
+			return;
 		}
 	} else if (type == LUA_T_PROTO || type == LUA_T_CPROTO) {
 		int task = -1, countTasks = 0;
@@ -215,8 +291,10 @@ void pause_scripts() {
 	LState *t;
 
 	for (t = lua_rootState->next; t != NULL; t = t->next) {
-		if (lua_state != t)
+		if (lua_state != t) {
 			t->paused = true;
+			reschedule(t);
+		}
 	}
 }
 
@@ -224,8 +302,10 @@ void unpause_scripts() {
 	LState *t;
 
 	for (t = lua_rootState->next; t != NULL; t = t->next) {
-		if (lua_state != t)
+		if (lua_state != t) {
 			t->paused = false;
+			reschedule(t);
+		}
 	}
 }
 
@@ -238,15 +318,20 @@ void current_script() {
 void break_here() {}
 
 void lua_runtasks() {
-	if (!lua_state || !lua_state->next) {
+	if (!lua_state) {
+		return;
+	}
+
+	taskFrame++;
+	if (!readyHead) {
 		return;
 	}
 
-	// Mark all the states to be updated
-	LState *state = lua_state->next;
+	// Mark the runnable states to be updated
+	LState *state = readyHead;
 	do {
 		state->updated = false;
-		state = state->next;
+		state = state->readyNext;
 	} while	(state);
 
 	// And run them
@@ -254,11 +339,11 @@ void lua_runtasks() {
 }
 
 void runtasks(LState *const rootState) {
-	lua_state = lua_state->next;
+	lua_state = readyHead;
 	while (lua_state) {
 		LState *nextState = NULL;
 		bool stillRunning;
-		if (!lua_state->updated && !lua_state->paused) {
+		if (!lua_state->updated) {
 			jmp_buf	errorJmp;
 			lua_state->errorJmp = &errorJmp;
 			if (setjmp(errorJmp)) {
@@ -280,31 +365,32 @@ void runtasks(LState *const rootState) {
 					stillRunning = luaD_call(base + 1, 255);
 				}
 			}
-			nextState = lua_state->next;
+			nextState = lua_state->readyNext;
 			// The state returned. Delete it
 			if (!stillRunning) {
 				lua_statedeinit(lua_state);
 				luaM_free(lua_state);
 			} else {
 				lua_state->updated = true;
+				lua_state->runFrame = taskFrame;
 			}
 		} else {
-			nextState = lua_state->next;
+			nextState = lua_state->readyNext;
 		}
 		lua_state = nextState;
 	}
 
 	// Restore the value of lua_state to the main script
 	lua_state = rootState;
-	// Check for states that may have been created in this run.
-	LState *state = lua_state->next;
+	// Check for states that may have been unpaused before the current one in this run.
+	LState *state = readyHead;
 	while (state) {
-		if (!state->paused && !state->updated) {
+		if (!state->updated) {
 			// New state! Run a new pass.
 			runtasks(rootState);
 			return;
 		}
-		state = state->next;
+		state = state->readyNext;
 	}
 }
 
@@ -34,6 +34,9 @@ void find_script();
 void break_here();
 
 void runtasks(LState *const rootState);
+void lua_scheduletask(LState *state);
+void lua_unscheduletask(LState *state);
+void lua_resettasks();
 
 } // end of namespace Grim
 
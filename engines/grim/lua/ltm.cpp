@@ -61,6 +61,7 @@ void luaT_init() {
 	IMtable = luaM_newvector(IMtable_size, struct IM);
 	for (t = -(IMtable_size - 1); t <= 0; t++)
 		init_entry(t);
+	luaT_changed();
 }
 
 int32 lua_newtag() {
@@ -89,6 +90,7 @@ int32 lua_copytagmethods(int32 tagto, int32 tagfrom) {
 		if (validevent(tagto, e))
 			*luaT_getim(tagto, e) = *luaT_getim(tagfrom, e);
 	}
+	luaT_changed();
 	return tagto;
 }
 
@@ -116,6 +118,30 @@ int32 luaT_efectivetag(TObject *o) {
 	}
 }
 
+/*
+** Returns whether any tag has a method for "event". The answer is
+** kept until the next change of the tag methods, so the VM can skip the
+** per access checks of events that no script uses.
+*/
+int32 luaT_hasim(IMS event) {
+	static int32 checked = -1;
+	static char hasim[IM_N];
+	if (checked != IMversion) {
+		int32 e, t;
+		for (e = 0; e < IM_N; e++) {
+			hasim[e] = 0;
+			for (t = 0; t >= last_tag; t--) {
+				if (ttype(luaT_getim(t, e)) != LUA_T_NIL) {
+					hasim[e] = 1;
+					break;
+				}
+			}
+		}
+		checked = IMversion;
+	}
+	return hasim[event];
+}
+
 TObject *luaT_gettagmethod(int32 t, const char *event) {
 	int32 e = luaI_checkevent(event, luaT_eventname);
 	checktag(t);
@@ -134,6 +160,7 @@ void luaT_settagmethod(int32 t, const char *event, TObject *func) {
 		luaT_eventname[e], t);
 	*func = *luaT_getim(t,e);
 	*luaT_getim(t, e) = temp;
+	luaT_changed();
 }
 
 const char *luaT_travtagmethods(int32 (*fn)(TObject *)) {
@@ -237,6 +264,7 @@ void luaT_setfallback() {
 			}
 		}
 	}
+	luaT_changed();
 	if (oldfunc.ttype != LUA_T_NIL)
 		luaA_pushobject(&oldfunc);
 	else
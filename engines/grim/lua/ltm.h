@@ -47,12 +47,14 @@ struct IM {
 
 #define luaT_getim(tag, event)	(&IMtable[-(tag)].int_method[event])
 #define luaT_getimbyObj(o, e)	(luaT_getim(luaT_efectivetag(o), (e)))
+#define luaT_changed()			(IMversion++)
 
 extern const char *luaT_eventname[];
 
 void luaT_init();
 void luaT_realtag(int32 tag);
 int32 luaT_efectivetag(TObject *o);
+int32 luaT_hasim(IMS event);
 void luaT_settagmethod(int32 t, const char *event, TObject *func);
 TObject *luaT_gettagmethod(int32 t, const char *event);
 const char *luaT_travtagmethods(int32 (*fn)(TObject *));
@@ -113,6 +113,45 @@ void luaV_gettable() {
 		lua_error("indexed expression not a table");
 }
 
+/*
+** Indexes the table at top-1 with the constant "key" of a GETDOTTED or
+** PUSHSELF. "slot" remembers the node where the key was last found;
+** it is only trusted while that node still holds the same key, which
+** stays true across tables built the same way and fails once a rehash
+** or a different layout moves the key.
+*/
+static void getdotted(TObject *key, int32 *slot) {
+	Stack *S = &lua_state->stack;
+	TObject *t = S->top - 1;
+	if (ttype(t) == LUA_T_ARRAY && ttype(key) == LUA_T_STRING &&
+			ttype(luaT_getim(avalue(t)->htag, IM_GETTABLE)) == LUA_T_NIL) {
+		Hash *h = avalue(t);
+		Node *n;
+		if ((uint32)*slot >= (uint32)nhash(h) || ttype(ref(n = node(h, *slot))) != LUA_T_STRING ||
+				tsvalue(ref(n)) != tsvalue(key)) {
+			*slot = present(h, key);
+			n = node(h, *slot);
+		}
+		if (ttype(ref(n)) != LUA_T_NIL && ttype(val(n)) != LUA_T_NIL) {
+			*t = *val(n);
+			return;
+		}
+		// not present, let luaV_gettable look for an "index" method
+	}
+	*S->top++ = *key;
+	luaV_gettable();
+}
+
+static int32 *protoslots(TProtoFunc *tf) {
+	if (!tf->slots) {
+		int32 i;
+		tf->slots = luaM_newvector(tf->nconsts, int32);
+		for (i = 0; i < tf->nconsts; i++)
+			tf->slots[i] = -1;
+	}
+	return tf->slots;
+}
+
 /*
 ** Function to store indexed based on values at the stack.top
 ** mode = 0: raw store (without tag methods)
@@ -311,7 +350,10 @@ pushlocal:
 		case GETGLOBAL7:
 			task->aux -= GETGLOBAL0;
 getglobal:
-			luaV_getglobal(tsvalue(&task->consts[task->aux]));
+			if (!luaT_hasim(IM_GETGLOBAL))
+				*task->S->top++ = tsvalue(&task->consts[task->aux])->globalval;
+			else
+				luaV_getglobal(tsvalue(&task->consts[task->aux]));
 			break;
 		case GETTABLE:
 			luaV_gettable();
@@ -331,8 +373,7 @@ getglobal:
 		case GETDOTTED7:
 			task->aux -= GETDOTTED0;
 getdotted:
-			*task->S->top++ = task->consts[task->aux];
-			luaV_gettable();
+			getdotted(&task->consts[task->aux], &protoslots(task->tf)[task->aux]);
 			break;
 		case PUSHSELFW:
 			task->aux = next_word(task->pc);
@@ -352,8 +393,7 @@ getdotted:
 pushself:
 			{
 				TObject receiver = *(task->S->top - 1);
-				*task->S->top++ = task->consts[task->aux];
-				luaV_gettable();
+				getdotted(&task->consts[task->aux], &protoslots(task->tf)[task->aux]);
 				*task->S->top++ = receiver;
 				break;
 			}
@@ -414,7 +454,10 @@ setlocal:
 		case SETGLOBAL7:
 			task->aux -= SETGLOBAL0;
 setglobal:
-			luaV_setglobal(tsvalue(&task->consts[task->aux]));
+			if (!luaT_hasim(IM_SETGLOBAL))
+				luaS_rawsetglobal(tsvalue(&task->consts[task->aux]), --task->S->top);
+			else
+				luaV_setglobal(tsvalue(&task->consts[task->aux]));
 			break;
 		case SETTABLE0:
 			luaV_settable(task->S->top - 3, 1);
@@ -32,6 +32,7 @@
 #include "engines/grim/lipsync.h"
 #include "engines/grim/savegame.h"
 #include "engines/grim/colormap.h"
+#include "engines/grim/gfx_base.h"
 #include "engines/grim/resource.h"
 #include "engines/grim/inputdialog.h"
 
@@ -554,6 +555,7 @@ void L1_InputDialog() {
 	str += lua_getstring(messageObj);
 	InputDialog d(str, lua_getstring(defaultObj));
 	int res = d.runModal();
+	g_driver->invalidateScreen();
 	// The KeyUp event for CTRL has been eat by the gui loop, so we
 	// need to reset it manually.
 	g_grim->clearEventQueue();
@@ -132,20 +132,43 @@ MaterialData::~MaterialData() {
 	delete[] _textures;
 }
 
-MaterialData *MaterialData::getMaterialData(const Common::String &filename, const char *data, int len, CMap *cmap) {
-	if (!_materials) {
-		_materials = new Common::List<MaterialData *>();
+bool MaterialData::setColormap(CMap *cmap) {
+	if (g_grim->getGameType() == GType_MONKEY4)
+		return false;
+
+	for (int i = 0; i < _numImages; ++i) {
+		Texture *t = _textures + i;
+		if (t->_width && t->_height && !g_driver->setMaterialColormap(t, cmap))
+			return false;
 	}
+	_cmap = cmap;
+	return true;
+}
+
+MaterialData *MaterialData::findMaterialData(const Common::String &filename, CMap *cmap) {
+	if (!_materials)
+		return NULL;
 
 	for (Common::List<MaterialData *>::iterator i = _materials->begin(); i != _materials->end(); ++i) {
 		MaterialData *m = *i;
-		if (m->_fname == filename && m->_cmap->getFilename() == cmap->getFilename()) {
-			++m->_refCount;
+		if (m->_fname == filename && m->_cmap->getFilename() == cmap->getFilename())
 			return m;
-		}
 	}
+	return NULL;
+}
 
-	MaterialData *m = new MaterialData(filename, data, len, cmap);
+MaterialData *MaterialData::getMaterialData(const Common::String &filename, const char *data, int len, CMap *cmap) {
+	if (!_materials) {
+		_materials = new Common::List<MaterialData *>();
+	}
+
+	MaterialData *m = findMaterialData(filename, cmap);
+	if (m) {
+		++m->_refCount;
+		return m;
+	}
+
+	m = new MaterialData(filename, data, len, cmap);
 	_materials->push_back(m);
 	return m;
 }
@@ -157,6 +180,11 @@ Material::Material(const Common::String &filename, const char *data, int len, CM
 
 void Material::reload(CMap *cmap) {
 	Common::String fname = _data->_fname;
+	// When nobody else uses the data and the colormap isn't loaded for
+	// this material yet, the renderer may just swap the palette.
+	if (_data->_refCount == 1 && !MaterialData::findMaterialData(fname, cmap) && _data->setColormap(cmap))
+		return;
+
 	--_data->_refCount;
 	if (_data->_refCount < 1) {
 		delete _data;
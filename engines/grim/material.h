@@ -42,10 +42,14 @@ public:
 	~MaterialData();
 
 	static MaterialData *getMaterialData(const Common::String &filename, const char *data, int len, CMap *cmap);
+	static MaterialData *findMaterialData(const Common::String &filename, CMap *cmap);
 	static Common::List<MaterialData *> *_materials;
 
+	// Switch the textures to another colormap, if the renderer can
+	bool setColormap(CMap *cmap);
+
 	Common::String _fname;
-	const ObjectPtr<CMap> _cmap;
+	ObjectPtr<CMap> _cmap;
 	int _numImages;
 	Texture *_textures;
 	int _refCount;
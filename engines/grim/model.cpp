@@ -21,6 +21,7 @@
  */
 
 #include "common/endian.h"
+#include "common/hashmap.h"
 
 #include "engines/grim/debug.h"
 #include "engines/grim/grim.h"
@@ -260,6 +261,7 @@ ModelNode *Model::copyHierarchy() {
 			result[i]._child = &result[(_rootHierNode[i]._child - _rootHierNode)];
 		if (result[i]._sibling)
 			result[i]._sibling = &result[(_rootHierNode[i]._sibling - _rootHierNode)];
+		result[i]._skeleton = NULL;
 	}
 	return result;
 }
@@ -287,7 +289,9 @@ void Model::loadMaterial(int index, CMap *cmap) {
 		}
 	}
 	if (!_materials[index]) {
-		if (mat && cmap->getFilename() == _cmap->getFilename()) {
+		if (mat) {
+			if (cmap->getFilename() != _cmap->getFilename())
+				mat->reload(cmap);
 			_materials[index] = mat;
 		} else {
 			_materials[index] = g_resourceloader->loadMaterial(_materialNames[index], cmap);
@@ -347,6 +351,7 @@ void Model::Geoset::changeMaterials(Material *materials[]) {
 MeshFace::~MeshFace() {
 	delete[] _vertices;
 	delete[] _texVertices;
+	delete[] _arrayIndices;
 }
 
 int MeshFace::loadBinary(const char *&data, Material *materials[]) {
@@ -404,6 +409,9 @@ Mesh::~Mesh() {
 	delete[] _textureVerts;
 	delete[] _faces;
 	delete[] _materialid;
+	delete[] _arrayVertices;
+	delete[] _arrayNormals;
+	delete[] _arrayTextureVerts;
 }
 
 void Mesh::loadBinary(const char *&data, Material *materials[]) {
@@ -443,6 +451,8 @@ void Mesh::loadBinary(const char *&data, Material *materials[]) {
 	_shadow = READ_LE_UINT32(data);
 	_radius = get_float(data + 8);
 	data += 36;
+
+	buildArrays();
 }
 
 void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
@@ -538,6 +548,52 @@ void Mesh::loadText(TextSplitter *ts, Material* materials[]) {
 		ts->scanString(" %d: %f %f %f", 4, &num, &x, &y, &z);
 		_faces[num]._normal = Math::Vector3d(x, y, z);
 	}
+
+	buildArrays();
+}
+
+void Mesh::buildArrays() {
+	typedef Common::HashMap<uint32, int> ArrayVertMap;
+	ArrayVertMap arrayVerts;
+
+	int maxVerts = 0;
+	for (int i = 0; i < _numFaces; i++)
+		maxVerts += _faces[i]._numVertices;
+
+	_arrayVertices = new float[3 * maxVerts];
+	_arrayNormals = new float[3 * maxVerts];
+	_arrayTextureVerts = new float[2 * maxVerts];
+	_numArrayVerts = 0;
+
+	for (int i = 0; i < _numFaces; i++) {
+		MeshFace *face = &_faces[i];
+		face->_arrayIndices = new int[face->_numVertices];
+		for (int j = 0; j < face->_numVertices; j++) {
+			int vert = face->_vertices[j];
+			int texVert = face->_texVertices ? face->_texVertices[j] : -1;
+			uint32 key = vert * (_numTextureVerts + 1) + texVert + 1;
+
+			ArrayVertMap::iterator it = arrayVerts.find(key);
+			if (it != arrayVerts.end()) {
+				face->_arrayIndices[j] = it->_value;
+				continue;
+			}
+
+			int index = _numArrayVerts++;
+			memcpy(_arrayVertices + 3 * index, _vertices + 3 * vert, 3 * sizeof(float));
+			memcpy(_arrayNormals + 3 * index, _vertNormals + 3 * vert, 3 * sizeof(float));
+			if (texVert >= 0) {
+				memcpy(_arrayTextureVerts + 2 * index, _textureVerts + 2 * texVert, 2 * sizeof(float));
+			} else {
+				// Never read: such faces are drawn with the texture coordinate
+				// array disabled.
+				_arrayTextureVerts[2 * index] = 0.f;
+				_arrayTextureVerts[2 * index + 1] = 0.f;
+			}
+			arrayVerts[key] = index;
+			face->_arrayIndices[j] = index;
+		}
+	}
 }
 
 void Mesh::update() {
@@ -563,13 +619,219 @@ void Mesh::draw(int *x1, int *y1, int *x2, int *y2) const {
 	if (_lightingMode == 0)
 		g_driver->disableLights();
 
-	for (int i = 0; i < _numFaces; i++)
-		_faces[i].draw(_vertices, _vertNormals, _textureVerts);
+	g_driver->drawMesh(this);
 
 	if (_lightingMode == 0)
 		g_driver->enableLights();
 }
 
+/**
+ * @class ModelSkeleton
+ *
+ * The nodes below a ModelNode flattened in depth first order, so that every
+ * parent comes before its children and is referenced by index. The local
+ * transforms are kept as separate arrays of quaternion and translation
+ * components and the matrices of all the nodes are evaluated with linear
+ * passes over them, instead of walking the tree and multiplying a 4x4 matrix
+ * per node.
+ */
+class ModelSkeleton {
+public:
+	ModelSkeleton(ModelNode *root);
+
+	void update(const Math::Matrix4 &parentMatrix);
+
+private:
+	void addNode(ModelNode *node, int parent);
+
+	Common::Array<ModelNode *> _nodes;
+	Common::Array<int> _parents;
+	// Local rotation quaternion and translation of every node, turned in
+	// place into the transform relative to the parent matrix of the root
+	Common::Array<float> _qx, _qy, _qz, _qw;
+	Common::Array<float> _tx, _ty, _tz;
+
+	// The inputs and results of the last update. Idle costumes update with
+	// the same inputs every frame, so the matrices are copied back then.
+	bool _valid;
+	Math::Matrix4 _parentMatrix;
+	Common::Array<float> _posX, _posY, _posZ;
+	Common::Array<float> _pitch, _yaw, _roll;
+	Common::Array<Math::Matrix4> _matrices, _pivotMatrices;
+};
+
+ModelSkeleton::ModelSkeleton(ModelNode *root) : _valid(false) {
+	addNode(root, -1);
+
+	uint num = _nodes.size();
+	_posX.resize(num);
+	_posY.resize(num);
+	_posZ.resize(num);
+	_pitch.resize(num);
+	_yaw.resize(num);
+	_roll.resize(num);
+	_matrices.resize(num);
+	_pivotMatrices.resize(num);
+	_qx.resize(num);
+	_qy.resize(num);
+	_qz.resize(num);
+	_qw.resize(num);
+	_tx.resize(num);
+	_ty.resize(num);
+	_tz.resize(num);
+}
+
+void ModelSkeleton::addNode(ModelNode *node, int parent) {
+	// Like the recursive update this replaces, stop at uninitialized nodes
+	if (!node->_initialized)
+		return;
+
+	int index = _nodes.size();
+	_nodes.push_back(node);
+	_parents.push_back(parent);
+	for (ModelNode *child = node->_child; child; child = child->_sibling)
+		addNode(child, index);
+}
+
+void ModelSkeleton::update(const Math::Matrix4 &parentMatrix) {
+	uint num = _nodes.size();
+	if (num == 0)
+		return;
+
+	// The parent matrix is usually the one of the root, which gets overwritten
+	const Math::Matrix4 matrix(parentMatrix);
+
+	// Only compare once the previous inputs have been stored
+	bool same = _valid;
+	for (int row = 0; row < 4 && same; row++) {
+		for (int col = 0; col < 4 && same; col++)
+			same = matrix(row, col) == _parentMatrix(row, col);
+	}
+	_parentMatrix = matrix;
+
+	float *posX = &_posX[0], *posY = &_posY[0], *posZ = &_posZ[0];
+	float *pitchD = &_pitch[0], *yawD = &_yaw[0], *rollD = &_roll[0];
+	for (uint i = 0; i < num; i++) {
+		const ModelNode *node = _nodes[i];
+		float x = node->_pos.x() + node->_animPos.x();
+		float y = node->_pos.y() + node->_animPos.y();
+		float z = node->_pos.z() + node->_animPos.z();
+		float pitch = (node->_pitch + node->_animPitch).getDegrees();
+		float yaw = (node->_yaw + node->_animYaw).getDegrees();
+		float roll = (node->_roll + node->_animRoll).getDegrees();
+		if (!_valid || x != posX[i] || y != posY[i] || z != posZ[i] ||
+			pitch != pitchD[i] || yaw != yawD[i] || roll != rollD[i]) {
+			same = false;
+			posX[i] = x;
+			posY[i] = y;
+			posZ[i] = z;
+			pitchD[i] = pitch;
+			yawD[i] = yaw;
+			rollD[i] = roll;
+		}
+	}
+	_valid = true;
+
+	if (same) {
+		// Other skeletons and setMatrix() may have written the node and
+		// mesh matrices since, so restore them
+		for (uint i = 0; i < num; i++) {
+			ModelNode *node = _nodes[i];
+			node->_matrix = _matrices[i];
+			node->_pivotMatrix = _pivotMatrices[i];
+			if (node->_mesh)
+				node->_mesh->_matrix = _pivotMatrices[i];
+		}
+		return;
+	}
+
+	float *qx = &_qx[0], *qy = &_qy[0], *qz = &_qz[0], *qw = &_qw[0];
+	float *tx = &_tx[0], *ty = &_ty[0], *tz = &_tz[0];
+
+	// The local matrix of a node is built with setPosition() followed by
+	// buildFromPitchYawRoll(), so its rotation is yaw * pitch * roll and its
+	// translation row is the position multiplied by pitch * roll.
+	for (uint i = 0; i < num; i++) {
+		float yaw = Math::degreeToRadian(yawD[i]) * 0.5f;
+		float pitch = Math::degreeToRadian(pitchD[i]) * 0.5f;
+		float roll = Math::degreeToRadian(rollD[i]) * 0.5f;
+		float cosY = cos(yaw), sinY = sin(yaw);
+		float cosP = cos(pitch), sinP = sin(pitch);
+		float cosR = cos(roll), sinR = sin(roll);
+
+		// pitch * roll
+		float ax = cosP * sinR, ay = sinP * cosR, az = -sinP * sinR, aw = cosP * cosR;
+
+		// The position rotated by the conjugate of pitch * roll
+		float px = posX[i], py = posY[i], pz = posZ[i];
+		float cx = 2.f * (py * az - pz * ay);
+		float cy = 2.f * (pz * ax - px * az);
+		float cz = 2.f * (px * ay - py * ax);
+		tx[i] = px + aw * cx + (cy * az - cz * ay);
+		ty[i] = py + aw * cy + (cz * ax - cx * az);
+		tz[i] = pz + aw * cz + (cx * ay - cy * ax);
+
+		// yaw * pitch * roll
+		qx[i] = cosY * ax - sinY * ay;
+		qy[i] = cosY * ay + sinY * ax;
+		qz[i] = cosY * az + sinY * aw;
+		qw[i] = cosY * aw - sinY * az;
+	}
+
+	// Concatenate every node with its parent, which comes before it
+	for (uint i = 1; i < num; i++) {
+		int p = _parents[i];
+		float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+		float px = qx[p], py = qy[p], pz = qz[p], pw = qw[p];
+		qx[i] = w * px + x * pw + y * pz - z * py;
+		qy[i] = w * py + y * pw + z * px - x * pz;
+		qz[i] = w * pz + z * pw + x * py - y * px;
+		qw[i] = w * pw - x * px - y * py - z * pz;
+
+		// The translation rotated by the conjugate of the parent rotation
+		float cx = 2.f * (ty[i] * pz - tz[i] * py);
+		float cy = 2.f * (tz[i] * px - tx[i] * pz);
+		float cz = 2.f * (tx[i] * py - ty[i] * px);
+		float t0 = tx[i] + pw * cx + (cy * pz - cz * py);
+		float t1 = ty[i] + pw * cy + (cz * px - cx * pz);
+		float t2 = tz[i] + pw * cz + (cx * py - cy * px);
+		tx[i] = t0 + tx[p];
+		ty[i] = t1 + ty[p];
+		tz[i] = t2 + tz[p];
+	}
+
+	// Apply the parent matrix of the root and store the results
+	for (uint i = 0; i < num; i++) {
+		float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+		float r[3][3];
+		r[0][0] = 1.f - 2.f * (y * y + z * z);
+		r[0][1] = 2.f * (x * y - z * w);
+		r[0][2] = 2.f * (x * z + y * w);
+		r[1][0] = 2.f * (x * y + z * w);
+		r[1][1] = 1.f - 2.f * (x * x + z * z);
+		r[1][2] = 2.f * (y * z - x * w);
+		r[2][0] = 2.f * (x * z - y * w);
+		r[2][1] = 2.f * (y * z + x * w);
+		r[2][2] = 1.f - 2.f * (x * x + y * y);
+		const float t[3] = { tx[i], ty[i], tz[i] };
+
+		ModelNode *node = _nodes[i];
+		Math::Matrix4 &m = node->_matrix;
+		for (int col = 0; col < 4; col++) {
+			for (int row = 0; row < 3; row++)
+				m(row, col) = r[row][0] * matrix(0, col) + r[row][1] * matrix(1, col) + r[row][2] * matrix(2, col);
+			m(3, col) = t[0] * matrix(0, col) + t[1] * matrix(1, col) + t[2] * matrix(2, col) + matrix(3, col);
+		}
+
+		node->_pivotMatrix = m;
+		node->_pivotMatrix.translate(node->_pivot);
+		if (node->_mesh)
+			node->_mesh->_matrix = node->_pivotMatrix;
+		_matrices[i] = m;
+		_pivotMatrices[i] = node->_pivotMatrix;
+	}
+}
+
 /**
  * @class ModelNode
  */
@@ -579,6 +841,7 @@ ModelNode::~ModelNode() {
 		child->_parent = NULL;
 		child = child->_sibling;
 	}
+	delete _skeleton;
 }
 
 void ModelNode::loadBinary(const char *&data, ModelNode *hierNodes, const Model::Geoset *g) {
@@ -639,6 +902,7 @@ void ModelNode::addChild(ModelNode *child) {
 		childPos = &(*childPos)->_sibling;
 	*childPos = child;
 	child->_parent = this;
+	invalidateSkeleton();
 }
 
 void ModelNode::removeChild(ModelNode *child) {
@@ -648,10 +912,18 @@ void ModelNode::removeChild(ModelNode *child) {
 	if (*childPos) {
 		*childPos = child->_sibling;
 		child->_parent = NULL;
+		invalidateSkeleton();
+	}
+}
+
+void ModelNode::invalidateSkeleton() {
+	for (ModelNode *node = this; node; node = node->_parent) {
+		delete node->_skeleton;
+		node->_skeleton = NULL;
 	}
 }
 
-void ModelNode::setMatrix(Math::Matrix4 matrix) {
+void ModelNode::setMatrix(const Math::Matrix4 &matrix) {
 	_matrix = matrix;
 }
 
@@ -659,31 +931,9 @@ void ModelNode::update() {
 	if (!_initialized)
 		return;
 
-	Math::Vector3d animPos = _pos + _animPos;
-	Math::Angle animPitch = _pitch + _animPitch;
-	Math::Angle animYaw = _yaw + _animYaw;
-	Math::Angle animRoll = _roll + _animRoll;
-
-	_localMatrix.setPosition(animPos);
-	_localMatrix.buildFromPitchYawRoll(animPitch, animYaw, animRoll);
-
-	_matrix = _localMatrix * _matrix;
-
-	_pivotMatrix = _matrix;
-
-	_pivotMatrix.translate(_pivot);
-
-	if (_mesh) {
-		_mesh->_matrix = _pivotMatrix;
-	}
-
-	ModelNode *child = _child;
-	while (child) {
-		child->setMatrix(_matrix);
-		child->update();
-
-		child = child->_sibling;
-	}
+	if (!_skeleton)
+		_skeleton = new ModelSkeleton(this);
+	_skeleton->update(_matrix);
 }
 
 void ModelNode::addSprite(Sprite *sprite) {
@@ -33,6 +33,7 @@ class TextSplitter;
 class Material;
 class Mesh;
 class ModelNode;
+class ModelSkeleton;
 class CMap;
 
 struct Sprite {
@@ -96,6 +97,7 @@ public:
 
 class MeshFace {
 public:
+	MeshFace() : _arrayIndices(NULL) { }
 	int loadBinary(const char *&data, Material *materials[]);
 	void draw(float *vertices, float *vertNormals, float *textureVerts) const;
 	void changeMaterial(Material *material);
@@ -106,6 +108,7 @@ public:
 	float _extraLight;
 	int _numVertices;
 	int *_vertices, *_texVertices;
+	int *_arrayIndices;		// into the vertex arrays of the mesh
 	Math::Vector3d _normal;
 };
 
@@ -116,7 +119,7 @@ public:
 	void changeMaterials(Material *materials[]);
 	void draw(int *x1, int *y1, int *x2, int *y2) const;
 	void update();
-	Mesh() : _numFaces(0) { }
+	Mesh() : _numFaces(0), _numArrayVerts(0), _arrayVertices(NULL), _arrayNormals(NULL), _arrayTextureVerts(NULL) { }
 	~Mesh();
 
 	char _name[32];
@@ -135,17 +138,42 @@ public:
 	int _numFaces;
 	MeshFace *_faces;
 	Math::Matrix4 _matrix;
+
+	// Vertex arrays with one entry for each distinct pair of vertex and
+	// texture vertex used by the faces, for drivers drawing whole meshes.
+	int _numArrayVerts;
+	float *_arrayVertices;		// sets of 3
+	float *_arrayNormals;		// sets of 3
+	float *_arrayTextureVerts;	// sets of 2
+
+	// Screen bounds as last computed by the driver, together with the
+	// transformation they were computed for.
+	struct ScreenBounds {
+		ScreenBounds() : _valid(false) { }
+		bool _valid;
+		float _matrix[16];
+		int _viewport[4];
+		int _x1, _y1, _x2, _y2;
+	};
+	mutable ScreenBounds _screenBounds;
+
+private:
+	void buildArrays();
 };
 
 class ModelNode {
 public:
-	ModelNode() : _initialized(false) { }
+	ModelNode() : _initialized(false), _skeleton(NULL) { }
 	~ModelNode();
 	void loadBinary(const char *&data, ModelNode *hierNodes, const Model::Geoset *g);
 	void draw(int *x1, int *y1, int *x2, int *y2) const;
 	void addChild(ModelNode *child);
 	void removeChild(ModelNode *child);
-	void setMatrix(Math::Matrix4 matrix);
+	void setMatrix(const Math::Matrix4 &matrix);
+	/**
+	 * Updates the matrices of this node and of all its descendants, using the
+	 * matrix set with setMatrix() as the parent transform of this node.
+	 */
 	void update();
 	void addSprite(Sprite *sprite);
 	void removeSprite(Sprite *sprite);
@@ -162,9 +190,13 @@ public:
 	bool _meshVisible, _hierVisible;
 	bool _initialized;
 	Math::Matrix4 _matrix;
-	Math::Matrix4 _localMatrix;
 	Math::Matrix4 _pivotMatrix;
 	Sprite* _sprite;
+	// The flattened hierarchy below this node, built by update()
+	ModelSkeleton *_skeleton;
+
+private:
+	void invalidateSkeleton();
 };
 
 } // end of namespace Grim
@@ -49,6 +49,7 @@ MODULE_OBJS := \
 	detection.o \
 	font.o \
 	gfx_base.o \
+	gfx_capture.o \
 	gfx_opengl.o \
 	gfx_tinygl.o \
 	grim.o \
@@ -66,14 +66,29 @@ SmushDecoder::SmushDecoder() {
 	_startPos = 0;
 	_x = 0;
 	_y = 0;
+	_lastFrame = 0;
+	_frameData = NULL;
+	_frameDataSize = 0;
+	for (int i = 0; i < kAudioRingSize; i++) {
+		_audioData[i] = NULL;
+		_audioDataSize[i] = 0;
+	}
+	_audioNext = 0;
 	_blocky8 = new Blocky8();
 	_blocky16 = new Blocky16();
 	init();
 }
 
 SmushDecoder::~SmushDecoder() {
+	// Stop the audio first, it may still be playing from _audioData
+	close();
+	for (int i = 0; i < kFrameRingSize; i++)
+		_frames[i].free();
 	delete _blocky8;
 	delete _blocky16;
+	delete[] _frameData;
+	for (int i = 0; i < kAudioRingSize; i++)
+		free(_audioData[i]);
 }
 
 void SmushDecoder::init() {
@@ -81,15 +96,25 @@ void SmushDecoder::init() {
 	_stream = NULL;
 	_curFrame = 0;
 	_videoPause = false;
+	Common::StackLock lock(_ringMutex);
+	_readyFrame = -1;
+	_shownFrame = -1;
 
 	if (!_demo) {
-		_surface.create(_width, _height, _format);
 		vimaInit(smushDestTable);
 	}
 }
 
 void SmushDecoder::close() {
-	_surface.free();
+	// The ring surfaces are kept for the next video, the renderer may
+	// still be reading the frame it took last.
+	_indexed.free();
+	{
+		Common::StackLock lock(_ringMutex);
+		_readyFrame = -1;
+		_shownFrame = -1;
+		_lastFrame = 0;
+	}
 	if (_stream) {
 		_stream->finish();
 		_stream = NULL;
@@ -103,10 +128,82 @@ void SmushDecoder::close() {
 	}
 }
 
-void SmushDecoder::handleWave(const byte *src, uint32 size) {
-	int16 *dst = (int16 *) malloc(size * _channels * sizeof(int16));
-	decompressVima(src, dst, size * _channels * 2, smushDestTable);
+// Picks the surface to decode the next frame into, which is any one the
+// renderer is neither showing nor about to take.
+Graphics::Surface *SmushDecoder::beginFrame() {
+	Common::StackLock lock(_ringMutex);
+	int i = _lastFrame;
+	do {
+		i = (i + 1) % kFrameRingSize;
+	} while (i == _readyFrame || i == _shownFrame);
+	_lastFrame = i;
+
+	Graphics::Surface *frame = &_frames[i];
+	if (frame->w != _width || frame->h != _height || !frame->pixels)
+		frame->create(_width, _height, _format);
+	return frame;
+}
+
+// Makes the frame from beginFrame() the newest one; the ready frame it
+// replaces, if the renderer did not take it, is dropped.
+void SmushDecoder::endFrame() {
+	Common::StackLock lock(_ringMutex);
+	_readyFrame = _lastFrame;
+}
 
+Graphics::Surface *SmushDecoder::takeFrame() {
+	Common::StackLock lock(_ringMutex);
+	if (_readyFrame >= 0) {
+		_shownFrame = _readyFrame;
+		_readyFrame = -1;
+	}
+	if (_shownFrame < 0)
+		return NULL;
+	return &_frames[_shownFrame];
+}
+
+bool SmushDecoder::hasReadyFrame() const {
+	Common::StackLock lock(_ringMutex);
+	return _readyFrame >= 0;
+}
+
+// Reads the next "size" bytes of the file into the frame buffer, which
+// only grows, and returns it.
+byte *SmushDecoder::readChunk(uint32 size) {
+	if (size > _frameDataSize) {
+		delete[] _frameData;
+		_frameDataSize = MAX(size, _frameDataSize * 2);
+		_frameData = new byte[_frameDataSize];
+	}
+	_file->read(_frameData, size);
+	return _frameData;
+}
+
+// Returns a buffer for "size" bytes of audio to pass to queueAudio().
+// The next buffer of the ring was queued kAudioRingSize buffers ago, so
+// it has been played as long as fewer buffers are still queued. If the
+// mixer has fallen that far behind, a buffer the stream frees is used.
+byte *SmushDecoder::getAudioBuffer(uint32 size) {
+	if (_stream && _stream->numQueuedStreams() >= kAudioRingSize)
+		return (byte *)malloc(size);
+	if (size > _audioDataSize[_audioNext]) {
+		free(_audioData[_audioNext]);
+		_audioData[_audioNext] = (byte *)malloc(size);
+		_audioDataSize[_audioNext] = size;
+	}
+	return _audioData[_audioNext];
+}
+
+void SmushDecoder::queueAudio(byte *data, uint32 size, byte flags) {
+	if (data == _audioData[_audioNext]) {
+		_stream->queueBuffer(data, size, DisposeAfterUse::NO, flags);
+		_audioNext = (_audioNext + 1) % kAudioRingSize;
+	} else {
+		_stream->queueBuffer(data, size, DisposeAfterUse::YES, flags);
+	}
+}
+
+void SmushDecoder::handleWave(const byte *src, uint32 size) {
 	int flags = Audio::FLAG_16BITS;
 	if (_channels == 2)
 		flags |= Audio::FLAG_STEREO;
@@ -116,9 +213,9 @@ void SmushDecoder::handleWave(const byte *src, uint32 size) {
 		g_system->getMixer()->playStream(Audio::Mixer::kMusicSoundType, &_soundHandle, _stream);
 	}
 	if (g_system->getMixer()->isReady()) {
-		_stream->queueBuffer((byte *)dst, size * _channels * 2, DisposeAfterUse::YES, flags);
-	} else {
-		free(dst);
+		byte *dst = getAudioBuffer(size * _channels * 2);
+		decompressVima(src, (int16 *)dst, size * _channels * 2, smushDestTable);
+		queueAudio(dst, size * _channels * 2, flags);
 	}
 }
 
@@ -149,12 +246,9 @@ void SmushDecoder::handleFrame() {
 	tag = _file->readUint32BE();
 	if (tag == MKTAG('A','N','N','O')) {
 		char *anno;
-		byte *data;
 
 		size = _file->readUint32BE();
-		data = new byte[size];
-		_file->read(data, size);
-		anno = (char *)data;
+		anno = (char *)readChunk(size);
 		if (strncmp(anno, ANNO_HEADER, sizeof(ANNO_HEADER) - 1) == 0) {
 			//char *annoData = anno + sizeof(ANNO_HEADER);
 
@@ -175,18 +269,17 @@ void SmushDecoder::handleFrame() {
 			if (gDebugLevel == DEBUG_MOVIE || gDebugLevel == DEBUG_NORMAL || gDebugLevel == DEBUG_ALL)
 				debug("Announcement header not understood: %s\n", anno);
 		}
-		delete[] anno;
 		tag = _file->readUint32BE();
 	}
 
 	assert(tag == MKTAG('F','R','M','E'));
 	size = _file->readUint32BE();
-	byte *frame = new byte[size];
-	_file->read(frame, size);
+	byte *frame = readChunk(size);
 
 	do {
 		if (READ_BE_UINT32(frame + pos) == MKTAG('B','l','1','6')) {
-			_blocky16->decode((byte *)_surface.pixels, frame + pos + 8);
+			_blocky16->decode((byte *)beginFrame()->pixels, frame + pos + 8);
+			endFrame();
 			pos += READ_BE_UINT32(frame + pos + 4) + 8;
 		} else if (READ_BE_UINT32(frame + pos) == MKTAG('W','a','v','e')) {
 			int decompressed_size = READ_BE_UINT32(frame + pos + 8);
@@ -199,7 +292,6 @@ void SmushDecoder::handleFrame() {
 			error("SmushDecoder::handleFrame() unknown tag");
 		}
 	} while (pos < size);
-	delete[] frame;
 
 	_curFrame++;
 	if (_curFrame == _nbframes) {
@@ -241,7 +333,7 @@ void SmushDecoder::handleIACT(const byte *src, int32 size) {
 				_IACTpos += bsize;
 				bsize = 0;
 			} else {
-				byte *output_data = new byte[4096];
+				byte *output_data = getAudioBuffer(0x1000);
 				memcpy(_IACToutput + _IACTpos, d_src, len);
 				byte *dst = output_data;
 				byte *d_src2 = _IACToutput;
@@ -276,7 +368,7 @@ void SmushDecoder::handleIACT(const byte *src, int32 size) {
 					_stream = Audio::makeQueuingAudioStream(22050, true);
 					g_system->getMixer()->playStream(Audio::Mixer::kSFXSoundType, &_soundHandle, _stream);
 				}
-				_stream->queueBuffer(output_data, 0x1000, DisposeAfterUse::YES, Audio::FLAG_STEREO | Audio::FLAG_16BITS);
+				queueAudio(output_data, 0x1000, Audio::FLAG_STEREO | Audio::FLAG_16BITS);
 
 				bsize -= len;
 				d_src += len;
@@ -299,6 +391,7 @@ void SmushDecoder::handleFrameDemo() {
 	uint32 tag;
 	int32 size;
 	int pos = 0;
+	bool update = false;
 
 	if (_videoPause)
 		return;
@@ -314,8 +407,7 @@ void SmushDecoder::handleFrameDemo() {
 	tag = _file->readUint32BE();
 	assert(tag == MKTAG('F','R','M','E'));
 	size = _file->readUint32BE();
-	byte *frame = new byte[size];
-	_file->read(frame, size);
+	byte *frame = readChunk(size);
 
 	do {
 		if (READ_BE_UINT32(frame + pos) == MKTAG('F','O','B','J')) {
@@ -326,10 +418,11 @@ void SmushDecoder::handleFrameDemo() {
 			if (width != _width || height != _height) {
 				_width = width;
 				_height = height;
-				_surface.create(_width, _height, _format);
+				_indexed.create(_width, _height, Graphics::PixelFormat::createFormatCLUT8());
 				_blocky8->init(_width, _height);
 			}
-			_blocky8->decode((byte *)_surface.pixels, frame + pos + 8 + 14);
+			_blocky8->decode((byte *)_indexed.pixels, frame + pos + 8 + 14);
+			update = true;
 			pos += READ_BE_UINT32(frame + pos + 4) + 8;
 		} else if (READ_BE_UINT32(frame + pos) == MKTAG('I','A','C','T')) {
 			handleIACT(frame + pos + 8, READ_BE_UINT32(frame + pos + 4));
@@ -339,23 +432,23 @@ void SmushDecoder::handleFrameDemo() {
 			pos += offset;
 		} else if (READ_BE_UINT32(frame + pos) == MKTAG('X','P','A','L')) {
 			handleDeltaPalette(frame + pos + 8, READ_BE_UINT32(frame + pos + 4));
+			update = true;
 			pos += READ_BE_UINT32(frame + pos + 4) + 8;
 		} else {
 			error("SmushDecoder::handleFrame() unknown tag");
 		}
 	} while (pos < size);
-	delete[] frame;
-	
-	Graphics::Surface conversion;
-	conversion.create(0, 0, _format); // Avoid issues with copyFrom, by creating an empty surface.
-	conversion.copyFrom(_surface);
-	
-	uint16 *d = (uint16 *)_surface.pixels;
-	for (int l = 0; l < _width * _height; l++) {
-		int index = ((byte *)conversion.pixels)[l];
-		d[l] = ((_pal[(index * 3) + 0] & 0xF8) << 8) | ((_pal[(index * 3) + 1] & 0xFC) << 3) | (_pal[(index * 3) + 2] >> 3);
+
+	// Palette changes alone also need a new frame
+	if (update && _indexed.pixels) {
+		const byte *s = (const byte *)_indexed.pixels;
+		uint16 *d = (uint16 *)beginFrame()->pixels;
+		for (int l = 0; l < _width * _height; l++) {
+			int index = s[l];
+			d[l] = ((_pal[(index * 3) + 0] & 0xF8) << 8) | ((_pal[(index * 3) + 1] & 0xFC) << 3) | (_pal[(index * 3) + 2] >> 3);
+		}
+		endFrame();
 	}
-	conversion.free();
 
 	_curFrame++;
 }
@@ -485,8 +578,6 @@ bool SmushDecoder::loadStream(Common::SeekableReadStream *stream) {
 	_startPos = _file->pos();
 
 	init();
-	if (!_demo)
-		_surface.create(_width, _height, _format);
 	return true;
 }
 
@@ -496,7 +587,7 @@ const Graphics::Surface *SmushDecoder::decodeNextFrame() {
 	else
 		handleFrame();
 
-	return &_surface;
+	return &_frames[_lastFrame];
 }
 
 void SmushDecoder::setLooping(bool l) {
@@ -23,6 +23,7 @@
 #ifndef GRIM_SMUSH_DECODER_H
 #define GRIM_SMUSH_DECODER_H
 
+#include "common/mutex.h"
 #include "common/rational.h"
 
 #include "audio/mixer.h"
@@ -51,14 +52,35 @@ private:
 	Blocky16 *_blocky16;
 	Common::SeekableReadStream *_file;
 	Common::Rational _frameRate;
-	Graphics::Surface _surface;
 	Graphics::PixelFormat _format;
 
+	// Decoded frames go round a small ring of surfaces, so that a new frame
+	// never overwrites the one the renderer is reading nor the newest one
+	// it has not taken yet. The frames are decoded on another thread than
+	// the one taking them; _ringMutex guards the three indices below.
+	enum { kFrameRingSize = 3 };
+	Graphics::Surface _frames[kFrameRingSize];
+	mutable Common::Mutex _ringMutex;
+	int _readyFrame;	//< newest decoded frame not taken by the renderer yet, or -1
+	int _shownFrame;	//< frame last taken by the renderer, or -1
+	int _lastFrame;		//< frame last decoded
+	Graphics::Surface _indexed;	//< 8 bit frame of the demo codec, before applying the palette
+
 	byte _pal[0x300];
 	int16 _deltaPal[0x300];
 	byte _IACToutput[4096];
 	int32 _IACTpos;
 
+	// Buffers reused from frame to frame. The chunks of a frame are read
+	// into _frameData and decoded in place; decoded audio is queued from
+	// a ring of buffers that are handed out again once played.
+	enum { kAudioRingSize = 16 };
+	byte *_frameData;
+	uint32 _frameDataSize;
+	byte *_audioData[kAudioRingSize];
+	uint32 _audioDataSize[kAudioRingSize];
+	int _audioNext;
+
 	Audio::SoundHandle _soundHandle;
 	Audio::QueuingAudioStream *_stream;
 
@@ -80,12 +102,22 @@ public:
 	uint16 getWidth() const { return _width; }
 	uint16 getHeight() const { return _height; }
 
-	Graphics::PixelFormat getPixelFormat() const { return _surface.format; }
+	Graphics::PixelFormat getPixelFormat() const { return _format; }
 	bool isVideoLoaded() const { return _file != 0; }
 
 	bool loadStream(Common::SeekableReadStream *stream);
 	const Graphics::Surface *decodeNextFrame();
 
+	/**
+	 * Returns the newest decoded frame and keeps it away from the decoder
+	 * until the next call. Returns the frame taken previously if nothing
+	 * new has been decoded since, and NULL if no frame has been decoded
+	 * since loading the video. May be called while decodeNextFrame() runs
+	 * on another thread.
+	 */
+	Graphics::Surface *takeFrame();
+	bool hasReadyFrame() const;
+
 	uint32 getFrameCount() const;
 	void close();
 
@@ -97,6 +129,11 @@ private:
 	void pauseVideoIntern(bool p);
 	void parseNextFrame();
 	void init();
+	Graphics::Surface *beginFrame();
+	void endFrame();
+	byte *readChunk(uint32 size);
+	byte *getAudioBuffer(uint32 size);
+	void queueAudio(byte *data, uint32 size, byte flags);
 	void handleDeltaPalette(byte *src, int32 size);
 	void handleFramesHeader();
 	void handleFrameDemo();
@@ -67,10 +67,13 @@ void MoviePlayer::stop() {
 }
 
 void MoviePlayer::timerCallback(void *) {
-	g_movie->_frameMutex.lock();
-	if (g_movie->prepareFrame())
-		g_movie->handleFrame();
-	g_movie->_frameMutex.unlock();
+	g_movie->timerTick();
+}
+
+void MoviePlayer::timerTick() {
+	Common::StackLock lock(_frameMutex);
+	if (prepareFrame())
+		handleFrame();
 }
 
 bool MoviePlayer::prepareFrame() {
@@ -89,7 +92,16 @@ bool MoviePlayer::prepareFrame() {
 	if (_videoDecoder->getTimeToNextFrame() > 0)
 		return false;
 
-	_surface->copyFrom(*_videoDecoder->decodeNextFrame());
+	presentFrame(_videoDecoder->decodeNextFrame());
+
+	_movieTime = _videoDecoder->getElapsedTime();
+	_frame = _videoDecoder->getCurFrame();
+
+	return true;
+}
+
+void MoviePlayer::presentFrame(const Graphics::Surface *frame) {
+	_surface->copyFrom(*frame);
 
 	// Avoid updating the _externalBuffer if it's flagged as updateNeeded
 	// since the draw-loop might access it then. This way, any late frames
@@ -98,11 +110,6 @@ bool MoviePlayer::prepareFrame() {
 		_externalSurface->copyFrom(*_surface);
 		_updateNeeded = true;
 	}
-
-	_movieTime = _videoDecoder->getElapsedTime();
-	_frame = _videoDecoder->getCurFrame();
-
-	return true;
 }
 
 Graphics::Surface *MoviePlayer::getDstSurface() {
@@ -119,7 +126,6 @@ void MoviePlayer::init() {
 }
 
 void MoviePlayer::deinit() {
-	_frameMutex.unlock();
 	g_system->getTimerManager()->removeTimerProc(&timerCallback);
 	_videoDecoder->close();
 	_surface->free();
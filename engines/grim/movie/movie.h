@@ -90,6 +90,17 @@ public:
 	
 protected:
 	static void timerCallback(void *ptr);
+
+	/**
+	 * Called from the timer every _speed microseconds while playing.
+	 *
+	 * The default implementation runs prepareFrame() and handleFrame()
+	 * right there, with _frameMutex held.
+	 *
+	 * @see prepareFrame
+	 */
+	virtual void timerTick();
+
 	/**
 	 * Handles basic stuff per frame, like copying the latest frame to
 	 * _externalBuffer, and updating the frame-counters.
@@ -99,6 +110,18 @@ protected:
 	 */
 	virtual bool prepareFrame();
 
+	/**
+	 * Hands a freshly decoded frame over to the renderer.
+	 *
+	 * The default implementation copies it to _externalSurface, unless the
+	 * renderer has not picked up the previous frame yet, in which case the
+	 * new frame is dropped. It is called with _frameMutex held.
+	 *
+	 * @param frame			the frame returned by the decoder
+	 * @see prepareFrame
+	 */
+	virtual void presentFrame(const Graphics::Surface *frame);
+
 	/**
 	 * Frame-handling function.
 	 *
@@ -39,6 +39,40 @@ SmushPlayer::SmushPlayer(bool demo) : MoviePlayer(), _demo(demo) {
 	_speed = 5000;
 	_videoDecoder = new Grim::SmushDecoder();
 	getDecoder()->setDemo(_demo);
+	// Without threads the timer decodes the frames itself
+	_decodeQuit = false;
+	if (_decodeSignal.isValid())
+		_decodeWorker.start(decodeThread, this);
+}
+
+SmushPlayer::~SmushPlayer() {
+	deinit();
+	_decodeQuit = true;
+	_decodeSignal.post();
+	_decodeWorker.wait();
+}
+
+void SmushPlayer::timerTick() {
+	if (_decodeWorker.isRunning())
+		_decodeSignal.post();
+	else
+		MoviePlayer::timerTick();
+}
+
+int SmushPlayer::decodeThread(void *param) {
+	SmushPlayer *player = (SmushPlayer *)param;
+
+	for (;;) {
+		// Posted on every timer tick, and on quitting. Ticks may still be
+		// pending after deinit(), so a finished video is left alone.
+		player->_decodeSignal.wait();
+		if (player->_decodeQuit)
+			break;
+		Common::StackLock lock(player->_frameMutex);
+		if (!player->_videoFinished && player->prepareFrame())
+			player->handleFrame();
+	}
+	return 0;
 }
 
 bool SmushPlayer::loadFile(Common::String filename) {
@@ -62,6 +96,28 @@ void SmushPlayer::init() {
 	MoviePlayer::init();
 }
 
+// Waits for the frame being decoded, if any, before closing the decoder.
+void SmushPlayer::deinit() {
+	Common::StackLock lock(_frameMutex);
+	MoviePlayer::deinit();
+}
+
+// The decoder writes each frame straight into one of its ring surfaces,
+// so there is nothing to copy here. The renderer takes the newest one
+// from getDstSurface(); any frame it did not get to in time is simply
+// replaced by a newer one. The ring has its own lock, so the renderer
+// does not wait for the frame being decoded.
+void SmushPlayer::presentFrame(const Graphics::Surface *frame) {
+}
+
+bool SmushPlayer::isUpdateNeeded() {
+	return getDecoder()->hasReadyFrame();
+}
+
+Graphics::Surface *SmushPlayer::getDstSurface() {
+	return getDecoder()->takeFrame();
+}
+
 void SmushPlayer::handleFrame() {
 	if (_demo) {
 		_x = getDecoder()->getX();
@@ -83,6 +139,7 @@ void SmushPlayer::handleFrame() {
 
 void SmushPlayer::restoreState(SaveGame *state) {
 	MoviePlayer::restoreState(state);
+	Common::StackLock lock(_frameMutex);
 	getDecoder()->seekToTime((uint32)_movieTime); // Currently not fully working (out of synch)
 }
 
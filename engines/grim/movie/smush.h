@@ -23,6 +23,8 @@
 #ifndef GRIM_SMUSH_PLAYER_H
 #define GRIM_SMUSH_PLAYER_H
 
+#include "common/thread.h"
+
 #include "engines/grim/movie/movie.h"
 
 #ifdef USE_SMUSH
@@ -34,14 +36,28 @@ class SmushDecoder;
 class SmushPlayer : public MoviePlayer {
 public:
 	SmushPlayer(bool demo);
+	~SmushPlayer();
 
 	void restoreState(SaveGame *state);
+	bool isUpdateNeeded();
+	Graphics::Surface *getDstSurface();
+	void clearUpdateNeeded() {}
 private:
+	static int decodeThread(void *param);
+	void timerTick();
 	bool loadFile(Common::String filename);
+	void presentFrame(const Graphics::Surface *frame);
 	void handleFrame();
 	SmushDecoder* getDecoder();
 	void init();
+	void deinit();
 	bool _demo;
+
+	// Decodes the frames into the ring of the decoder, so that neither
+	// the timer nor the renderer wait for it. Woken by the timer.
+	Common::Semaphore _decodeSignal;
+	Common::Thread _decodeWorker;
+	volatile bool _decodeQuit;
 };
 
 } // end of namespace Grim
@@ -20,6 +20,10 @@
  *
  */
 
+#include "common/config-manager.h"
+#include "common/savefile.h"
+#include "common/system.h"
+
 #include "engines/grim/resource.h"
 #include "engines/grim/colormap.h"
 #include "engines/grim/costume.h"
@@ -37,13 +41,39 @@ namespace Grim {
 
 ResourceLoader *g_resourceloader = NULL;
 
+#define LABINDEX_TAG		MKTAG('L','I','D','X')
+#define LABINDEX_VERSION	2
+
+static Common::String getLabIndexName() {
+	return ConfMan.getActiveDomainName() + ".labidx";
+}
+
 ResourceLoader::ResourceLoader() {
 	int lab_counter = 0;
-	_cacheDirty = false;
 	_cacheMemorySize = 0;
+	_cacheHits = 0;
+	_cacheMisses = 0;
+	_cacheEvictions = 0;
+
+	// The budget is given in megabytes, 0 means unbounded
+	int cacheSize = 32;
+	if (ConfMan.hasKey("resource_cache_size"))
+		cacheSize = ConfMan.getInt("resource_cache_size");
+	setCacheBudget(MAX(cacheSize, 0) * 1024 * 1024);
 
 	Lab *l;
 	Common::ArchiveMemberList files;
+	Common::Array<Lab *> openedLabs;
+
+	// The file tables of all archives are kept in a save file, so that
+	// they do not have to be parsed again on every launch
+	Common::SeekableReadStream *index = g_system->getSavefileManager()->openForLoading(getLabIndexName());
+	if (index && (index->readUint32BE() != LABINDEX_TAG || index->readUint32LE() != LABINDEX_VERSION ||
+				  index->readUint32LE() != (uint32)g_grim->getGameType())) {
+		delete index;
+		index = NULL;
+	}
+	bool indexUpToDate = index != NULL;
 
 	SearchMan.listMatchingMembers(files, "*.lab");
 	SearchMan.listMatchingMembers(files, "*.m4b");
@@ -55,7 +85,14 @@ ResourceLoader::ResourceLoader() {
 		const Common::String filename = (*x)->getName();
 		l = new Lab();
 
-		if (l->open(filename)) {
+		if (l->open(filename, index)) {
+			if (!l->isIndexed()) {
+				// Stale index, the remaining tables are parsed
+				delete index;
+				index = NULL;
+				indexUpToDate = false;
+			}
+			openedLabs.push_back(l);
 			if (filename.equalsIgnoreCase("data005.lab"))
 				_labs.push_front(l);
 			else
@@ -75,7 +112,13 @@ ResourceLoader::ResourceLoader() {
 			const Common::String filename = (*x)->getName();
 			l = new Lab();
 
-			if (l->open(filename)) {
+			if (l->open(filename, index)) {
+				if (!l->isIndexed()) {
+					delete index;
+					index = NULL;
+					indexUpToDate = false;
+				}
+				openedLabs.push_back(l);
 				_labs.push_back(l);
 				lab_counter++;
 			} else {
@@ -83,6 +126,31 @@ ResourceLoader::ResourceLoader() {
 			}
 		}
 	}
+
+	delete index;
+	if (!indexUpToDate)
+		saveLabIndex(openedLabs);
+	buildLabIndex();
+
+	// The prefetch thread gets its own handles on the archives which are
+	// not memory mapped, the shared ones are only used by the main thread
+	_prefetchQuit = false;
+	if (_prefetchSignal.isValid()) {
+		for (LabList::const_iterator i = _labs.begin(); i != _labs.end(); ++i) {
+			if ((*i)->isMapped())
+				continue;
+			Common::File *f = new Common::File();
+			if (f->open((*i)->getFileName()))
+				_prefetchFiles[(*i)->getFileName()] = f;
+			else
+				delete f;
+		}
+		if (!_prefetchWorker.start(prefetchThread, this)) {
+			for (PrefetchFiles::iterator i = _prefetchFiles.begin(); i != _prefetchFiles.end(); ++i)
+				delete i->_value;
+			_prefetchFiles.clear();
+		}
+	}
 }
 
 template<typename T>
@@ -95,10 +163,19 @@ void clearList(Common::List<T> &list) {
 }
 
 ResourceLoader::~ResourceLoader() {
-	for (Common::Array<ResourceCache>::iterator i = _cache.begin(); i != _cache.end(); ++i) {
-		ResourceCache &r = *i;
-		delete[] r.fname;
-		delete r.resPtr;
+	{
+		Common::StackLock lock(_mutex);
+		_prefetchQuit = true;
+	}
+	_prefetchSignal.post();
+	_prefetchWorker.wait();
+	for (PrefetchFiles::iterator i = _prefetchFiles.begin(); i != _prefetchFiles.end(); ++i)
+		delete i->_value;
+
+	for (CacheList::iterator i = _cacheLru.begin(); i != _cacheLru.end(); ++i) {
+		ResourceCache *r = *i;
+		delete r->resPtr;
+		delete r;
 	}
 	clearList(_labs);
 	clearList(_models);
@@ -107,16 +184,47 @@ ResourceLoader::~ResourceLoader() {
 	clearList(_lipsyncs);
 }
 
-const Lab *ResourceLoader::getLab(const Common::String &filename) const {
-	for (LabList::const_iterator i = _labs.begin(); i != _labs.end(); ++i)
-		if ((*i)->getFileExists(filename))
-			return *i;
+void ResourceLoader::buildLabIndex() {
+	_labIndex.clear();
 
-	return NULL;
+	// Earlier archives in _labs take precedence
+	for (LabList::const_iterator i = _labs.begin(); i != _labs.end(); ++i) {
+		const Lab::LabMap &entries = (*i)->getEntries();
+		for (Lab::LabMap::const_iterator e = entries.begin(); e != entries.end(); ++e) {
+			if (!_labIndex.contains(e->_key)) {
+				LabIndexEntry &entry = _labIndex[e->_key];
+				entry.lab = *i;
+				entry.entry = e->_value;
+			}
+		}
+	}
 }
 
-static int sortCallback(const void *entry1, const void *entry2) {
-	return scumm_stricmp(((ResourceLoader::ResourceCache *)entry1)->fname, ((ResourceLoader::ResourceCache *)entry2)->fname);
+void ResourceLoader::saveLabIndex(const Common::Array<Lab *> &labs) const {
+	Common::OutSaveFile *out = g_system->getSavefileManager()->openForSaving(getLabIndexName());
+	if (!out) {
+		warning("Could not write the archive index");
+		return;
+	}
+
+	out->writeUint32BE(LABINDEX_TAG);
+	out->writeUint32LE(LABINDEX_VERSION);
+	out->writeUint32LE(g_grim->getGameType());
+	for (Common::Array<Lab *>::const_iterator i = labs.begin(); i != labs.end(); ++i)
+		(*i)->saveIndex(out);
+
+	out->finalize();
+	if (out->err())
+		warning("Could not write the archive index");
+	delete out;
+}
+
+const ResourceLoader::LabIndexEntry *ResourceLoader::getIndexEntry(const Common::String &filename) const {
+	LabIndex::const_iterator i = _labIndex.find(filename);
+	if (i == _labIndex.end())
+		return NULL;
+
+	return &i->_value;
 }
 
 Block *ResourceLoader::getFileFromCache(const Common::String &filename) {
@@ -128,30 +236,53 @@ Block *ResourceLoader::getFileFromCache(const Common::String &filename) {
 }
 
 ResourceLoader::ResourceCache *ResourceLoader::getEntryFromCache(const Common::String &filename) {
-	if (_cache.empty())
-		return NULL;
+	Common::StackLock lock(_mutex);
 
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
+	CacheMap::iterator i = _cache.find(filename);
+	if (i == _cache.end()) {
+		++_cacheMisses;
+		return NULL;
 	}
 
-	ResourceCache key;
-	key.fname = const_cast<char *>(filename.c_str());
+	++_cacheHits;
+
+	// Move the entry to the front of the LRU list
+	ResourceCache *entry = i->_value;
+	_cacheLru.erase(entry->lruPos);
+	_cacheLru.push_front(entry);
+	entry->lruPos = _cacheLru.begin();
 
-	return (ResourceLoader::ResourceCache *)bsearch(&key, _cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
+	return entry;
 }
 
 bool ResourceLoader::getFileExists(const Common::String &filename) const {
-	return getLab(filename) != NULL;
+	return getIndexEntry(filename) != NULL;
+}
+
+bool ResourceLoader::getLabEntry(const Common::String &filename, Common::String &labName, int &offset, int &len) const {
+	const LabIndexEntry *e = getIndexEntry(filename);
+	if (!e)
+		return false;
+
+	labName = e->lab->getFileName();
+	offset = e->entry.offset;
+	len = e->entry.len;
+	return true;
+}
+
+void ResourceLoader::listFiles(Common::StringArray &result, const Common::String &pattern) const {
+	for (LabIndex::const_iterator i = _labIndex.begin(); i != _labIndex.end(); ++i) {
+		if (i->_key.matchString(pattern, true))
+			result.push_back(i->_key);
+	}
 }
 
 Block *ResourceLoader::getFileBlock(const Common::String &filename) const {
-	const Lab *l = getLab(filename);
-	if (!l)
+	const LabIndexEntry *e = getIndexEntry(filename);
+	if (!e)
 		return NULL;
-	else
-		return l->getFileBlock(filename);
+
+	return e->lab->getFileBlock(filename, e->entry);
 }
 
 Block *ResourceLoader::getBlock(const Common::String &filename) {
@@ -169,48 +300,170 @@ Block *ResourceLoader::getBlock(const Common::String &filename) {
 }
 
 LuaFile *ResourceLoader::openNewStreamLuaFile(const char *filename) const {
-	const Lab *l = getLab(filename);
+	const LabIndexEntry *e = getIndexEntry(filename);
 
-	if (!l)
+	if (!e)
 		return NULL;
 	else
-		return l->openNewStreamLua(filename);
+		return e->lab->openNewStreamLua(e->entry);
 }
 
 Common::File *ResourceLoader::openNewStreamFile(const char *filename) const {
-	const Lab *l = getLab(filename);
+	const LabIndexEntry *e = getIndexEntry(filename);
 
-	if (!l)
+	if (!e)
 		return NULL;
 	else
-		return l->openNewStreamFile(filename);
+		return e->lab->openNewStreamFile(e->entry);
 }
 
 Common::SeekableReadStream *ResourceLoader::openNewSubStreamFile(const char *filename) const {
-	const Lab *l = getLab(filename);
+	const LabIndexEntry *e = getIndexEntry(filename);
 
-	if (!l)
+	if (!e)
 		return NULL;
 	else
-		return l->openNewSubStreamFile(filename);
+		return e->lab->openNewSubStreamFile(filename, e->entry);
 }
 
 int ResourceLoader::getFileLength(const char *filename) const {
-	const Lab *l = getLab(filename);
-	if (l)
-		return l->getFileLength(filename);
+	const LabIndexEntry *e = getIndexEntry(filename);
+	if (e)
+		return e->entry.len;
 	else
 		return 0;
 }
 
 void ResourceLoader::putIntoCache(const Common::String &fname, Block *res) {
-	ResourceCache entry;
-	entry.resPtr = res;
-	entry.fname = new char[fname.size() + 1];
-	strcpy(entry.fname, fname.c_str());
+	Common::StackLock lock(_mutex);
+
+	CacheMap::iterator i = _cache.find(fname);
+	if (i != _cache.end())
+		removeFromCache(i->_value);
+
+	ResourceCache *entry = new ResourceCache;
+	entry->fname = fname;
+	entry->resPtr = res;
+	_cacheLru.push_front(entry);
+	entry->lruPos = _cacheLru.begin();
+	_cache[fname] = entry;
 	_cacheMemorySize += res->getLen();
-	_cache.push_back(entry);
-	_cacheDirty = true;
+}
+
+void ResourceLoader::removeFromCache(ResourceCache *entry) {
+	_cacheMemorySize -= entry->resPtr->getLen();
+	_cacheLru.erase(entry->lruPos);
+	_cache.erase(entry->fname);
+	delete entry->resPtr;
+	delete entry;
+}
+
+void ResourceLoader::trimCache() {
+	if (_cacheBudget == 0)
+		return;
+
+	Common::StackLock lock(_mutex);
+
+	while (_cacheMemorySize > _cacheBudget && !_cacheLru.empty()) {
+		removeFromCache(_cacheLru.back());
+		++_cacheEvictions;
+	}
+}
+
+ResourceLoader::CacheStats ResourceLoader::getCacheStats() const {
+	Common::StackLock lock(_mutex);
+
+	CacheStats stats;
+	stats.hits = _cacheHits;
+	stats.misses = _cacheMisses;
+	stats.evictions = _cacheEvictions;
+	stats.memorySize = _cacheMemorySize;
+	stats.numEntries = _cache.size();
+	return stats;
+}
+
+void ResourceLoader::prefetch(const Common::StringArray &filenames) {
+	Common::StackLock lock(_mutex);
+
+	for (Common::StringArray::const_iterator i = filenames.begin(); i != filenames.end(); ++i) {
+		Common::String fname = *i;
+		fname.toLowercase();
+		_prefetchQueue.push(fname);
+		_prefetchSignal.post();
+	}
+}
+
+void ResourceLoader::cancelPrefetch() {
+	Common::StackLock lock(_mutex);
+
+	_prefetchQueue.clear();
+}
+
+void ResourceLoader::processPrefetch() {
+	if (!_prefetchWorker.isRunning())
+		prefetchStep();
+}
+
+int ResourceLoader::prefetchThread(void *refCon) {
+	ResourceLoader *loader = (ResourceLoader *)refCon;
+
+	for (;;) {
+		// Posted once per queued file, and on quitting
+		loader->_prefetchSignal.wait();
+		{
+			Common::StackLock lock(loader->_mutex);
+			if (loader->_prefetchQuit)
+				break;
+		}
+		loader->prefetchStep();
+	}
+	return 0;
+}
+
+bool ResourceLoader::prefetchStep() {
+	Common::String fname;
+	{
+		Common::StackLock lock(_mutex);
+		if (_prefetchQueue.empty())
+			return false;
+		fname = _prefetchQueue.pop();
+		if (_cache.contains(fname))
+			return true;
+	}
+
+	const LabIndexEntry *e = getIndexEntry(fname);
+	if (!e)
+		return true;
+	// Without a worker there are no handles of our own, and the shared
+	// one is used on the main thread
+	const Lab *l = e->lab;
+	Block *b = l->getFileBlock(fname, e->entry, _prefetchFiles.getVal(l->getFileName(), NULL));
+	if (!b)
+		return true;
+
+	int len;
+	char *data = NULL;
+	if (fname.hasSuffix(".bm") || fname.hasSuffix(".zbm"))
+		data = BitmapData::uncompressCodec3(b->getData(), b->getLen(), len);
+	if (data) {
+		delete b;
+		b = new Block(data, len);
+	} else if (l->isMapped()) {
+		// Blocks of a memory mapped LAB are views, touch their pages so
+		// that the main thread does not take the page faults.
+		volatile char sum = 0;
+		for (int i = 0; i < b->getLen(); i += 4096)
+			sum += b->getData()[i];
+	}
+
+	Common::StackLock lock(_mutex);
+	if (_cache.contains(fname)) {
+		// The main thread loaded it in the meantime
+		delete b;
+		return true;
+	}
+	putIntoCache(fname, b);
+	return true;
 }
 
 Bitmap *ResourceLoader::loadBitmap(const Common::String &filename) {
@@ -342,7 +595,7 @@ Material *ResourceLoader::loadMaterial(const Common::String &filename, CMap *c)
 		b = getFileBlock(fname);
 		if (!b)
 			error("Could not find material %s", filename.c_str());
-		putIntoCache(filename, b);
+		putIntoCache(fname, b);
 	}
 
 	Material *result = new Material(fname, b->getData(), b->getLen(), c);
@@ -367,23 +620,11 @@ Model *ResourceLoader::loadModel(const Common::String &filename, CMap *c, Model
 }
 
 void ResourceLoader::uncache(const char *filename) {
-	Common::String fname = filename;
-	fname.toLowercase();
+	Common::StackLock lock(_mutex);
 
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
-	}
-
-	for (unsigned int i = 0; i < _cache.size(); i++) {
-		if (fname.compareTo(_cache[i].fname) == 0) {
-			delete[] _cache[i].fname;
-			_cacheMemorySize -= _cache[i].resPtr->getLen();
-			delete _cache[i].resPtr;
-			_cache.remove_at(i);
-			_cacheDirty = true;
-		}
-	}
+	CacheMap::iterator i = _cache.find(filename);
+	if (i != _cache.end())
+		removeFromCache(i->_value);
 }
 
 void ResourceLoader::uncacheModel(Model *m) {
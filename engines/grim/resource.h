@@ -25,8 +25,15 @@
 
 #include "common/archive.h"
 #include "common/file.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/mutex.h"
+#include "common/queue.h"
+#include "common/str-array.h"
+#include "common/thread.h"
 
 #include "engines/grim/object.h"
+#include "engines/grim/lab.h"
 
 namespace Grim {
 
@@ -40,9 +47,7 @@ class Model;
 class LipSync;
 class TrackedObject;
 class SaveGame;
-class Block;
 class LuaFile;
-class Lab;
 
 typedef ObjectPtr<Material> MaterialPtr;
 typedef ObjectPtr<Bitmap> BitmapPtr;
@@ -73,6 +78,16 @@ public:
 	void uncache(const char *fname);
 	bool getFileExists(const Common::String &filename) const;
 	int getFileLength(const char *filename) const;
+	/**
+	 * Find the archive a file is read from and its place in it, e.g. to
+	 * key data derived from the file. Returns false if no LAB has it.
+	 */
+	bool getLabEntry(const Common::String &filename, Common::String &labName, int &offset, int &len) const;
+	/**
+	 * Add the names of all files in the LABs matching pattern (e.g. "*.bm")
+	 * to result.
+	 */
+	void listFiles(Common::StringArray &result, const Common::String &pattern) const;
 
 	ModelPtr getModel(const Common::String &fname, CMap *c);
 	CMapPtr getColormap(const Common::String &fname);
@@ -83,24 +98,98 @@ public:
 	void uncacheKeyframe(KeyframeAnim *kf);
 	void uncacheLipSync(LipSync *l);
 
+	/**
+	 * Set the upper bound, in bytes, for the raw resource blocks kept in
+	 * the cache. A budget of 0 disables the limit.
+	 */
+	void setCacheBudget(uint32 bytes) { _cacheBudget = bytes; }
+	/**
+	 * Drop least recently used blocks until the cache fits its budget.
+	 * Blocks may still be referenced while resources are being parsed,
+	 * so this must only be called between frames.
+	 */
+	void trimCache();
+
+	/**
+	 * Queue resource files to be read into the cache ahead of their load
+	 * functions, e.g. everything referenced by a set or a costume. The
+	 * names are LAB file names as used by the load functions. Codec 3
+	 * bitmaps are cached decompressed.
+	 *
+	 * The files are read on a worker thread when the backend has threads,
+	 * otherwise one file per frame is read by processPrefetch().
+	 */
+	void prefetch(const Common::StringArray &filenames);
+	void cancelPrefetch();
+	/**
+	 * Read one queued file on the main thread when there is no worker.
+	 * Must only be called between frames.
+	 */
+	void processPrefetch();
+
+	struct CacheStats {
+		uint32 hits;
+		uint32 misses;
+		uint32 evictions;
+		uint32 memorySize;
+		uint32 numEntries;
+	};
+	CacheStats getCacheStats() const;
+
+private:
+	struct ResourceCache;
+	typedef Common::List<ResourceCache *> CacheList;
+	typedef Common::HashMap<Common::String, ResourceCache *, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> CacheMap;
+
 	struct ResourceCache {
-		char *fname;
+		Common::String fname;
 		Block *resPtr;
+		CacheList::iterator lruPos;
 	};
 
-private:
-	const Lab *getLab(const Common::String &filename) const;
+	struct LabIndexEntry {
+		Lab *lab;
+		Lab::LabEntry entry;
+	};
+
+	const LabIndexEntry *getIndexEntry(const Common::String &filename) const;
+	void buildLabIndex();
+	void saveLabIndex(const Common::Array<Lab *> &labs) const;
 	Block *getFileFromCache(const Common::String &filename);
-	ResourceLoader::ResourceCache *getEntryFromCache(const Common::String &filename);
+	ResourceCache *getEntryFromCache(const Common::String &filename);
 	void putIntoCache(const Common::String &fname, Block *res);
+	void removeFromCache(ResourceCache *entry);
+
+	static int prefetchThread(void *refCon);
+	bool prefetchStep();
 
 	typedef Common::List<Lab *> LabList;
 	LabList _labs;
 	Common::SearchSet _files;
-
-	Common::Array<ResourceCache> _cache;
-	bool _cacheDirty;
-	int32 _cacheMemorySize;
+	// Maps every file name to its entry in the first archive in _labs
+	// containing it
+	typedef Common::HashMap<Common::String, LabIndexEntry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> LabIndex;
+	LabIndex _labIndex;
+
+	// Most recently used entries are at the front of _cacheLru
+	CacheMap _cache;
+	CacheList _cacheLru;
+	uint32 _cacheMemorySize;
+	uint32 _cacheBudget;
+	uint32 _cacheHits;
+	uint32 _cacheMisses;
+	uint32 _cacheEvictions;
+
+	// Guards the cache and the prefetch queue against the prefetch thread.
+	// The thread reads through its own handles on the archives, no file
+	// is read while holding it.
+	Common::Mutex _mutex;
+	Common::Queue<Common::String> _prefetchQueue;
+	Common::Semaphore _prefetchSignal;
+	Common::Thread _prefetchWorker;
+	bool _prefetchQuit;
+	typedef Common::HashMap<Common::String, Common::File *, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> PrefetchFiles;
+	PrefetchFiles _prefetchFiles;
 
 	Common::List<Model *> _models;
 	Common::List<CMap *> _colormaps;
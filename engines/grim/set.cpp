@@ -106,6 +106,7 @@ void Set::loadText(TextSplitter &ts){
 
 	ts.expectString("section: setups");
 	ts.scanString(" numsetups %d", 1, &_numSetups);
+	prefetchSetups(ts);
 	_setups = new Setup[_numSetups];
 	for (int i = 0; i < _numSetups; i++)
 		_setups[i].load(ts);
@@ -353,6 +354,27 @@ bool Set::restoreState(SaveGame *savedState) {
 	return true;
 }
 
+// Queue the bitmaps of all setups to be decoded by the resource loader
+// while the set is being loaded. They are queued last one first: the
+// setups are loaded from the first one on, so the two meet in the middle
+// rather than working on the same bitmap.
+void Set::prefetchSetups(TextSplitter &ts) {
+	Common::StringArray names;
+	char buf[256];
+
+	int setupsStart = ts.getLineNumber();
+	while (!ts.isEof() && !ts.checkString("section:")) {
+		const char *line = ts.getCurrentLine();
+		if (sscanf(line, " background %255s", buf) == 1 ||
+			(sscanf(line, " zbuffer %255s", buf) == 1 && strcmp(buf, "<none>.lbm") != 0))
+			names.insert_at(0, buf);
+		ts.nextLine();
+	}
+	ts.setLineNumber(setupsStart);
+
+	g_resourceloader->prefetch(names);
+}
+
 void Set::Setup::load(TextSplitter &ts) {
 	char buf[256];
 
@@ -45,6 +45,7 @@ public:
 	~Set();
 
 	void loadText(TextSplitter &ts);
+	void prefetchSetups(TextSplitter &ts);
 	void loadBinary(Common::MemoryReadStream *ms);
 
 	void saveState(SaveGame *savedState) const;
@@ -35,6 +35,7 @@ MODULE_OBJS := \
 	tinygl/zline.o \
 	tinygl/zmath.o \
 	tinygl/ztriangle.o \
+	tinygl/ztriangle_bin.o \
 	tinygl/ztriangle_shadow.o
 
 # Include common rules
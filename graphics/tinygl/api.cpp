@@ -585,7 +585,8 @@ void tglCallList(unsigned int list) {
 }
 
 void tglFlush() {
-	// nothing to do
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	TinyGL::ZB_flushTriangles(c->zb);
 }
 
 void tglHint(int target, int mode) {
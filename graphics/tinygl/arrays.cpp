@@ -8,10 +8,9 @@
 
 namespace TinyGL {
 
-void glopArrayElement(GLContext *c, GLParam *param) {
+static void gl_array_element(GLContext *c, int idx) {
 	int i;
 	int states = c->client_states;
-	int idx = param[1].i;
 
 	if (states & COLOR_ARRAY) {
 		GLParam p[5];
@@ -28,7 +27,7 @@ void glopArrayElement(GLContext *c, GLParam *param) {
 		c->current_normal.X = c->normal_array[i];
 		c->current_normal.Y = c->normal_array[i + 1];
 		c->current_normal.Z = c->normal_array[i + 2];
-		c->current_normal.Z = 0.0f;
+		c->current_normal.W = 0.0f;
 	}
 	if (states & TEXCOORD_ARRAY) {
 		int size = c->texcoord_array_size;
@@ -46,24 +45,100 @@ void glopArrayElement(GLContext *c, GLParam *param) {
 		p[2].f = c->vertex_array[i + 1];
 		p[3].f = size > 2 ? c->vertex_array[i+2] : 0.0f;
 		p[4].f = size > 3 ? c->vertex_array[i+3] : 1.0f;
-		glopVertex(c, p);
+		// colors are not cached, they change the lighting material
+		if (idx >= c->vertex_cache_first && idx < c->vertex_cache_first + c->vertex_cache_count &&
+				!(states & COLOR_ARRAY))
+			gl_vertex_cached(c, p, idx);
+		else
+			glopVertex(c, p);
 	}
 }
 
-void glArrayElement(TGLint i) {
-	GLParam p[2];
-	p[0].op = OP_ArrayElement;
-	p[1].i = i;
-	gl_add_op(p);
+void glopArrayElement(GLContext *c, GLParam *param) {
+	gl_array_element(c, param[1].i);
+}
+
+void glopDrawElements(GLContext *c, GLParam *p) {
+	GLParam q[2];
+	int count = p[2].i;
+	unsigned int *indices = (unsigned int *)p[3].p;
+
+	q[1].i = p[1].i;
+	glopBegin(c, q);
+	for (int i = 0; i < count; i++)
+		gl_array_element(c, indices[i]);
+	glopEnd(c, q);
+}
+
+// While the arrays are locked each element in [first, first + count) is
+// transformed and lit only once, however many primitives use it. The
+// arrays, the matrices and the lighting state must not change until
+// they are unlocked.
+void glopLockArrays(GLContext *c, GLParam *p) {
+	int first = p[1].i;
+	int count = p[2].i;
+
+	if (count > c->vertex_cache_size) {
+		gl_free(c->vertex_cache);
+		gl_free(c->vertex_cache_valid);
+		c->vertex_cache = (GLVertex *)gl_malloc(sizeof(GLVertex) * count);
+		c->vertex_cache_valid = (unsigned char *)gl_malloc(count);
+		if (!c->vertex_cache || !c->vertex_cache_valid)
+			error("unable to allocate vertex cache.");
+		c->vertex_cache_size = count;
+	}
+	memset(c->vertex_cache_valid, 0, count);
+	c->vertex_cache_first = first;
+	c->vertex_cache_count = count;
+}
+
+void glopUnlockArrays(GLContext *c, GLParam *) {
+	c->vertex_cache_count = 0;
 }
 
 void glopEnableClientState(GLContext *c, GLParam *p) {
 	c->client_states |= p[1].i;
 }
 
-void glEnableClientState(TGLenum array) {
-	GLParam p[2];
-	p[0].op = OP_EnableClientState;
+void glopDisableClientState(GLContext *c, GLParam *p) {
+	c->client_states &= p[1].i;
+}
+
+void glopVertexPointer(GLContext *c, GLParam *p) {
+	c->vertex_array_size = p[1].i;
+	c->vertex_array_stride = p[2].i;
+	c->vertex_array = (float *)p[3].p;
+}
+
+void glopColorPointer(GLContext *c, GLParam *p) {
+	c->color_array_size = p[1].i;
+	c->color_array_stride = p[2].i;
+	c->color_array = (float *)p[3].p;  
+}
+
+void glopNormalPointer(GLContext *c, GLParam *p) {
+	c->normal_array_stride = p[1].i;
+	c->normal_array = (float *)p[2].p;
+}
+
+void glopTexCoordPointer(GLContext *c, GLParam *p) {
+	c->texcoord_array_size = p[1].i;
+	c->texcoord_array_stride = p[2].i;
+	c->texcoord_array = (float *)p[3].p;
+}
+
+} // end of namespace TinyGL
+
+void tglArrayElement(TGLint i) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_ArrayElement;
+	p[1].i = i;
+	TinyGL::gl_add_op(p);
+}
+
+void tglEnableClientState(TGLenum array) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_EnableClientState;
 
 	switch(array) {
 	case TGL_VERTEX_ARRAY:
@@ -82,16 +157,12 @@ void glEnableClientState(TGLenum array) {
 		assert(0);
 		break;
 	}
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopDisableClientState(GLContext *c, GLParam *p) {
-	c->client_states &= p[1].i;
-}
-
-void glDisableClientState(TGLenum array) {
-	GLParam p[2];
-	p[0].op = OP_DisableClientState;
+void tglDisableClientState(TGLenum array) {
+	TinyGL::GLParam p[2];
+	p[0].op = TinyGL::OP_DisableClientState;
     
 	switch(array) {
 	case TGL_VERTEX_ARRAY:
@@ -110,69 +181,68 @@ void glDisableClientState(TGLenum array) {
 		assert(0);
 		break;
 	}
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopVertexPointer(GLContext *c, GLParam *p) {
-	c->vertex_array_size = p[1].i;
-	c->vertex_array_stride = p[2].i;
-	c->vertex_array = (float *)p[3].p;
-}
-
-void  glVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_VertexPointer;
+	p[0].op = TinyGL::OP_VertexPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
-}
-
-void glopColorPointer(GLContext *c, GLParam *p) {
-	c->color_array_size = p[1].i;
-	c->color_array_stride = p[2].i;
-	c->color_array = (float *)p[3].p;  
+	TinyGL::gl_add_op(p);
 }
 
-void  glColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_ColorPointer;
+	p[0].op = TinyGL::OP_ColorPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
-}
-
-void glopNormalPointer(GLContext *c, GLParam *p) {
-	c->normal_array_stride = p[1].i;
-	c->normal_array = (float *)p[2].p;
+	TinyGL::gl_add_op(p);
 }
 
-void glNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[3];
+void tglNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[3];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_NormalPointer;
+	p[0].op = TinyGL::OP_NormalPointer;
 	p[1].i = stride;
 	p[2].p = const_cast<void *>(pointer);
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-void glopTexCoordPointer(GLContext *c, GLParam *p) {
-	c->texcoord_array_size = p[1].i;
-	c->texcoord_array_stride = p[2].i;
-	c->texcoord_array = (float *)p[3].p;
-}
-
-void glTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
-	GLParam p[4];
+void tglTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer) {
+	TinyGL::GLParam p[4];
 	assert(type == TGL_FLOAT);
-	p[0].op = OP_TexCoordPointer;
+	p[0].op = TinyGL::OP_TexCoordPointer;
 	p[1].i = size;
 	p[2].i = stride;
 	p[3].p = const_cast<void *>(pointer);
-	gl_add_op(p);
+	TinyGL::gl_add_op(p);
 }
 
-} // end of namespace TinyGL
+void tglDrawElements(TGLenum mode, TGLsizei count, TGLenum type, const TGLvoid *indices) {
+	TinyGL::GLParam p[4];
+	assert(type == TGL_UNSIGNED_INT);
+	p[0].op = TinyGL::OP_DrawElements;
+	p[1].i = mode;
+	p[2].i = count;
+	p[3].p = const_cast<void *>(indices);
+	TinyGL::gl_add_op(p);
+}
+
+void tglLockArrays(TGLint first, TGLsizei count) {
+	TinyGL::GLParam p[3];
+	p[0].op = TinyGL::OP_LockArrays;
+	p[1].i = first;
+	p[2].i = count;
+	TinyGL::gl_add_op(p);
+}
+
+void tglUnlockArrays() {
+	TinyGL::GLParam p[1];
+	p[0].op = TinyGL::OP_UnlockArrays;
+	TinyGL::gl_add_op(p);
+}
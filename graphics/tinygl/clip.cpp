@@ -3,9 +3,6 @@
 
 namespace TinyGL {
 
-// fill triangle profile
-// #define TINYGL_PROFILE
-
 #define CLIP_XMIN	(1 << 0)
 #define CLIP_XMAX	(1 << 1)
 #define CLIP_YMIN	(1 << 2)
@@ -66,6 +63,7 @@ void gl_draw_point(GLContext *c, GLVertex *p0) {
 		if (c->render_mode == TGL_SELECT) {
 			gl_add_select(c,p0->zp.z,p0->zp.z);
 		} else {
+			ZB_addDamage(c->zb, &p0->zp);
 			ZB_plot(c->zb,&p0->zp);
 		}
 	}
@@ -122,6 +120,8 @@ void gl_draw_line(GLContext *c, GLVertex *p1, GLVertex *p2) {
 		if (c->render_mode == TGL_SELECT) {
 			gl_add_select1(c,p1->zp.z,p2->zp.z,p2->zp.z);
 	} else {
+		ZB_addDamage(c->zb, &p1->zp);
+		ZB_addDamage(c->zb, &p2->zp);
 		if (c->depth_test)
 			ZB_line_z(c->zb,&p1->zp,&p2->zp);
 		else
@@ -152,6 +152,8 @@ void gl_draw_line(GLContext *c, GLVertex *p1, GLVertex *p2) {
 			gl_transform_to_viewport(c,&q1);
 			gl_transform_to_viewport(c,&q2);
 
+			ZB_addDamage(c->zb, &q1.zp);
+			ZB_addDamage(c->zb, &q2.zp);
 			if (c->depth_test)
 				ZB_line_z(c->zb,&q1.zp,&q2.zp);
 			else
@@ -365,50 +367,56 @@ void gl_draw_triangle_select(GLContext *c, GLVertex *p0, GLVertex *p1,GLVertex *
 	gl_add_select1(c, p0->zp.z, p1->zp.z, p2->zp.z);
 }
 
-#ifdef TINYGL_PROFILE
-int count_triangles, count_triangles_textured, count_pixels;
-#endif
-
 void gl_draw_triangle_fill(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2) {
-#ifdef TINYGL_PROFILE
-	{
-		int norm;
-		assert(p0->zp.x >= 0 && p0->zp.x < c->zb->xsize);
-		assert(p0->zp.y >= 0 && p0->zp.y < c->zb->ysize);
-		assert(p1->zp.x >= 0 && p1->zp.x < c->zb->xsize);
-		assert(p1->zp.y >= 0 && p1->zp.y < c->zb->ysize);
-		assert(p2->zp.x >= 0 && p2->zp.x < c->zb->xsize);
-		assert(p2->zp.y >= 0 && p2->zp.y < c->zb->ysize);
-
-		norm = (p1->zp.x - p0->zp.x) * (p2->zp.y - p0->zp.y) -
-				(p2->zp.x - p0->zp.x) * (p1->zp.y - p0->zp.y);
-		count_pixels += abs(norm) / 2;
-		count_triangles++;
-	}
-#endif
-    
+	ZB_fillTriangleFunc fill;
+	int filler;
+
 	if (c->shadow_mode & 1) {
 		assert(c->zb->shadow_mask_buf);
-		ZB_fillTriangleFlatShadowMask(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleFlatShadowMask;
+		filler = TGL_FILL_FLAT_SHADOW_MASK;
 	} else if (c->shadow_mode & 2) {
 		assert(c->zb->shadow_mask_buf);
-		ZB_fillTriangleFlatShadow(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleFlatShadow;
+		filler = TGL_FILL_FLAT_SHADOW;
 	} else if (c->texture_2d_enabled) {
-#ifdef TINYGL_PROFILE
-		count_triangles_textured++;
-#endif
-		ZB_setTexture(c->zb, (PIXEL *)c->current_texture->images[0].pixmap);
-		ZB_fillTriangleMappingPerspective(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_setTexture(c->zb, &c->current_texture->images[0].zbtex);
+		fill = ZB_fillTriangleMappingPerspective;
+		filler = TGL_FILL_MAPPING_PERSPECTIVE;
 	} else if (c->current_shade_model == TGL_SMOOTH) {
-		ZB_fillTriangleSmooth(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleSmooth;
+		filler = TGL_FILL_SMOOTH;
 	} else {
-		ZB_fillTriangleFlat(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		fill = ZB_fillTriangleFlat;
+		filler = TGL_FILL_FLAT;
+	}
+
+	if (c->fill_stats) {
+		int area = (p1->zp.x - p0->zp.x) * (p2->zp.y - p0->zp.y) -
+				   (p2->zp.x - p0->zp.x) * (p1->zp.y - p0->zp.y);
+		c->fill_triangles[filler]++;
+		c->fill_pixels[filler] += abs(area) / 2;
 	}
+
+	// the shadow mask is not part of the frame
+	if (!(c->shadow_mode & 1)) {
+		ZB_addDamage(c->zb, &p0->zp);
+		ZB_addDamage(c->zb, &p1->zp);
+		ZB_addDamage(c->zb, &p2->zp);
+	}
+
+	if (c->zb->binning)
+		ZB_binTriangle(c->zb, fill, &p0->zp, &p1->zp, &p2->zp);
+	else
+		fill(c->zb, &p0->zp, &p1->zp, &p2->zp);
 }
 
 // Render a clipped triangle in line mode
 
 void gl_draw_triangle_line(GLContext *c, GLVertex *p0, GLVertex *p1,GLVertex *p2) {
+	ZB_addDamage(c->zb, &p0->zp);
+	ZB_addDamage(c->zb, &p1->zp);
+	ZB_addDamage(c->zb, &p2->zp);
 	if (c->depth_test) {
 		if (p0->edge_flag)
 			ZB_line_z(c->zb, &p0->zp, &p1->zp);
@@ -428,6 +436,9 @@ void gl_draw_triangle_line(GLContext *c, GLVertex *p0, GLVertex *p1,GLVertex *p2
 
 // Render a clipped triangle in point mode
 void gl_draw_triangle_point(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2) {
+	ZB_addDamage(c->zb, &p0->zp);
+	ZB_addDamage(c->zb, &p1->zp);
+	ZB_addDamage(c->zb, &p2->zp);
 	if (p0->edge_flag)
 		ZB_plot(c->zb, &p0->zp);
 	if (p1->edge_flag)
@@ -437,3 +448,17 @@ void gl_draw_triangle_point(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *
 }
 
 } // end of namespace TinyGL
+
+void tglGetFillStats(unsigned int *triangles, unsigned int *pixels) {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	for (int i = 0; i < TGL_FILL_COUNT; i++) {
+		triangles[i] = c->fill_triangles[i];
+		pixels[i] = c->fill_pixels[i];
+	}
+}
+
+void tglResetFillStats() {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	memset(c->fill_triangles, 0, sizeof(c->fill_triangles));
+	memset(c->fill_pixels, 0, sizeof(c->fill_pixels));
+}
@@ -127,6 +127,17 @@ enum {
 	TGL_POLYGON_OFFSET_FILL			= 0x8037,
 	TGL_SHADOW_MASK_MODE			= 0x0C40,
 	TGL_SHADOW_MODE					= 0x0C41,
+	// Defer filled triangles and rasterize them in screen bands on
+	// tglFlush() or when disabled
+	TGL_TRIANGLE_BINNING			= 0x0C42,
+	// Store the textures given to glTexImage2D in tiles
+	TGL_TEXTURE_TILING				= 0x0C43,
+	// Texture parameter naming the 256x1 texture a TGL_COLOR_INDEX
+	// texture takes its colors from. It is looked up when set and when
+	// the texture is bound.
+	TGL_TEXTURE_PALETTE				= 0x0C44,
+	// Count the triangles and pixels of each filler, see tglGetFillStats
+	TGL_FILL_STATS					= 0x0C45,
 
 	// Display Lists
 	TGL_COMPILE						= 0x1300,
@@ -788,6 +799,21 @@ void tglFrontFace(int mode);
 void tglSetShadowMaskBuf(unsigned char *buf);
 void tglSetShadowColor(unsigned char r, unsigned char g, unsigned char b);
 
+// triangle fillers, as counted by tglGetFillStats
+enum {
+	TGL_FILL_FLAT,
+	TGL_FILL_SMOOTH,
+	TGL_FILL_MAPPING_PERSPECTIVE,
+	TGL_FILL_FLAT_SHADOW_MASK,
+	TGL_FILL_FLAT_SHADOW,
+	TGL_FILL_COUNT
+};
+
+// triangles drawn and pixels covered by each filler since the last reset,
+// TGL_FILL_COUNT entries each. Only counted while TGL_FILL_STATS is enabled.
+void tglGetFillStats(unsigned int *triangles, unsigned int *pixels);
+void tglResetFillStats();
+
 // opengl 1.2 arrays
 void tglEnableClientState(TGLenum array);
 void tglDisableClientState(TGLenum array);
@@ -796,6 +822,11 @@ void tglVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid
 void tglColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer);
 void tglNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer);
 void tglTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer);
+void tglDrawElements(TGLenum mode, TGLsizei count, TGLenum type, const TGLvoid *indices);
+
+// compiled vertex arrays: locked elements are transformed and lit once
+void tglLockArrays(TGLint first, TGLsizei count);
+void tglUnlockArrays();
 
 // opengl 1.2 polygon offset
 void tglPolygonOffset(TGLfloat factor, TGLfloat units);
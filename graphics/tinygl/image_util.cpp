@@ -26,6 +26,29 @@ void gl_convertRGB_to_5R6G5B8A(unsigned short *pixmap, unsigned char *rgba, int
 	}
 }
 
+// Reorders an image of pixel_size bytes per texel into the tiles of
+// ZB_texelIndex. xsize and ysize must be powers of two of at least
+// 1 << ZB_TILE_BITS.
+void gl_tileImage(unsigned char *dest, const unsigned char *src, int xsize, int ysize, int pixel_size) {
+	ZBufferTexture tex;
+	int x, y;
+
+	tex.s_shift = 0;
+	tex.t_shift = 0;
+	tex.s_mask = xsize - 1;
+	tex.t_mask = ysize - 1;
+	tex.w_bits = 0;
+	while ((1 << tex.w_bits) < xsize)
+		tex.w_bits++;
+	tex.tiled = 1;
+	for (y = 0; y < ysize; y++) {
+		for (x = 0; x < xsize; x++) {
+			memcpy(dest + ZB_texelIndex(&tex, x, y) * pixel_size, src, pixel_size);
+			src += pixel_size;
+		}
+	}
+}
+
 // linear interpolation with xf, yf normalized to 2^16
 
 #define INTERP_NORM_BITS  16
@@ -143,4 +166,25 @@ void gl_resizeImageNoInterpolate(unsigned char *dest, int xsize_dest, int ysize_
 	}
 }
 
+// nearest pixel resizing of a color index image, indexes can't be blended
+void gl_resizeImageIndex(unsigned char *dest, int xsize_dest, int ysize_dest,
+                         const unsigned char *src, int xsize_src, int ysize_src) {
+	int x1, y1, x1inc, y1inc;
+	int x, y;
+
+	x1inc = (int)((float)((xsize_src) << FRAC_BITS) / (float)(xsize_dest));
+	y1inc = (int)((float)((ysize_src) << FRAC_BITS) / (float)(ysize_dest));
+
+	y1 = 0;
+	for (y = 0; y < ysize_dest; y++) {
+		const unsigned char *line = src + (y1 >> FRAC_BITS) * xsize_src;
+		x1 = 0;
+		for (x = 0; x < xsize_dest; x++) {
+			*dest++ = line[x1 >> FRAC_BITS];
+			x1 += x1inc;
+		}
+		y1 += y1inc;
+	}
+}
+
 } // end of namespace TinyGL
@@ -162,6 +162,11 @@ void glInit(void *zbuffer1) {
 
 	// opengl 1.1 arrays
 	c->client_states = 0;
+	c->vertex_cache = NULL;
+	c->vertex_cache_valid = NULL;
+	c->vertex_cache_first = 0;
+	c->vertex_cache_count = 0;
+	c->vertex_cache_size = 0;
 
 	// opengl 1.1 polygon offset
 	c->offset_states = 0;
@@ -169,6 +174,11 @@ void glInit(void *zbuffer1) {
 	// shadow mode
 	c->shadow_mode = 0;
 
+	// filler statistics
+	c->fill_stats = 0;
+	memset(c->fill_triangles, 0, sizeof(c->fill_triangles));
+	memset(c->fill_pixels, 0, sizeof(c->fill_pixels));
+
 	// clear the resize callback function pointer
 	c->gl_resize_viewport = NULL;
 
@@ -184,6 +194,8 @@ void glInit(void *zbuffer1) {
 void glClose() {
 	GLContext *c = gl_get_context();
 	endSharedState(c);
+	gl_free(c->vertex_cache);
+	gl_free(c->vertex_cache_valid);
 	gl_free(c);
 }
 
@@ -91,6 +91,17 @@ void glopEnableDisable(GLContext *c, GLParam *p) {
 		else
 			c->shadow_mode &= ~2;
 		break; 
+	case TGL_TEXTURE_TILING:
+		c->texture_tiling = v;
+		break;
+	case TGL_TRIANGLE_BINNING:
+		if (!v)
+			ZB_flushTriangles(c->zb);
+		c->zb->binning = v;
+		break;
+	case TGL_FILL_STATS:
+		c->fill_stats = v;
+		break;
 	default:
 		if (code >= TGL_LIGHT0 && code < TGL_LIGHT0 + T_MAX_LIGHTS) {
 			gl_enable_disable_light(c, code - TGL_LIGHT0, v);
@@ -64,6 +64,11 @@ ADD_OP(VertexPointer, 4, "%d %C %d %p")
 ADD_OP(ColorPointer, 4, "%d %C %d %p")
 ADD_OP(NormalPointer, 3, "%C %d %p")
 ADD_OP(TexCoordPointer, 4, "%d %C %d %p")
+ADD_OP(DrawElements, 3, "%C %d %p")
+
+// opengl 1.1 compiled vertex array extension
+ADD_OP(LockArrays, 2, "%d %d")
+ADD_OP(UnlockArrays, 0, "")
 
 // opengl 1.1 polygon offset
 ADD_OP(PolygonOffset, 2, "%f %f")
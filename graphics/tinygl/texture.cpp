@@ -62,9 +62,30 @@ GLTexture *alloc_texture(GLContext *c, int h) {
 void glInitTextures(GLContext *c) {
 	// textures
 	c->texture_2d_enabled = 0;
+	c->texture_tiling = 0;
 	c->current_texture = find_texture(c, 0);
 }
 
+// Transparent colors for color index textures without a usable palette
+static const unsigned char black_palette[256 * 3] = { 0 };
+
+// Points the color index image of t at the texels of its palette texture
+static void update_palette(GLContext *c, GLTexture *t) {
+	GLImage *im = &t->images[0];
+	GLTexture *pal;
+	GLImage *pal_im;
+
+	if (!im->color_index)
+		return;
+	im->zbtex.palette = black_palette;
+	pal = t->palette ? find_texture(c, t->palette) : NULL;
+	if (!pal)
+		return;
+	pal_im = &pal->images[0];
+	if (pal_im->pixmap && !pal_im->color_index && !pal_im->zbtex.tiled && pal_im->xsize * pal_im->ysize >= 256)
+		im->zbtex.palette = (const unsigned char *)pal_im->pixmap;
+}
+
 void glopBindTexture(GLContext *c, GLParam *p) {
 	int target = p[1].i;
 	int texture = p[2].i;
@@ -76,9 +97,18 @@ void glopBindTexture(GLContext *c, GLParam *p) {
 	if (!t) {
 		t = alloc_texture(c, texture);
 	}
+	update_palette(c, t);
 	c->current_texture = t;
 }
 
+// Smallest power of two not below size, at most MAX_TEXTURE_SIZE
+static int texture_bits(int size) {
+	int bits = 0;
+	while ((1 << bits) < size && (1 << bits) < MAX_TEXTURE_SIZE)
+		bits++;
+	return bits;
+}
+
 void glopTexImage2D(GLContext *c, GLParam *p) {
 	int target = p[1].i;
 	int level = p[2].i;
@@ -90,24 +120,36 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 	int type = p[8].i;
 	void *pixels = p[9].p;
 	GLImage *im;
+	ZBufferTexture *tex;
 	unsigned char *pixels1;
-	int do_free;
+	int do_free, w_bits, h_bits, color_index, pixel_size;
 
-	if (!(target == TGL_TEXTURE_2D && level == 0 && components == 3 && border == 0
-				&& format == TGL_RGBA && type == TGL_UNSIGNED_BYTE)) {
+	color_index = format == TGL_COLOR_INDEX && components == 1;
+	if (!(target == TGL_TEXTURE_2D && level == 0 && border == 0 && type == TGL_UNSIGNED_BYTE
+				&& ((format == TGL_RGBA && components == 3) || color_index))) {
 		error("glTexImage2D: combination of parameters not handled");
 	}
+	pixel_size = color_index ? 1 : 3;
 
+	// Textures keep their size, only those that are not a power of two
+	// or too big are resampled.
+	w_bits = texture_bits(width);
+	h_bits = texture_bits(height);
 	do_free = 0;
-	if (width != 256 || height != 256) {
-		pixels1 = (unsigned char *)gl_malloc(256 * 256 * 4);
-		// no interpolation is done here to respect the original image aliasing !
-		//gl_resizeImageNoInterpolate(pixels1, 256, 256, (unsigned char *)pixels, width, height);
-		// used interpolation anyway, it look much better :) --- aquadran
-		gl_resizeImage(pixels1, 256, 256, (unsigned char *)pixels, width, height);
+	if (width != (1 << w_bits) || height != (1 << h_bits)) {
+		if (color_index) {
+			pixels1 = (unsigned char *)gl_malloc((1 << w_bits) * (1 << h_bits));
+			gl_resizeImageIndex(pixels1, 1 << w_bits, 1 << h_bits, (unsigned char *)pixels, width, height);
+		} else {
+			pixels1 = (unsigned char *)gl_malloc((1 << w_bits) * (1 << h_bits) * 4);
+			// no interpolation is done here to respect the original image aliasing !
+			//gl_resizeImageNoInterpolate(pixels1, 1 << w_bits, 1 << h_bits, (unsigned char *)pixels, width, height);
+			// used interpolation anyway, it look much better :) --- aquadran
+			gl_resizeImage(pixels1, 1 << w_bits, 1 << h_bits, (unsigned char *)pixels, width, height);
+		}
 		do_free = 1;
-		width = 256;
-		height = 256;
+		width = 1 << w_bits;
+		height = 1 << h_bits;
 	} else {
 		pixels1 = (unsigned char *)pixels;
 	}
@@ -115,13 +157,35 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 	im = &c->current_texture->images[level];
 	im->xsize = width;
 	im->ysize = height;
+	im->color_index = color_index;
 	if (im->pixmap)
 		gl_free(im->pixmap);
-	im->pixmap = gl_malloc(width * height * 3);
-	if (im->pixmap)
-		gl_convertRGB_to_5R6G5B8A((unsigned short *)im->pixmap, pixels1, width, height);
+	im->pixmap = gl_malloc(width * height * pixel_size);
+	if (im->pixmap) {
+		if (color_index)
+			memcpy(im->pixmap, pixels1, width * height);
+		else
+			gl_convertRGB_to_5R6G5B8A((unsigned short *)im->pixmap, pixels1, width, height);
+	}
 	if (do_free)
 		gl_free(pixels1);
+
+	tex = &im->zbtex;
+	tex->palette = NULL;
+	tex->s_shift = ZB_POINT_ST_BITS - w_bits;
+	tex->t_shift = ZB_POINT_ST_BITS - h_bits;
+	tex->s_mask = width - 1;
+	tex->t_mask = height - 1;
+	tex->w_bits = w_bits;
+	tex->tiled = c->texture_tiling && w_bits >= ZB_TILE_BITS && h_bits >= ZB_TILE_BITS;
+	if (tex->tiled && im->pixmap) {
+		unsigned char *tiled = (unsigned char *)gl_malloc(width * height * pixel_size);
+		gl_tileImage(tiled, (unsigned char *)im->pixmap, width, height, pixel_size);
+		gl_free(im->pixmap);
+		im->pixmap = tiled;
+	}
+	tex->pixmap = (unsigned char *)im->pixmap;
+	update_palette(c, c->current_texture);
 }
 
 // TODO: not all tests are done
@@ -143,7 +207,7 @@ error:
 }
 
 // TODO: not all tests are done
-void glopTexParameter(GLContext *, GLParam *p) {
+void glopTexParameter(GLContext *c, GLParam *p) {
 	int target = p[1].i;
 	int pname = p[2].i;
 	int param = p[3].i;
@@ -159,6 +223,10 @@ error:
 		if (param != TGL_REPEAT)
 			goto error;
 		break;
+	case TGL_TEXTURE_PALETTE:
+		c->current_texture->palette = param;
+		update_palette(c, c->current_texture);
+		break;
 	default:
 		;
 	}
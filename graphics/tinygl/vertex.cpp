@@ -188,16 +188,9 @@ static inline void gl_vertex_transform(GLContext *c, GLVertex *v) {
 	v->clip_code = gl_clipcode(v->pc.X, v->pc.Y, v->pc.Z, v->pc.W);
 }
 
-void glopVertex(GLContext *c, GLParam *p) {
-	GLVertex *v;
-	int n, i, cnt;
-
-	assert(c->in_begin != 0);
-
-	n = c->vertex_n;
-	cnt = c->vertex_cnt;
-	cnt++;
-	c->vertex_cnt = cnt;
+// returns the slot of the next vertex of the current primitive
+static GLVertex *gl_vertex_slot(GLContext *c) {
+	int n = c->vertex_n;
 
 	// quick fix to avoid crashes on large polygons
 	if (n >= c->vertex_max) {
@@ -211,27 +204,10 @@ void glopVertex(GLContext *c, GLParam *p) {
 		gl_free(c->vertex);
 		c->vertex = newarray;
 	}
-	// new vertex entry
-	v = &c->vertex[n];
-	n++;
-
-	v->coord.X = p[1].f;
-	v->coord.Y = p[2].f;
-	v->coord.Z = p[3].f;
-	v->coord.W = p[4].f;
-
-	gl_vertex_transform(c, v);
-
-	// color
-
-	if (c->lighting_enabled) {
-		gl_shade_vertex(c, v);
-	} else {
-		v->color = c->current_color;
-	}
-
-	// tex coords
+	return &c->vertex[n];
+}
 
+static inline void gl_vertex_tex_coord(GLContext *c, GLVertex *v) {
 	if (c->texture_2d_enabled) {
 		if (c->apply_texture_matrix) {
 			gl_M4_MulV4(&v->tex_coord, c->matrix_stack_ptr[2], &c->current_tex_coord);
@@ -239,13 +215,15 @@ void glopVertex(GLContext *c, GLParam *p) {
 			v->tex_coord = c->current_tex_coord;
 		}
 	}
-    // precompute the mapping to the viewport
-	if (v->clip_code == 0)
-		gl_transform_to_viewport(c, v);
+}
 
-    // edge flag
+// adds the vertex in the next slot to the current primitive
+static void gl_vertex_add(GLContext *c) {
+	int n, i, cnt;
 
-	v->edge_flag = c->current_edge_flag;
+	n = c->vertex_n + 1;
+	cnt = c->vertex_cnt + 1;
+	c->vertex_cnt = cnt;
 
 	switch (c->begin_type) {
 	case TGL_POINTS:
@@ -325,6 +303,83 @@ void glopVertex(GLContext *c, GLParam *p) {
 	c->vertex_n = n;
 }
 
+void glopVertex(GLContext *c, GLParam *p) {
+	GLVertex *v;
+
+	assert(c->in_begin != 0);
+
+	// new vertex entry
+	v = gl_vertex_slot(c);
+
+	v->coord.X = p[1].f;
+	v->coord.Y = p[2].f;
+	v->coord.Z = p[3].f;
+	v->coord.W = p[4].f;
+
+	gl_vertex_transform(c, v);
+
+	// color
+
+	if (c->lighting_enabled) {
+		gl_shade_vertex(c, v);
+	} else {
+		v->color = c->current_color;
+	}
+
+	// tex coords
+
+	gl_vertex_tex_coord(c, v);
+
+    // precompute the mapping to the viewport
+	if (v->clip_code == 0)
+		gl_transform_to_viewport(c, v);
+
+    // edge flag
+
+	v->edge_flag = c->current_edge_flag;
+
+	gl_vertex_add(c);
+}
+
+// Same as glopVertex for element idx of the locked arrays. The transformed
+// and lit vertex is taken from the cache, which is filled on first use.
+void gl_vertex_cached(GLContext *c, GLParam *p, int idx) {
+	GLVertex *v, *cv;
+	int i = idx - c->vertex_cache_first;
+
+	assert(c->in_begin != 0);
+
+	cv = &c->vertex_cache[i];
+	if (!c->vertex_cache_valid[i]) {
+		cv->coord.X = p[1].f;
+		cv->coord.Y = p[2].f;
+		cv->coord.Z = p[3].f;
+		cv->coord.W = p[4].f;
+
+		gl_vertex_transform(c, cv);
+
+		if (c->lighting_enabled)
+			gl_shade_vertex(c, cv);
+
+		c->vertex_cache_valid[i] = 1;
+	}
+
+	v = gl_vertex_slot(c);
+	*v = *cv;
+
+	if (!c->lighting_enabled)
+		v->color = c->current_color;
+
+	gl_vertex_tex_coord(c, v);
+
+	if (v->clip_code == 0)
+		gl_transform_to_viewport(c, v);
+
+	v->edge_flag = c->current_edge_flag;
+
+	gl_vertex_add(c);
+}
+
 void glopEnd(GLContext *c, GLParam *) {
 	assert(c->in_begin == 1);
 
@@ -2,8 +2,10 @@
 // Z buffer: 16,32 bits Z / 16 bits color
 
 #include "common/scummsys.h"
+#include "common/system.h"
 
 #include "graphics/tinygl/zbuffer.h"
+#include "graphics/tinygl/zspan.h"
 
 namespace TinyGL {
 
@@ -56,18 +58,55 @@ ZBuffer *ZB_open(int xsize, int ysize, int mode, void *frame_buffer) {
 	zb->current_texture = NULL;
 	zb->shadow_mask_buf = NULL;
 
+	zb->band_y0 = 0;
+	zb->band_y1 = zb->ysize;
+	zb->binning = 0;
+	zb->bin_triangles = NULL;
+	zb->bin_count = 0;
+	zb->bin_size = 0;
+	zb->band_threads = 0;
+	zb->band_pool = NULL;
+
+	zb->simd_spans = ZB_hasSimdSpans();
+	zb->track_damage = 0;
+
+	ZB_resetDamage(zb);
+
 	return zb;
 error:
 	gl_free(zb);
 	return NULL;
 }
 
+// Whether the span kernels can be used on this CPU. Every x86-64 CPU has
+// SSE2, and a NEON build only runs where NEON is present; a 32 bit build
+// compiled for SSE2 asks the backend, and falls back to the scalar fillers
+// when it can't tell.
+int ZB_hasSimdSpans() {
+#if !defined(TINYGL_SIMD_SPANS)
+	return 0;
+#elif defined(TINYGL_SIMD_NEON) || defined(__x86_64__) || defined(_M_X64)
+	return 1;
+#else
+	return g_system && g_system->hasFeature(OSystem::kFeatureCpuSSE2);
+#endif
+}
+
+void ZB_resetDamage(ZBuffer *zb) {
+	zb->damage_x1 = zb->xsize;
+	zb->damage_y1 = zb->ysize;
+	zb->damage_x2 = -1;
+	zb->damage_y2 = -1;
+}
+
 void ZB_close(ZBuffer *zb) {
     if (zb->frame_buffer_allocated)
 		gl_free(zb->pbuf);
 
     gl_free(zb->zbuf);
     gl_free(zb->zbuf2);
+    ZB_closeBandThreads(zb);
+    gl_free(zb->bin_triangles);
     gl_free(zb);
 }
 
@@ -77,9 +116,13 @@ void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize) {
 	// xsize must be a multiple of 4
 	xsize = xsize & ~3;
 
+	ZB_flushTriangles(zb);
+
 	zb->xsize = xsize;
 	zb->ysize = ysize;
 	zb->linesize = (xsize * PSZB + 3) & ~3;
+	zb->band_y0 = 0;
+	zb->band_y1 = ysize;
 
 	size = zb->xsize * zb->ysize * sizeof(unsigned short);
 
@@ -177,6 +220,8 @@ void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, in
 	int y;
 	PIXEL *pp;
 
+	ZB_flushTriangles(zb);
+
 	if (clear_z) {
 		memset_s(zb->zbuf, z, zb->xsize * zb->ysize);
 	}
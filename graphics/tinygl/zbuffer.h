@@ -14,6 +14,9 @@ namespace TinyGL {
 #define ZB_POINT_T_MIN ( (1 << 21) )
 #define ZB_POINT_T_MAX ( (1 << 30) - (1 << 21) )
 
+// s and t of the perspective mapping hold texture coordinates times 2^22
+#define ZB_POINT_ST_BITS 22
+
 #define ZB_POINT_RED_MIN ( (1 << 10) )
 #define ZB_POINT_RED_MAX ( (1 << 16) - (1 << 10) )
 #define ZB_POINT_GREEN_MIN ( (1 << 9) )
@@ -30,6 +33,48 @@ typedef unsigned short PIXEL;
 #define PSZB 2 
 #define PSZSH 4 
 
+// Height in scanlines of the bands binned triangles are rasterized in
+#define ZB_BAND_HEIGHT 32
+
+// Textures are stored with 3 bytes per texel: the 5R6G5B color followed
+// by an 8 bit alpha. Width and height are powers of two, so coordinates
+// wrap with a mask. Tiled textures keep each 4x4 block of texels in
+// consecutive bytes, so that spans crossing rows stay in cache.
+// Color index textures store one byte per texel and look the texel up in
+// the 256 entries of palette, which use the same 3 byte layout.
+#define ZB_TILE_BITS 2
+
+typedef struct {
+	unsigned char *pixmap;
+	const unsigned char *palette;	// NULL unless pixmap holds color indexes
+	int s_shift, t_shift;		// s >> s_shift is the texel column
+	unsigned int s_mask, t_mask;
+	int w_bits;					// log2 of the width
+	int tiled;
+} ZBufferTexture;
+
+// Index in pixmap of the texel at s, t (ZB_POINT_ST_BITS fixed point)
+static inline unsigned int ZB_texelIndex(const ZBufferTexture *tex, unsigned int s, unsigned int t) {
+	unsigned int x = (s >> tex->s_shift) & tex->s_mask;
+	unsigned int y = (t >> tex->t_shift) & tex->t_mask;
+	if (tex->tiled) {
+		const unsigned int m = (1 << ZB_TILE_BITS) - 1;
+		return ((y & ~m) << tex->w_bits) | ((x & ~m) << ZB_TILE_BITS) | ((y & m) << ZB_TILE_BITS) | (x & m);
+	}
+	return (y << tex->w_bits) | x;
+}
+
+// The 3 bytes of the texel at s, t
+static inline const unsigned char *ZB_texel(const ZBufferTexture *tex, unsigned int s, unsigned int t) {
+	unsigned int i = ZB_texelIndex(tex, s, t);
+	if (tex->palette)
+		return tex->palette + tex->pixmap[i] * 3;
+	return tex->pixmap + i * 3;
+}
+
+struct ZBufferTriangle;
+struct ZBufferBandPool;
+
 typedef struct {
 	int xsize, ysize;
 	int linesize; // line size, in bytes
@@ -46,7 +91,28 @@ typedef struct {
 
 	unsigned char *dctable;
 	int *ctable;
-	PIXEL *current_texture;
+	const ZBufferTexture *current_texture;
+
+	// scanlines [band_y0, band_y1) the triangle fillers may write to
+	int band_y0, band_y1;
+
+	// deferred triangles, see ZB_binTriangle
+	int binning;
+	ZBufferTriangle *bin_triangles;
+	int bin_count, bin_size;
+	// threads rasterizing the bands besides the caller of
+	// ZB_flushTriangles, see ZB_setBandThreads
+	int band_threads;
+	ZBufferBandPool *band_pool;
+
+	// use the 8 pixel span kernels of zspan.h, see ZB_hasSimdSpans
+	int simd_spans;
+
+	// bounds of the vertices drawn to pbuf since the last
+	// ZB_resetDamage, empty when damage_x1 > damage_x2. Only kept up to
+	// date while track_damage is set.
+	int track_damage;
+	int damage_x1, damage_y1, damage_x2, damage_y2;
 } ZBuffer;
 
 typedef struct {
@@ -57,6 +123,36 @@ typedef struct {
 	float sz,tz;   // temporary coordinates for mapping
 } ZBufferPoint;
 
+// Restrict the walk of the triangle fillers over the nb_lines scanlines of a
+// triangle part from line_y to the band: nb_lines is cut at the end of the
+// band, and the lines above it are removed from nb_lines and returned, for
+// the edges to be stepped over them at once. Of these lines nb_max take the
+// max step of the left edge, and error is updated as if they were walked.
+static inline int ZB_bandSkip(const ZBuffer *zb, int line_y, int *nb_lines,
+							  int *error, int derror, int *nb_max) {
+	int nb_skip;
+
+	if (*nb_lines > zb->band_y1 - line_y)
+		*nb_lines = zb->band_y1 - line_y;
+	if (*nb_lines <= 0 || line_y >= zb->band_y0)
+		return 0;
+
+	nb_skip = zb->band_y0 - line_y;
+	if (nb_skip > *nb_lines)
+		nb_skip = *nb_lines;
+	// the error stays in ]-0x10000, 0], going down by 0x10000 on every max step
+	*nb_max = (*error + nb_skip * derror + 0xffff) >> 16;
+	*error += nb_skip * derror - (*nb_max << 16);
+	*nb_lines -= nb_skip;
+	return nb_skip;
+}
+
+// Step an interpolated value of the left edge over skipped lines. Done modulo
+// 2^32 like the single steps, as the products alone may overflow.
+#define ZB_SKIP_EDGE(v, nb_min, dmin, nb_max, dmax) \
+	(v) = (int)((unsigned int)(v) + (unsigned int)(nb_min) * (unsigned int)(dmin) + \
+				(unsigned int)(nb_max) * (unsigned int)(dmax))
+
 // zbuffer.c
 
 ZBuffer *ZB_open(int xsize, int ysize, int mode, void *frame_buffer);
@@ -65,6 +161,21 @@ void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize);
 void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, int b);
 // linesize is in BYTES
 void ZB_copyFrameBuffer(ZBuffer *zb, void *buf, int linesize);
+int ZB_hasSimdSpans();
+void ZB_resetDamage(ZBuffer *zb);
+
+static inline void ZB_addDamage(ZBuffer *zb, const ZBufferPoint *p) {
+	if (!zb->track_damage)
+		return;
+	if (p->x < zb->damage_x1)
+		zb->damage_x1 = p->x;
+	if (p->x > zb->damage_x2)
+		zb->damage_x2 = p->x;
+	if (p->y < zb->damage_y1)
+		zb->damage_y1 = p->y;
+	if (p->y > zb->damage_y2)
+		zb->damage_y2 = p->y;
+}
 
 // zline.c
 
@@ -74,7 +185,7 @@ void ZB_line_z(ZBuffer * zb, ZBufferPoint * p1, ZBufferPoint * p2);
 
 // ztriangle.c */
 
-void ZB_setTexture(ZBuffer *zb, PIXEL *texture);
+void ZB_setTexture(ZBuffer *zb, const ZBufferTexture *texture);
 void ZB_fillTriangleFlat(ZBuffer *zb, ZBufferPoint *p1, 
 						 ZBufferPoint *p2, ZBufferPoint *p3);
 void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p1, 
@@ -90,6 +201,25 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0,
 typedef void (*ZB_fillTriangleFunc)(ZBuffer *, ZBufferPoint *,
 									ZBufferPoint *, ZBufferPoint *);
 
+// ztriangle_bin.c
+
+// A triangle queued while binning, together with the zbuffer state the
+// filler reads, so that it can be rasterized later.
+struct ZBufferTriangle {
+	ZBufferPoint p0, p1, p2;
+	int ymin, ymax;
+	ZB_fillTriangleFunc fill;
+	const ZBufferTexture *texture;
+	unsigned char *shadow_mask_buf;
+	int shadow_color_r, shadow_color_g, shadow_color_b;
+};
+
+void ZB_binTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill, ZBufferPoint *p0,
+					ZBufferPoint *p1, ZBufferPoint *p2);
+void ZB_flushTriangles(ZBuffer *zb);
+void ZB_setBandThreads(ZBuffer *zb, int count);
+void ZB_closeBandThreads(ZBuffer *zb);
+
 // memory.c
 void gl_free(void *p);
 void *gl_malloc(int size);
@@ -35,6 +35,7 @@ enum {
 #define MAX_TEXTURE_STACK_DEPTH		8
 #define MAX_NAME_STACK_DEPTH		64
 #define MAX_TEXTURE_LEVELS			11
+#define MAX_TEXTURE_SIZE			1024
 #define T_MAX_LIGHTS				32
 
 #define VERTEX_HASH_SIZE 1031
@@ -126,6 +127,8 @@ typedef struct GLVertex {
 typedef struct GLImage {
 	void *pixmap;
 	int xsize, ysize;
+	ZBufferTexture zbtex;	// pixmap as the triangle fillers read it
+	int color_index;		// pixmap holds one palette index per texel
 } GLImage;
 
 // textures
@@ -135,6 +138,7 @@ typedef struct GLImage {
 typedef struct GLTexture {
 	GLImage images[MAX_TEXTURE_LEVELS];
 	int handle;
+	int palette;	// texture whose texels a color index image looks up
 	struct GLTexture *next, *prev;
 } GLTexture;
 
@@ -173,6 +177,7 @@ typedef struct GLContext {
 	// textures
 	GLTexture *current_texture;
 	int texture_2d_enabled;
+	int texture_tiling;
 
 	// shared state
 	GLSharedState shared_state;
@@ -252,6 +257,12 @@ typedef struct GLContext {
 	int texcoord_array_stride;
 	int client_states;
 
+	// transformed vertices of the locked arrays, see glopLockArrays
+	GLVertex *vertex_cache;
+	unsigned char *vertex_cache_valid;
+	int vertex_cache_first, vertex_cache_count;
+	int vertex_cache_size;
+
 	// opengl 1.1 polygon offset
 	float offset_factor;
 	float offset_units;
@@ -259,6 +270,11 @@ typedef struct GLContext {
 
 	int shadow_mode;
 
+	// triangles drawn and pixels covered by each filler, see tglGetFillStats
+	int fill_stats;
+	unsigned int fill_triangles[TGL_FILL_COUNT];
+	unsigned int fill_pixels[TGL_FILL_COUNT];
+
 	// specular buffer. could probably be shared between contexts, 
 	// but that wouldn't be 100% thread safe
 	GLSpecBuf *specbuf_first;
@@ -278,6 +294,9 @@ extern GLContext *gl_ctx;
 
 void gl_add_op(GLParam *p);
 
+// vertex.c
+void gl_vertex_cached(GLContext *c, GLParam *p, int idx);
+
 // clip.c
 void gl_transform_to_viewport(GLContext *c, GLVertex *v);
 void gl_draw_triangle(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2);
@@ -303,10 +322,13 @@ GLTexture *alloc_texture(GLContext *c, int h);
 
 // image_util.c
 void gl_convertRGB_to_5R6G5B8A(unsigned short *pixmap, unsigned char *rgba, int xsize, int ysize);
+void gl_tileImage(unsigned char *dest, const unsigned char *src, int xsize, int ysize, int pixel_size);
 void gl_resizeImage(unsigned char *dest, int xsize_dest, int ysize_dest,
 					unsigned char *src, int xsize_src, int ysize_src);
 void gl_resizeImageNoInterpolate(unsigned char *dest, int xsize_dest, int ysize_dest,
 								 unsigned char *src, int xsize_src, int ysize_src);
+void gl_resizeImageIndex(unsigned char *dest, int xsize_dest, int ysize_dest,
+						 const unsigned char *src, int xsize_src, int ysize_src);
 
 GLContext *gl_get_context();
 
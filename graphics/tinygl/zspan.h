@@ -0,0 +1,296 @@
+#ifndef GRAPHICS_TINYGL_ZSPAN_H
+#define GRAPHICS_TINYGL_ZSPAN_H
+
+// 8 pixel span kernels used by the triangle fillers.
+// Each kernel depth tests, shades and writes 8 consecutive pixels of a
+// scanline and gives exactly the same result as the scalar PUT_PIXEL
+// code it replaces. The fillers only use them when zb->simd_spans is set.
+
+#include "common/endian.h"
+
+// Built only when the compiler targets SSE2 or NEON and the build was not
+// configured with --disable-simd. Whether the CPU actually runs them is
+// decided at run time by ZB_hasSimdSpans().
+#if defined(USE_SIMD) && defined(__SSE2__)
+#define TINYGL_SIMD_SPANS
+#define TINYGL_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(USE_SIMD) && defined(__ARM_NEON)
+#define TINYGL_SIMD_SPANS
+#define TINYGL_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef TINYGL_SIMD_SPANS
+
+namespace TinyGL {
+
+// The rgb accumulator after 8 pixels.
+static inline unsigned int ZS_gouraudStep8(unsigned int rgb, unsigned int drgbdx) {
+	return (((rgb & 0xFFC00000) + 8 * (drgbdx & 0xFFC00000)) & 0xFFC00000) |
+		   (((rgb & 0x001FF000) + 8 * (drgbdx & 0x001FF000)) & 0x001FF000) |
+		   (((rgb & 0x000007FF) + 8 * (drgbdx & 0x000007FF)) & 0x000007FF);
+}
+
+#ifdef TINYGL_SIMD_SSE2
+
+// unsigned 32 bit a >= b
+static inline __m128i ZS_cmpge_u32(__m128i a, __m128i b) {
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	__m128i lt = _mm_cmpgt_epi32(_mm_xor_si128(b, bias), _mm_xor_si128(a, bias));
+	return _mm_xor_si128(lt, _mm_set1_epi32(-1));
+}
+
+// Depth values and depth test of the 8 pixels starting at pz/pz_2.
+// Returns the test result as one 16 bit mask per pixel.
+static inline __m128i ZS_depthTest8(const unsigned short *pz, const unsigned int *pz_2,
+									unsigned int z, unsigned int dzdx,
+									__m128i &z_lo, __m128i &z_hi, __m128i &m_lo, __m128i &m_hi) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i zb = _mm_loadu_si128((const __m128i *)pz);
+	__m128i zb_lo = _mm_unpacklo_epi16(zb, zero);
+	__m128i zb_hi = _mm_unpackhi_epi16(zb, zero);
+	__m128i zb2_lo = _mm_loadu_si128((const __m128i *)pz_2);
+	__m128i zb2_hi = _mm_loadu_si128((const __m128i *)(pz_2 + 4));
+
+	z_lo = _mm_add_epi32(_mm_set1_epi32(z), _mm_set_epi32(3 * dzdx, 2 * dzdx, dzdx, 0));
+	z_hi = _mm_add_epi32(z_lo, _mm_set1_epi32(4 * dzdx));
+
+	m_lo = _mm_and_si128(ZS_cmpge_u32(_mm_srli_epi32(z_lo, ZB_POINT_Z_FRAC_BITS), zb_lo),
+						 ZS_cmpge_u32(z_lo, zb2_lo));
+	m_hi = _mm_and_si128(ZS_cmpge_u32(_mm_srli_epi32(z_hi, ZB_POINT_Z_FRAC_BITS), zb_hi),
+						 ZS_cmpge_u32(z_hi, zb2_hi));
+	return _mm_packs_epi32(m_lo, m_hi);
+}
+
+// Writes the pixels and depths of the lanes selected by the masks.
+static inline void ZS_store8(PIXEL *pp, unsigned int *pz_2, __m128i pixels, __m128i mask,
+							 __m128i z_lo, __m128i z_hi, __m128i m_lo, __m128i m_hi) {
+	__m128i old = _mm_loadu_si128((const __m128i *)pp);
+	_mm_storeu_si128((__m128i *)pp, _mm_or_si128(_mm_and_si128(mask, pixels), _mm_andnot_si128(mask, old)));
+	old = _mm_loadu_si128((const __m128i *)pz_2);
+	_mm_storeu_si128((__m128i *)pz_2, _mm_or_si128(_mm_and_si128(m_lo, z_lo), _mm_andnot_si128(m_lo, old)));
+	old = _mm_loadu_si128((const __m128i *)(pz_2 + 4));
+	_mm_storeu_si128((__m128i *)(pz_2 + 4), _mm_or_si128(_mm_and_si128(m_hi, z_hi), _mm_andnot_si128(m_hi, old)));
+}
+
+// One color for all 8 pixels.
+static inline void ZS_spanFlat8(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+								unsigned int z, unsigned int dzdx, int color) {
+	__m128i z_lo, z_hi, m_lo, m_hi;
+	__m128i mask = ZS_depthTest8(pz, pz_2, z, dzdx, z_lo, z_hi, m_lo, m_hi);
+	if (_mm_movemask_epi8(mask) == 0)
+		return;
+	ZS_store8(pp, pz_2, _mm_set1_epi16((short)color), mask, z_lo, z_hi, m_lo, m_hi);
+}
+
+// Gouraud colors of 8 pixels from the packed rgb accumulator of the
+// smooth fillers. Stepping the accumulator with
+// rgb = (rgb + drgbdx) & ~0x00200800 adds each of its three fields modulo
+// the field width, so every lane can be computed directly.
+static inline __m128i ZS_gouraud8(unsigned int rgb, unsigned int drgbdx) {
+	static const unsigned int fields[3] = { 0xFFC00000, 0x001FF000, 0x000007FF };
+	__m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+	for (int i = 0; i < 3; i++) {
+		unsigned int c = rgb & fields[i], d = drgbdx & fields[i];
+		__m128i m = _mm_set1_epi32(fields[i]);
+		__m128i l = _mm_add_epi32(_mm_set1_epi32(c), _mm_set_epi32(3 * d, 2 * d, d, 0));
+		__m128i h = _mm_add_epi32(l, _mm_set1_epi32(4 * d));
+		lo = _mm_or_si128(lo, _mm_and_si128(l, m));
+		hi = _mm_or_si128(hi, _mm_and_si128(h, m));
+	}
+	// pixel = tmp | (tmp >> 16) with tmp = rgb & 0xF81F07E0, kept as 16 bits
+	lo = _mm_or_si128(_mm_and_si128(lo, _mm_set1_epi32(0x07E0)),
+					  _mm_and_si128(_mm_srli_epi32(lo, 16), _mm_set1_epi32(0xF81F)));
+	hi = _mm_or_si128(_mm_and_si128(hi, _mm_set1_epi32(0x07E0)),
+					  _mm_and_si128(_mm_srli_epi32(hi, 16), _mm_set1_epi32(0xF81F)));
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
+
+static inline void ZS_spanSmooth8(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+								  unsigned int z, unsigned int dzdx,
+								  unsigned int rgb, unsigned int drgbdx) {
+	__m128i z_lo, z_hi, m_lo, m_hi;
+	__m128i mask = ZS_depthTest8(pz, pz_2, z, dzdx, z_lo, z_hi, m_lo, m_hi);
+	if (_mm_movemask_epi8(mask) == 0)
+		return;
+	ZS_store8(pp, pz_2, ZS_gouraud8(rgb, drgbdx), mask, z_lo, z_hi, m_lo, m_hi);
+}
+
+// Perspective correct texture mapping modulated by the Gouraud light.
+// Texels whose alpha is not 0xff are skipped.
+static inline void ZS_spanMappingPerspective8(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+											  unsigned int z, unsigned int dzdx, const ZBufferTexture *texture,
+											  unsigned int s, unsigned int t, int dsdx, int dtdx,
+											  unsigned int rgb, unsigned int drgbdx) {
+	const __m128i mask_r = _mm_set1_epi16((short)0xF800);
+	const __m128i mask_g = _mm_set1_epi16(0x07E0);
+	const __m128i mask_b = _mm_set1_epi16(0x001F);
+	__m128i z_lo, z_hi, m_lo, m_hi;
+	__m128i mask = ZS_depthTest8(pz, pz_2, z, dzdx, z_lo, z_hi, m_lo, m_hi);
+	if (_mm_movemask_epi8(mask) == 0)
+		return;
+
+	const char *ptr[8];
+	for (int _a = 0; _a < 8; _a++) {
+		ptr[_a] = (const char *)ZB_texel(texture, s, t);
+		s += dsdx;
+		t += dtdx;
+	}
+	__m128i c = _mm_set_epi16(READ_UINT16(ptr[7]), READ_UINT16(ptr[6]), READ_UINT16(ptr[5]), READ_UINT16(ptr[4]),
+							  READ_UINT16(ptr[3]), READ_UINT16(ptr[2]), READ_UINT16(ptr[1]), READ_UINT16(ptr[0]));
+	__m128i alpha = _mm_set_epi16((unsigned char)ptr[7][2], (unsigned char)ptr[6][2], (unsigned char)ptr[5][2],
+								  (unsigned char)ptr[4][2], (unsigned char)ptr[3][2], (unsigned char)ptr[2][2],
+								  (unsigned char)ptr[1][2], (unsigned char)ptr[0][2]);
+	alpha = _mm_cmpeq_epi16(alpha, _mm_set1_epi16(0xff));
+	mask = _mm_and_si128(mask, alpha);
+	m_lo = _mm_and_si128(m_lo, _mm_unpacklo_epi16(alpha, alpha));
+	m_hi = _mm_and_si128(m_hi, _mm_unpackhi_epi16(alpha, alpha));
+
+	__m128i l = ZS_gouraud8(rgb, drgbdx);
+	__m128i c_r = _mm_srli_epi16(_mm_and_si128(c, mask_r), 8);
+	__m128i c_g = _mm_srli_epi16(_mm_and_si128(c, mask_g), 3);
+	__m128i c_b = _mm_slli_epi16(_mm_and_si128(c, mask_b), 3);
+	__m128i l_r = _mm_srli_epi16(_mm_and_si128(l, mask_r), 8);
+	__m128i l_g = _mm_srli_epi16(_mm_and_si128(l, mask_g), 3);
+	__m128i l_b = _mm_slli_epi16(_mm_and_si128(l, mask_b), 3);
+	// the products are below 0x10000, so the low half is all there is
+	c_r = _mm_srli_epi16(_mm_mullo_epi16(c_r, l_r), 8);
+	c_g = _mm_srli_epi16(_mm_mullo_epi16(c_g, l_g), 8);
+	c_b = _mm_srli_epi16(_mm_mullo_epi16(c_b, l_b), 8);
+	__m128i pixels = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(c_r, _mm_set1_epi16(0xF8)), 8),
+					 _mm_or_si128(_mm_slli_epi16(_mm_and_si128(c_g, _mm_set1_epi16(0xFC)), 3),
+								  _mm_srli_epi16(c_b, 3)));
+
+	ZS_store8(pp, pz_2, pixels, mask, z_lo, z_hi, m_lo, m_hi);
+}
+
+#else // TINYGL_SIMD_NEON
+
+// Depth values and depth test of the 8 pixels starting at pz/pz_2.
+// Returns the test result as one 16 bit mask per pixel.
+static inline uint16x8_t ZS_depthTest8(const unsigned short *pz, const unsigned int *pz_2,
+									   unsigned int z, unsigned int dzdx,
+									   uint32x4_t &z_lo, uint32x4_t &z_hi, uint32x4_t &m_lo, uint32x4_t &m_hi) {
+	const uint32_t steps[4] = { 0, dzdx, 2 * dzdx, 3 * dzdx };
+	uint16x8_t zb = vld1q_u16(pz);
+	uint32x4_t zb_lo = vmovl_u16(vget_low_u16(zb));
+	uint32x4_t zb_hi = vmovl_u16(vget_high_u16(zb));
+	uint32x4_t zb2_lo = vld1q_u32(pz_2);
+	uint32x4_t zb2_hi = vld1q_u32(pz_2 + 4);
+
+	z_lo = vaddq_u32(vdupq_n_u32(z), vld1q_u32(steps));
+	z_hi = vaddq_u32(z_lo, vdupq_n_u32(4 * dzdx));
+
+	m_lo = vandq_u32(vcgeq_u32(vshrq_n_u32(z_lo, ZB_POINT_Z_FRAC_BITS), zb_lo), vcgeq_u32(z_lo, zb2_lo));
+	m_hi = vandq_u32(vcgeq_u32(vshrq_n_u32(z_hi, ZB_POINT_Z_FRAC_BITS), zb_hi), vcgeq_u32(z_hi, zb2_hi));
+	return vcombine_u16(vmovn_u32(m_lo), vmovn_u32(m_hi));
+}
+
+static inline bool ZS_anySet8(uint16x8_t mask) {
+	uint16x4_t m = vorr_u16(vget_low_u16(mask), vget_high_u16(mask));
+	return vget_lane_u64(vreinterpret_u64_u16(m), 0) != 0;
+}
+
+// Writes the pixels and depths of the lanes selected by the masks.
+static inline void ZS_store8(PIXEL *pp, unsigned int *pz_2, uint16x8_t pixels, uint16x8_t mask,
+							 uint32x4_t z_lo, uint32x4_t z_hi, uint32x4_t m_lo, uint32x4_t m_hi) {
+	vst1q_u16((uint16_t *)pp, vbslq_u16(mask, pixels, vld1q_u16((const uint16_t *)pp)));
+	vst1q_u32(pz_2, vbslq_u32(m_lo, z_lo, vld1q_u32(pz_2)));
+	vst1q_u32(pz_2 + 4, vbslq_u32(m_hi, z_hi, vld1q_u32(pz_2 + 4)));
+}
+
+// One color for all 8 pixels.
+static inline void ZS_spanFlat8(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+								unsigned int z, unsigned int dzdx, int color) {
+	uint32x4_t z_lo, z_hi, m_lo, m_hi;
+	uint16x8_t mask = ZS_depthTest8(pz, pz_2, z, dzdx, z_lo, z_hi, m_lo, m_hi);
+	if (!ZS_anySet8(mask))
+		return;
+	ZS_store8(pp, pz_2, vdupq_n_u16((uint16_t)color), mask, z_lo, z_hi, m_lo, m_hi);
+}
+
+// Gouraud colors of 8 pixels, see the SSE2 version.
+static inline uint16x8_t ZS_gouraud8(unsigned int rgb, unsigned int drgbdx) {
+	static const unsigned int fields[3] = { 0xFFC00000, 0x001FF000, 0x000007FF };
+	uint32x4_t lo = vdupq_n_u32(0), hi = vdupq_n_u32(0);
+	for (int i = 0; i < 3; i++) {
+		unsigned int c = rgb & fields[i], d = drgbdx & fields[i];
+		const uint32_t steps[4] = { 0, d, 2 * d, 3 * d };
+		uint32x4_t m = vdupq_n_u32(fields[i]);
+		uint32x4_t l = vaddq_u32(vdupq_n_u32(c), vld1q_u32(steps));
+		uint32x4_t h = vaddq_u32(l, vdupq_n_u32(4 * d));
+		lo = vorrq_u32(lo, vandq_u32(l, m));
+		hi = vorrq_u32(hi, vandq_u32(h, m));
+	}
+	lo = vorrq_u32(vandq_u32(lo, vdupq_n_u32(0x07E0)), vandq_u32(vshrq_n_u32(lo, 16), vdupq_n_u32(0xF81F)));
+	hi = vorrq_u32(vandq_u32(hi, vdupq_n_u32(0x07E0)), vandq_u32(vshrq_n_u32(hi, 16), vdupq_n_u32(0xF81F)));
+	return vcombine_u16(vmovn_u32(lo), vmovn_u32(hi));
+}
+
+static inline void ZS_spanSmooth8(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+								  unsigned int z, unsigned int dzdx,
+								  unsigned int rgb, unsigned int drgbdx) {
+	uint32x4_t z_lo, z_hi, m_lo, m_hi;
+	uint16x8_t mask = ZS_depthTest8(pz, pz_2, z, dzdx, z_lo, z_hi, m_lo, m_hi);
+	if (!ZS_anySet8(mask))
+		return;
+	ZS_store8(pp, pz_2, ZS_gouraud8(rgb, drgbdx), mask, z_lo, z_hi, m_lo, m_hi);
+}
+
+// Perspective correct texture mapping modulated by the Gouraud light.
+// Texels whose alpha is not 0xff are skipped.
+static inline void ZS_spanMappingPerspective8(PIXEL *pp, unsigned short *pz, unsigned int *pz_2,
+											  unsigned int z, unsigned int dzdx, const ZBufferTexture *texture,
+											  unsigned int s, unsigned int t, int dsdx, int dtdx,
+											  unsigned int rgb, unsigned int drgbdx) {
+	const uint16x8_t mask_r = vdupq_n_u16(0xF800);
+	const uint16x8_t mask_g = vdupq_n_u16(0x07E0);
+	const uint16x8_t mask_b = vdupq_n_u16(0x001F);
+	uint32x4_t z_lo, z_hi, m_lo, m_hi;
+	uint16x8_t mask = ZS_depthTest8(pz, pz_2, z, dzdx, z_lo, z_hi, m_lo, m_hi);
+	if (!ZS_anySet8(mask))
+		return;
+
+	uint16_t texels[8], alphas[8];
+	for (int _a = 0; _a < 8; _a++) {
+		const char *ptr = (const char *)ZB_texel(texture, s, t);
+		texels[_a] = READ_UINT16(ptr);
+		alphas[_a] = (unsigned char)ptr[2];
+		s += dsdx;
+		t += dtdx;
+	}
+	uint16x8_t c = vld1q_u16(texels);
+	uint16x8_t alpha = vceqq_u16(vld1q_u16(alphas), vdupq_n_u16(0xff));
+	mask = vandq_u16(mask, alpha);
+	// widen the 16 bit lane masks by sign extension
+	m_lo = vandq_u32(m_lo, vreinterpretq_u32_s32(vmovl_s16(vreinterpret_s16_u16(vget_low_u16(alpha)))));
+	m_hi = vandq_u32(m_hi, vreinterpretq_u32_s32(vmovl_s16(vreinterpret_s16_u16(vget_high_u16(alpha)))));
+
+	uint16x8_t l = ZS_gouraud8(rgb, drgbdx);
+	uint16x8_t c_r = vshrq_n_u16(vandq_u16(c, mask_r), 8);
+	uint16x8_t c_g = vshrq_n_u16(vandq_u16(c, mask_g), 3);
+	uint16x8_t c_b = vshlq_n_u16(vandq_u16(c, mask_b), 3);
+	uint16x8_t l_r = vshrq_n_u16(vandq_u16(l, mask_r), 8);
+	uint16x8_t l_g = vshrq_n_u16(vandq_u16(l, mask_g), 3);
+	uint16x8_t l_b = vshlq_n_u16(vandq_u16(l, mask_b), 3);
+	// the products are below 0x10000, so 16 bit lanes hold them
+	c_r = vshrq_n_u16(vmulq_u16(c_r, l_r), 8);
+	c_g = vshrq_n_u16(vmulq_u16(c_g, l_g), 8);
+	c_b = vshrq_n_u16(vmulq_u16(c_b, l_b), 8);
+	uint16x8_t pixels = vorrq_u16(vshlq_n_u16(vandq_u16(c_r, vdupq_n_u16(0xF8)), 8),
+						vorrq_u16(vshlq_n_u16(vandq_u16(c_g, vdupq_n_u16(0xFC)), 3),
+								  vshrq_n_u16(c_b, 3)));
+
+	ZS_store8(pp, pz_2, pixels, mask, z_lo, z_hi, m_lo, m_hi);
+}
+
+#endif // TINYGL_SIMD_SSE2
+
+} // end of namespace TinyGL
+
+#endif // TINYGL_SIMD_SPANS
+
+#endif
@@ -1,6 +1,7 @@
 
 #include "common/endian.h"
 #include "graphics/tinygl/zbuffer.h"
+#include "graphics/tinygl/zspan.h"
 
 namespace TinyGL {
 
@@ -24,6 +25,38 @@ void ZB_fillTriangleFlat(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuffe
 	z += dzdx;								\
 }
 
+#ifdef TINYGL_SIMD_SPANS
+#define DRAW_LINE()	{								\
+	register unsigned short *pz;					\
+	register unsigned int *pz_2;					\
+	register PIXEL *pp;								\
+	register unsigned int z, zz;					\
+	register int n;									\
+	n = (x2 >> 16) - x1;							\
+	pp = pp1 + x1;									\
+	pz = pz1 + x1;									\
+	pz_2 = pz2 + x1;								\
+	z = z1;											\
+	if (zb->simd_spans) {							\
+		while (n >= 7) {							\
+			ZS_spanFlat8(pp, pz, pz_2, z, dzdx, color);	\
+			z += 8 * dzdx;							\
+			pz += 8;								\
+			pz_2 += 8;								\
+			pp += 8;								\
+			n -= 8;									\
+		}											\
+	}												\
+	while (n >= 0) {								\
+		PUT_PIXEL(0);								\
+		pz += 1;									\
+		pz_2 += 1;									\
+		pp += 1;									\
+		n -= 1;										\
+	}												\
+}
+#endif
+
 #include "graphics/tinygl/ztriangle.h"
 }
 
@@ -55,6 +88,24 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 	rgb = (rgb + drgbdx) & (~0x00200800);	\
 }
 
+#ifdef TINYGL_SIMD_SPANS
+#define SMOOTH_SPANS_8() {							\
+	if (zb->simd_spans) {							\
+		while (n >= 7) {							\
+			ZS_spanSmooth8(pp, pz, pz_2, z, dzdx, rgb, drgbdx);	\
+			rgb = ZS_gouraudStep8(rgb, drgbdx);		\
+			z += 8 * dzdx;							\
+			pz += 8;								\
+			pz_2 += 8;								\
+			pp += 8;								\
+			n -= 8;									\
+		}											\
+	}												\
+}
+#else
+#define SMOOTH_SPANS_8()
+#endif
+
 #define DRAW_LINE()	{								\
 	register unsigned short *pz;					\
 	register unsigned int *pz_2;					\
@@ -70,6 +121,7 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 	rgb |= (g1 >> 5) & 0x000007FF;					\
 	rgb |= (b1 << 5) & 0x001FF000;					\
 	drgbdx = _drgbdx;								\
+	SMOOTH_SPANS_8();								\
 	while (n >= 3) {								\
 		PUT_PIXEL(0);								\
 		PUT_PIXEL(1);								\
@@ -90,14 +142,15 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 }
 
 #include "graphics/tinygl/ztriangle.h"
+#undef SMOOTH_SPANS_8
 }
 
-void ZB_setTexture(ZBuffer *zb, PIXEL *texture) {
+void ZB_setTexture(ZBuffer *zb, const ZBufferTexture *texture) {
 	zb->current_texture=texture;
 }
 
 void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
-	PIXEL *texture;
+	const ZBufferTexture *texture;
 
 #define INTERP_Z
 #define INTERP_ST
@@ -109,7 +162,7 @@ void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBu
 #define PUT_PIXEL(_a) {						\
 	zz = z >> ZB_POINT_Z_FRAC_BITS;			\
 	if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {	\
-		pp[_a] = texture[((t & 0x3FC00000) | s) >> 14];	\
+		pp[_a] = READ_UINT16(ZB_texel(texture, s, t >> 8));	\
 		pz_2[_a] = z;						\
 	}										\
 	z += dzdx;								\
@@ -121,7 +174,7 @@ void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBu
 }
 
 void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
-	PIXEL *texture;
+	ZBufferTexture texture;
 	float fdzdx, fndzdx, ndszdx, ndtzdx;
 	int _drgbdx;
 
@@ -132,11 +185,12 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	unsigned short *pz1;
 	unsigned int *pz2;
 	PIXEL *pp1;
-	int part, update_left, update_right;
+	int part, update_left, update_right, line_y;
+	int nb_skip, nb_min, nb_max = 0;
 
 	int nb_lines, dx1, dy1, tmp, dx2, dy2;
 
-	int error = 0, derror = 0;
+	int error = 0, derror = 0, skip_error;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
 	// warning: x2 is multiplied by 2^16
 	int x2 = 0, dx2dy2 = 0;
@@ -234,7 +288,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	pz1 = zb->zbuf + p0->y * zb->xsize;
 	pz2 = zb->zbuf2 + p0->y * zb->xsize;
 
-	texture = zb->current_texture;
+	texture = *zb->current_texture;
 	fdzdx = (float)dzdx;
 	fndzdx = NB_INTERP * fdzdx;
 	ndszdx = NB_INTERP * dszdx;
@@ -243,6 +297,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	_drgbdx |= (dgdx / (1 << 5)) & 0x000007FF;
 	_drgbdx |= ((dbdx / (1 << 7)) << 12) & 0x001FF000;
 
+	line_y = p0->y;
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz0 > 0) {
@@ -329,6 +384,39 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 			x2 = pr1->x << 16;
 		}
 
+		// only walk the scanlines of the band
+		if (line_y >= zb->band_y1)
+			return;
+		skip_error = error;
+		nb_skip = ZB_bandSkip(zb, line_y, &nb_lines, &error, derror, &nb_max);
+		if (nb_skip > 0) {
+			nb_min = nb_skip - nb_max;
+			x1 += nb_min * dxdy_min + nb_max * dxdy_max;
+			ZB_SKIP_EDGE(z1, nb_min, dzdl_min, nb_max, dzdl_max);
+			ZB_SKIP_EDGE(r1, nb_min, drdl_min, nb_max, drdl_max);
+			ZB_SKIP_EDGE(g1, nb_min, dgdl_min, nb_max, dgdl_max);
+			ZB_SKIP_EDGE(b1, nb_min, dbdl_min, nb_max, dbdl_max);
+			// the float interpolants are added up line by line like below,
+			// a product would not round the same
+			for (int i = 0; i < nb_skip; i++) {
+				skip_error += derror;
+				if (skip_error > 0) {
+					skip_error -= 0x10000;
+					sz1 += dszdl_max;
+					tz1 += dtzdl_max;
+				} else {
+					sz1 += dszdl_min;
+					tz1 += dtzdl_min;
+				}
+			}
+			x2 += nb_skip * dx2dy2;
+
+			line_y += nb_skip;
+			pp1 = (PIXEL *)((char *)pp1 + nb_skip * zb->linesize);
+			pz1 += nb_skip * zb->xsize;
+			pz2 += nb_skip * zb->xsize;
+		}
+
 		// we draw all the scan line of the part
 
 		while (nb_lines > 0) {
@@ -365,35 +453,42 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 						fz += fndzdx;
 						zinv = (float)(1.0 / fz);
 					}
-					for (int _a = 0; _a < 8; _a++) {
-						zz = z >> ZB_POINT_Z_FRAC_BITS;
-						if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {
-							unsigned ttt = (t & 0x003FC000) >> (9 - PSZSH);
-							unsigned sss = (s & 0x003FC000) >> (17 - PSZSH);
-							char *ptr = (char *)(texture) + (((ttt | sss) >> 1) * 3);
-							PIXEL pixel = READ_UINT16(ptr);
-							char alpha = *(ptr + 2);
-							if (alpha == '\xff') {
-								tmp = rgb & 0xF81F07E0;
-								unsigned int light = tmp | (tmp >> 16);
-								unsigned int c_r = (pixel & 0xF800) >> 8;
-								unsigned int c_g = (pixel & 0x07E0) >> 3;
-								unsigned int c_b = (pixel & 0x001F) << 3;
-								unsigned int l_r = (light & 0xF800) >> 8;
-								unsigned int l_g = (light & 0x07E0) >> 3;
-								unsigned int l_b = (light & 0x001F) << 3;
-								c_r = (c_r * l_r) / 256;
-								c_g = (c_g * l_g) / 256;
-								c_b = (c_b * l_b) / 256;
-								pixel = ((c_r & 0xF8) << 8) | ((c_g & 0xFC) << 3) | (c_b >> 3);
-								pp[_a] = pixel;
-								pz_2[_a] = z;
+#ifdef TINYGL_SIMD_SPANS
+					if (zb->simd_spans) {
+						ZS_spanMappingPerspective8(pp, pz, pz_2, z, dzdx, &texture, s, t, dsdx, dtdx, rgb, drgbdx);
+						z += NB_INTERP * dzdx;
+						rgb = ZS_gouraudStep8(rgb, drgbdx);
+					} else
+#endif
+					{
+						for (int _a = 0; _a < 8; _a++) {
+							zz = z >> ZB_POINT_Z_FRAC_BITS;
+							if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {
+								const char *ptr = (const char *)ZB_texel(&texture, s, t);
+								PIXEL pixel = READ_UINT16(ptr);
+								char alpha = *(ptr + 2);
+								if (alpha == '\xff') {
+									tmp = rgb & 0xF81F07E0;
+									unsigned int light = tmp | (tmp >> 16);
+									unsigned int c_r = (pixel & 0xF800) >> 8;
+									unsigned int c_g = (pixel & 0x07E0) >> 3;
+									unsigned int c_b = (pixel & 0x001F) << 3;
+									unsigned int l_r = (light & 0xF800) >> 8;
+									unsigned int l_g = (light & 0x07E0) >> 3;
+									unsigned int l_b = (light & 0x001F) << 3;
+									c_r = (c_r * l_r) / 256;
+									c_g = (c_g * l_g) / 256;
+									c_b = (c_b * l_b) / 256;
+									pixel = ((c_r & 0xF8) << 8) | ((c_g & 0xFC) << 3) | (c_b >> 3);
+									pp[_a] = pixel;
+									pz_2[_a] = z;
+								}
 							}
+							z += dzdx;
+							s += dsdx;
+							t += dtdx;
+							rgb = (rgb + drgbdx) & (~0x00200800);
 						}
-						z += dzdx;
-						s += dsdx;
-						t += dtdx;
-						rgb = (rgb + drgbdx) & (~0x00200800);
 					}
 
 					pz += NB_INTERP;
@@ -418,9 +513,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 					{
 						zz = z >> ZB_POINT_Z_FRAC_BITS;
 						if ((ZCMP(zz, pz[0])) && (ZCMP(z, pz_2[0]))) {
-							unsigned ttt = (t & 0x003FC000) >> (9 - PSZSH);
-							unsigned sss = (s & 0x003FC000) >> (17 - PSZSH);
-							char *ptr = (char *)(texture) + (((ttt | sss) >> 1) * 3);
+							const char *ptr = (const char *)ZB_texel(&texture, s, t);
 							PIXEL pixel = READ_UINT16(ptr);
 							char alpha = *(ptr + 2);
 							if (alpha == '\xff') {
@@ -483,6 +576,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 			x2 += dx2dy2;
 
 			// screen coordinates
+			line_y++;
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
@@ -7,7 +7,8 @@
 	unsigned short *pz1;
 	unsigned int *pz2;
 	PIXEL *pp1;
-	int part, update_left, update_right;
+	int part, update_left, update_right, line_y;
+	int nb_skip, nb_min, nb_max = 0;
 
 	int nb_lines, dx1, dy1, tmp, dx2, dy2;
 
@@ -138,6 +139,7 @@
 
 	DRAW_INIT();
 
+	line_y = p0->y;
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -237,6 +239,37 @@
 			x2 = pr1->x << 16;
 		}
 
+		// only walk the scanlines of the band
+		if (line_y >= zb->band_y1)
+			return;
+		nb_skip = ZB_bandSkip(zb, line_y, &nb_lines, &error, derror, &nb_max);
+		if (nb_skip > 0) {
+			nb_min = nb_skip - nb_max;
+			x1 += nb_min * dxdy_min + nb_max * dxdy_max;
+#ifdef INTERP_Z
+			ZB_SKIP_EDGE(z1, nb_min, dzdl_min, nb_max, dzdl_max);
+#endif
+#ifdef INTERP_RGB
+			ZB_SKIP_EDGE(r1, nb_min, drdl_min, nb_max, drdl_max);
+			ZB_SKIP_EDGE(g1, nb_min, dgdl_min, nb_max, dgdl_max);
+			ZB_SKIP_EDGE(b1, nb_min, dbdl_min, nb_max, dbdl_max);
+#endif
+#ifdef INTERP_ST
+			ZB_SKIP_EDGE(s1, nb_min, dsdl_min, nb_max, dsdl_max);
+			ZB_SKIP_EDGE(t1, nb_min, dtdl_min, nb_max, dtdl_max);
+#endif
+#ifdef INTERP_STZ
+			sz1 += nb_min * dszdl_min + nb_max * dszdl_max;
+			tz1 += nb_min * dtzdl_min + nb_max * dtzdl_max;
+#endif
+			x2 += nb_skip * dx2dy2;
+
+			line_y += nb_skip;
+			pp1 = (PIXEL *)((char *)pp1 + nb_skip * zb->linesize);
+			pz1 += nb_skip * zb->xsize;
+			pz2 += nb_skip * zb->xsize;
+		}
+
 		// we draw all the scan line of the part
 
 		while (nb_lines>0) {
@@ -352,6 +385,7 @@
 			x2 += dx2dy2;
 
 			// screen coordinates
+			line_y++;
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
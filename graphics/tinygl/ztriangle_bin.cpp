@@ -0,0 +1,195 @@
+// Deferred triangle rasterization in horizontal bands
+
+#include "common/mutex.h"
+#include "common/thread.h"
+
+#include "graphics/tinygl/zgl.h"
+
+namespace TinyGL {
+
+void ZB_binTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill, ZBufferPoint *p0,
+					ZBufferPoint *p1, ZBufferPoint *p2) {
+	ZBufferTriangle *tri;
+
+	if (zb->bin_count == zb->bin_size) {
+		int size = zb->bin_size ? zb->bin_size * 2 : 1024;
+		ZBufferTriangle *bins = (ZBufferTriangle *)gl_malloc(size * sizeof(ZBufferTriangle));
+		if (zb->bin_triangles) {
+			memcpy(bins, zb->bin_triangles, zb->bin_count * sizeof(ZBufferTriangle));
+			gl_free(zb->bin_triangles);
+		}
+		zb->bin_triangles = bins;
+		zb->bin_size = size;
+	}
+
+	tri = &zb->bin_triangles[zb->bin_count++];
+	tri->p0 = *p0;
+	tri->p1 = *p1;
+	tri->p2 = *p2;
+	tri->ymin = MIN(p0->y, MIN(p1->y, p2->y));
+	tri->ymax = MAX(p0->y, MAX(p1->y, p2->y));
+	tri->fill = fill;
+	tri->texture = zb->current_texture;
+	tri->shadow_mask_buf = zb->shadow_mask_buf;
+	tri->shadow_color_r = zb->shadow_color_r;
+	tri->shadow_color_g = zb->shadow_color_g;
+	tri->shadow_color_b = zb->shadow_color_b;
+}
+
+// The triangles are replayed band by band, in submission order within a band.
+// A band only writes its own scanlines of the colour, z and shadow mask buffers
+// and every band works on its own copy of the zbuffer state, so bands do not
+// depend on each other and are handed out to the band threads, if any.
+struct ZBufferBandPool {
+	// zb, next_band and quit are guarded by band_lock
+	ZBuffer *zb;
+	int next_band;
+	bool quit;
+	Common::Mutex band_lock;
+	Common::Semaphore start, done;
+	Common::Thread *threads;
+	int thread_count;
+};
+
+static void ZB_rasterizeBand(ZBuffer *zb, int y) {
+	ZBuffer band = *zb;
+	band.band_y0 = y;
+	band.band_y1 = MIN(y + ZB_BAND_HEIGHT, zb->ysize);
+
+	for (int i = 0; i < zb->bin_count; i++) {
+		const ZBufferTriangle *tri = &zb->bin_triangles[i];
+		if (tri->ymax < band.band_y0 || tri->ymin >= band.band_y1)
+			continue;
+
+		// the fillers write to the points, so pass copies
+		ZBufferPoint p0 = tri->p0;
+		ZBufferPoint p1 = tri->p1;
+		ZBufferPoint p2 = tri->p2;
+
+		band.current_texture = tri->texture;
+		band.shadow_mask_buf = tri->shadow_mask_buf;
+		band.shadow_color_r = tri->shadow_color_r;
+		band.shadow_color_g = tri->shadow_color_g;
+		band.shadow_color_b = tri->shadow_color_b;
+		tri->fill(&band, &p0, &p1, &p2);
+	}
+}
+
+// take bands until all are done
+static void ZB_rasterizeBands(ZBufferBandPool *pool) {
+	for (;;) {
+		ZBuffer *zb;
+		int y;
+		{
+			Common::StackLock lock(pool->band_lock);
+			zb = pool->zb;
+			y = pool->next_band;
+			pool->next_band += ZB_BAND_HEIGHT;
+		}
+		if (y >= zb->ysize)
+			break;
+		ZB_rasterizeBand(zb, y);
+	}
+}
+
+// Every wakeup through start is answered on done: once per flush, and once
+// more when the thread returns after being told to quit.
+static int ZB_bandThread(void *param) {
+	ZBufferBandPool *pool = (ZBufferBandPool *)param;
+
+	for (;;) {
+		bool quit;
+		pool->start.wait();
+		{
+			Common::StackLock lock(pool->band_lock);
+			quit = pool->quit;
+		}
+		if (quit)
+			break;
+		ZB_rasterizeBands(pool);
+		pool->done.post();
+	}
+	pool->done.post();
+	return 0;
+}
+
+void ZB_flushTriangles(ZBuffer *zb) {
+	ZBufferBandPool *pool = zb->band_pool;
+
+	if (zb->bin_count == 0)
+		return;
+
+	if (!pool) {
+		for (int y = 0; y < zb->ysize; y += ZB_BAND_HEIGHT)
+			ZB_rasterizeBand(zb, y);
+	} else {
+		{
+			Common::StackLock lock(pool->band_lock);
+			pool->zb = zb;
+			pool->next_band = 0;
+		}
+		for (int i = 0; i < pool->thread_count; i++)
+			pool->start.post();
+		// the caller takes bands too
+		ZB_rasterizeBands(pool);
+		for (int i = 0; i < pool->thread_count; i++)
+			pool->done.wait();
+	}
+
+	zb->bin_count = 0;
+}
+
+// Rasterize the bands on count threads besides the caller of
+// ZB_flushTriangles. Without thread support in the backend, or with
+// a count of 0, the bands are rasterized one after another.
+void ZB_setBandThreads(ZBuffer *zb, int count) {
+	ZBufferBandPool *pool;
+
+	ZB_flushTriangles(zb);
+	ZB_closeBandThreads(zb);
+	if (count <= 0)
+		return;
+
+	pool = new ZBufferBandPool;
+	pool->zb = zb;
+	pool->next_band = 0;
+	pool->quit = false;
+	pool->threads = new Common::Thread[count];
+	pool->thread_count = 0;
+	if (pool->start.isValid() && pool->done.isValid()) {
+		while (pool->thread_count < count &&
+			   pool->threads[pool->thread_count].start(ZB_bandThread, pool))
+			pool->thread_count++;
+	}
+	zb->band_pool = pool;
+	zb->band_threads = pool->thread_count;
+
+	if (pool->thread_count == 0)
+		ZB_closeBandThreads(zb);
+}
+
+void ZB_closeBandThreads(ZBuffer *zb) {
+	ZBufferBandPool *pool = zb->band_pool;
+
+	if (!pool)
+		return;
+
+	{
+		Common::StackLock lock(pool->band_lock);
+		pool->quit = true;
+	}
+	for (int i = 0; i < pool->thread_count; i++)
+		pool->start.post();
+	// wait until every thread is done with the pool, then join them
+	for (int i = 0; i < pool->thread_count; i++)
+		pool->done.wait();
+	for (int i = 0; i < pool->thread_count; i++)
+		pool->threads[i].wait();
+	delete[] pool->threads;
+	delete pool;
+
+	zb->band_pool = NULL;
+	zb->band_threads = 0;
+}
+
+} // end of namespace TinyGL
@@ -9,7 +9,8 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 	ZBufferPoint *t, *pr1 = 0, *pr2 = 0, *l1 = 0, *l2 = 0;
 	float fdx1, fdx2, fdy1, fdy2, fz;
 	unsigned char *pm1;
-	int part, update_left, update_right;
+	int part, update_left, update_right, line_y;
+	int nb_skip, nb_min, nb_max = 0;
 
 	int nb_lines, dx1, dy1, tmp, dx2, dy2;
 
@@ -57,6 +58,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 
 	pm1 = zb->shadow_mask_buf + zb->xsize * p0->y;
 
+	line_y = p0->y;
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -118,6 +120,19 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 			x2 = pr1->x << 16;
 		}
 
+		// only walk the scanlines of the band
+		if (line_y >= zb->band_y1)
+			return;
+		nb_skip = ZB_bandSkip(zb, line_y, &nb_lines, &error, derror, &nb_max);
+		if (nb_skip > 0) {
+			nb_min = nb_skip - nb_max;
+			x1 += nb_min * dxdy_min + nb_max * dxdy_max;
+			x2 += nb_skip * dx2dy2;
+
+			line_y += nb_skip;
+			pm1 += nb_skip * zb->xsize;
+		}
+
 		// we draw all the scan line of the part
 		while (nb_lines > 0) {
 			nb_lines--;
@@ -155,6 +170,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 			x2 += dx2dy2;
 
 			// screen coordinates
+			line_y++;
 			pm1 = pm1 + zb->xsize;
 		}
 	}
@@ -168,7 +184,8 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 	unsigned short *pz1;
 	unsigned int *pz2;
 	PIXEL *pp1;
-	int part, update_left, update_right;
+	int part, update_left, update_right, line_y;
+	int nb_skip, nb_min, nb_max = 0;
 
 	int nb_lines, dx1, dy1, tmp, dx2, dy2;
 
@@ -228,6 +245,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 
 	color = RGB_TO_PIXEL(zb->shadow_color_r, zb->shadow_color_g, zb->shadow_color_b);
 
+	line_y = p0->y;
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -294,6 +312,23 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 			x2 = pr1->x << 16;
 		}
 
+		// only walk the scanlines of the band
+		if (line_y >= zb->band_y1)
+			return;
+		nb_skip = ZB_bandSkip(zb, line_y, &nb_lines, &error, derror, &nb_max);
+		if (nb_skip > 0) {
+			nb_min = nb_skip - nb_max;
+			x1 += nb_min * dxdy_min + nb_max * dxdy_max;
+			ZB_SKIP_EDGE(z1, nb_min, dzdl_min, nb_max, dzdl_max);
+			x2 += nb_skip * dx2dy2;
+
+			line_y += nb_skip;
+			pp1 = (PIXEL *)((char *)pp1 + nb_skip * zb->linesize);
+			pz1 += nb_skip * zb->xsize;
+			pz2 += nb_skip * zb->xsize;
+			pm1 += nb_skip * zb->xsize;
+		}
+
 		// we draw all the scan line of the part
 
 		while (nb_lines > 0) {
@@ -357,6 +392,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 			x2 += dx2dy2;
 
 			// screen coordinates
+			line_y++;
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;